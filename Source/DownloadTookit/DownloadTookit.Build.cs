@@ -28,6 +28,8 @@ public class DownloadTookit : ModuleRules
 			new string[]
 			{
 				"Core",
+				"CoreUObject",
+				"Engine",
                 "HTTP",
                 "SSL"
 				// ... add other public dependencies that you statically link with here ...
@@ -37,8 +39,6 @@ public class DownloadTookit : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"CoreUObject",
-				"Engine",
 				"Slate",
 				"SlateCore",
 				// ... add private dependencies that you statically link with here ...	
@@ -53,10 +53,15 @@ public class DownloadTookit : ModuleRules
 			}
 			);
 
+        // inflate the content while downloading
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
         PublicDefinitions.AddRange(new string[]{
-            "WITH_LOG=0",
-            "HACK_HTTP_LOG_GETCONTENT_WARNING=1"
+            "WITH_LOG=0"
         });
+
+        // trace events of the download path,compiled out in shipping.
+        PublicDefinitions.Add("DOWNLOADTOOKIT_WITH_TRACE=" + (Target.Configuration == UnrealTargetConfiguration.Shipping ? "0" : "1"));
 	
         OptimizeCode = CodeOptimization.InShippingBuildsOnly;
     }
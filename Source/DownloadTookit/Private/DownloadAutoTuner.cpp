@@ -0,0 +1,137 @@
+#include "DownloadAutoTuner.h"
+#include "DownloadTookitLog.h"
+
+// engine header
+#include "HAL/PlatformTime.h"
+
+#define TUNE_INTERVAL 2.0 // second
+#define MAX_TUNED_REQUEST_SIZE 1024*1024*64ll // 64MB
+// the throughput must grow 5% to keep the added connection
+#define CONNECTION_IMPROVE_RATIO 0.05
+#define CONNECTION_HOLD_INTERVAL 5
+#define REQUEST_DECREASE_RATIO 0.5
+#define REQUEST_SHRINK_RATIO 0.75
+
+FDownloadAutoTuner::FDownloadAutoTuner()
+	: ConnectionCount(1),
+	RequestByte(0),
+	IntervalStartTime(0),
+	IntervalByte(0),
+	IntervalErrorCount(0),
+	LastBytesPerSecond(0),
+	bConnectionIncreased(false),
+	HoldInterval(0)
+{
+}
+
+void FDownloadAutoTuner::Start(const FDownloadAutoTuneSettings& InSettings, int32 InConnectionCount, int64 InRequestByte)
+{
+	Settings = InSettings;
+	Settings.MinConnectionCount = FMath::Max(1, Settings.MinConnectionCount);
+	Settings.MaxConnectionCount = FMath::Max(Settings.MinConnectionCount, Settings.MaxConnectionCount);
+	Settings.MaxRequestByte = FMath::Clamp<int64>(Settings.MaxRequestByte, 1, MAX_TUNED_REQUEST_SIZE);
+	Settings.MinRequestByte = FMath::Clamp<int64>(Settings.MinRequestByte, 1, Settings.MaxRequestByte);
+	Settings.TargetRequestSeconds = FMath::Max(0.1f, Settings.TargetRequestSeconds);
+
+	ConnectionCount = FMath::Max(1, InConnectionCount);
+	RequestByte = InRequestByte;
+	if (Settings.bEnabled)
+	{
+		ConnectionCount = FMath::Clamp(ConnectionCount, Settings.MinConnectionCount, Settings.MaxConnectionCount);
+		RequestByte = FMath::Clamp(RequestByte, Settings.MinRequestByte, Settings.MaxRequestByte);
+	}
+	IntervalStartTime = FPlatformTime::Seconds();
+	IntervalByte = 0;
+	IntervalErrorCount = 0;
+	LastBytesPerSecond = 0;
+	bConnectionIncreased = false;
+	HoldInterval = 0;
+}
+
+void FDownloadAutoTuner::AddReceivedByte(int64 InByte)
+{
+	IntervalByte += InByte;
+}
+
+void FDownloadAutoTuner::OnRequestCompleted(int64 InRequestByte, double InSeconds)
+{
+	if (!Settings.bEnabled || InRequestByte < RequestByte)
+	{
+		// the tail of segment is shorter,not a sample of the request size.
+		return;
+	}
+	if (InSeconds < Settings.TargetRequestSeconds)
+	{
+		RequestByte = FMath::Min(RequestByte + Settings.MinRequestByte, Settings.MaxRequestByte);
+	}
+	else if (InSeconds > Settings.TargetRequestSeconds * 2)
+	{
+		// too long,a dropped request waste much
+		RequestByte = FMath::Max((int64)(RequestByte * REQUEST_SHRINK_RATIO), Settings.MinRequestByte);
+	}
+}
+
+void FDownloadAutoTuner::OnRequestFailed()
+{
+	if (!Settings.bEnabled)
+	{
+		return;
+	}
+	++IntervalErrorCount;
+	RequestByte = FMath::Max((int64)(RequestByte * REQUEST_DECREASE_RATIO), Settings.MinRequestByte);
+}
+
+void FDownloadAutoTuner::Update(bool bInSaturated)
+{
+	const double Now = FPlatformTime::Seconds();
+	const double Elapsed = Now - IntervalStartTime;
+	if (!Settings.bEnabled || Elapsed < TUNE_INTERVAL)
+	{
+		return;
+	}
+	const double BytesPerSecond = IntervalByte / Elapsed;
+	IntervalStartTime = Now;
+	IntervalByte = 0;
+	if (!bInSaturated)
+	{
+		// not a sample of the network,measure again.
+		IntervalErrorCount = 0;
+		LastBytesPerSecond = 0;
+		bConnectionIncreased = false;
+		return;
+	}
+
+	if (IntervalErrorCount > 0)
+	{
+		ConnectionCount = FMath::Max(ConnectionCount / 2, Settings.MinConnectionCount);
+		bConnectionIncreased = false;
+		HoldInterval = CONNECTION_HOLD_INTERVAL;
+	}
+	else if (bConnectionIncreased && BytesPerSecond < LastBytesPerSecond * (1 + CONNECTION_IMPROVE_RATIO))
+	{
+		// the last connection not helps,the network is saturated.
+		ConnectionCount = FMath::Max(ConnectionCount - 1, Settings.MinConnectionCount);
+		bConnectionIncreased = false;
+		HoldInterval = CONNECTION_HOLD_INTERVAL;
+	}
+	else if (HoldInterval > 0)
+	{
+		--HoldInterval;
+		bConnectionIncreased = false;
+	}
+	else if (ConnectionCount < Settings.MaxConnectionCount)
+	{
+		++ConnectionCount;
+		bConnectionIncreased = true;
+	}
+	else
+	{
+		bConnectionIncreased = false;
+	}
+	IntervalErrorCount = 0;
+	LastBytesPerSecond = BytesPerSecond;
+
+#if WITH_LOG
+	UE_LOG(DownloadTookitLog, Log, TEXT("FDownloadAutoTuner:%.0f byte/s,ConnectionCount is %d,RequestByte is %lld."), BytesPerSecond, ConnectionCount, RequestByte);
+#endif
+}
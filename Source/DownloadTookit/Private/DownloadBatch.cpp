@@ -0,0 +1,444 @@
+#include "DownloadBatch.h"
+#include "DownloadManager.h"
+#include "DownloadVerifier.h"
+#include "DownloadTookitLog.h"
+
+// engine header
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+
+// files enqueued to the manager at once,the others wait in the batch.
+#define MAX_BATCH_ENQUEUED 16
+// a file smaller than it is downloaded by one connection
+#define BATCH_SEGMENTED_SIZE 1024*1024*64 // 64MB
+#define BATCH_HASH_BUFFER_SIZE 1024*1024 // 1MB
+
+UDownloadBatch::UDownloadBatch()
+	:Super(),
+	Status(EDownloadStatus::NotStarted),
+	Priority(EDownloadPriority::Normal),
+	ConnectionCount(1),
+	CopyingCount(0),
+	CompletedCount(0),
+	CompletedByte(0),
+	DownloadedByte(0),
+	TotalByte(0)
+{
+}
+
+void UDownloadBatch::Start(const TArray<FDownloadFile>& InManifest, EDownloadPriority InPriority, int32 InConnectionCount)
+{
+	Priority = InPriority;
+	ConnectionCount = FMath::Max(1, InConnectionCount);
+	Entries.Reset();
+	for (const FDownloadFile& DownloadFile : InManifest)
+	{
+		FDownloadBatchEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.File = DownloadFile;
+		Entry.Size = DownloadFile.Size;
+	}
+	Status = EDownloadStatus::Downloading;
+	int32 GroupCount = BuildGroups();
+	UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadBatch:%d files,%d of them are different."), Entries.Num(), GroupCount);
+
+	// hash the local files on worker threads,the result is handled on game thread.
+	TArray<FDownloadFile> Files;
+	for (const FDownloadBatchEntry& Entry : Entries)
+	{
+		Files.Add(Entry.File);
+	}
+	TWeakObjectPtr<UDownloadBatch> WeakThis(this);
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Files]()
+	{
+		TArray<bool> Matched;
+		Matched.SetNumZeroed(Files.Num());
+		ParallelFor(Files.Num(), [&Files, &Matched](int32 Index)
+		{
+			Matched[Index] = UDownloadBatch::IsLocalFileMatched(Files[Index]);
+		});
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Matched]()
+		{
+			UDownloadBatch* Batch = WeakThis.Get();
+			if (Batch && Batch->Status == EDownloadStatus::Downloading)
+			{
+				Batch->OnLocalFilesChecked(Matched);
+			}
+		});
+	});
+}
+
+int32 UDownloadBatch::BuildGroups()
+{
+	// same HASH is same content,same URL is same content unless the HASH is different.
+	TMap<FString, int32> HashPrimaries;
+	TMap<FString, int32> URLPrimaries;
+	int32 GroupCount = 0;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		FDownloadBatchEntry& Entry = Entries[Index];
+		FString Hash = Entry.File.HASH.ToLower();
+		const int32* PrimaryIndex = Hash.IsEmpty() ? NULL : HashPrimaries.Find(Hash);
+		if (!PrimaryIndex)
+		{
+			PrimaryIndex = URLPrimaries.Find(Entry.File.URL);
+			if (PrimaryIndex && !Hash.IsEmpty() && !Entries[*PrimaryIndex].File.HASH.IsEmpty() && !Entries[*PrimaryIndex].File.HASH.Equals(Hash, ESearchCase::IgnoreCase))
+			{
+				PrimaryIndex = NULL;
+			}
+		}
+		if (PrimaryIndex)
+		{
+			Entry.PrimaryIndex = *PrimaryIndex;
+			Entries[*PrimaryIndex].DuplicateIndices.Add(Index);
+			continue;
+		}
+		Entry.PrimaryIndex = Index;
+		++GroupCount;
+		if (!Hash.IsEmpty())
+		{
+			HashPrimaries.Add(Hash, Index);
+		}
+		URLPrimaries.FindOrAdd(Entry.File.URL) = Index;
+	}
+	return GroupCount;
+}
+
+void UDownloadBatch::OnLocalFilesChecked(const TArray<bool>& InMatched)
+{
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		Entries[Index].bLocalMatched = InMatched[Index];
+	}
+
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		FDownloadBatchEntry& Entry = Entries[Index];
+		if (Entry.PrimaryIndex != Index)
+			continue;
+		// a matched file of the group is copied to the others,the group is downloaded only if none matched.
+		int32 SourceIndex = Entry.bLocalMatched ? Index : INDEX_NONE;
+		for (int32 DuplicateIndex : Entry.DuplicateIndices)
+		{
+			if (SourceIndex == INDEX_NONE && Entries[DuplicateIndex].bLocalMatched)
+				SourceIndex = DuplicateIndex;
+		}
+		if (SourceIndex == INDEX_NONE)
+		{
+			PendingIndices.Add(Index);
+			TotalByte += Entry.Size;
+			continue;
+		}
+		if (SourceIndex != Index)
+		{
+			// the matched duplicate become the source of the group
+			Entries[SourceIndex].DuplicateIndices = Entry.DuplicateIndices;
+			Entries[SourceIndex].DuplicateIndices.Remove(SourceIndex);
+			Entries[SourceIndex].DuplicateIndices.Add(Index);
+			Entry.DuplicateIndices.Reset();
+		}
+		CompleteEntry(SourceIndex, EDownloadBatchFileStatus::Skipped);
+	}
+
+	// the largest file start first,unknown size is the last.
+	PendingIndices.StableSort([this](int32 Lhs, int32 Rhs) { return Entries[Lhs].Size > Entries[Rhs].Size; });
+	UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadBatch:%d files are skipped,%d files(%lld bytes) to download."), CompletedCount, PendingIndices.Num(), TotalByte);
+	Metrics.Start(TotalByte);
+	EnqueuePendingFiles();
+	CheckBatchComplete();
+}
+
+void UDownloadBatch::EnqueuePendingFiles()
+{
+	UDownloadManager* Manager = UDownloadManager::Get();
+	while (Manager && Status == EDownloadStatus::Downloading && ActiveProxies.Num() < MAX_BATCH_ENQUEUED && PendingIndices.Num())
+	{
+		int32 Index = PendingIndices[0];
+		PendingIndices.RemoveAt(0, 1, false);
+		FDownloadBatchEntry& Entry = Entries[Index];
+		int32 FileConnectionCount = Entry.Size >= BATCH_SEGMENTED_SIZE ? ConnectionCount : 1;
+		UDownloadProxy* Proxy = Manager->EnqueueDownload(Entry.File, Priority, FileConnectionCount);
+		Entry.Proxy = Proxy;
+		Entry.Status = EDownloadBatchFileStatus::Downloading;
+		ActiveProxies.Add(Proxy);
+		// the proxy may be finished while it is started
+		EDownloadStatus ProxyStatus = Proxy->GetDownloadStatus();
+		if (ProxyStatus == EDownloadStatus::Succeeded || ProxyStatus == EDownloadStatus::Failed || ProxyStatus == EDownloadStatus::Canceled)
+		{
+			OnFileComplete(Proxy, ProxyStatus == EDownloadStatus::Succeeded);
+			continue;
+		}
+		Proxy->OnDownloadCompleteDyMultiDlg.AddDynamic(this, &UDownloadBatch::OnFileComplete);
+		Proxy->OnDownloadCanceledDyMultiDlg.AddDynamic(this, &UDownloadBatch::OnFileCanceled);
+	}
+}
+
+void UDownloadBatch::OnFileComplete(UDownloadProxy* InProxy, bool bInSuccess)
+{
+	int32 Index = Entries.IndexOfByPredicate([InProxy](const FDownloadBatchEntry& Entry) { return Entry.Proxy == InProxy; });
+	InProxy->OnDownloadCompleteDyMultiDlg.RemoveDynamic(this, &UDownloadBatch::OnFileComplete);
+	InProxy->OnDownloadCanceledDyMultiDlg.RemoveDynamic(this, &UDownloadBatch::OnFileCanceled);
+	ActiveProxies.Remove(InProxy);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+	FDownloadBatchEntry& Entry = Entries[Index];
+	Entry.Proxy = nullptr;
+	FDownloadFile DownloadedFile = InProxy->GetDownloadedFileInfo();
+	Entry.Size = DownloadedFile.Size > 0 ? DownloadedFile.Size : Entry.Size;
+	CompletedByte += Entry.Size;
+	// the file of other content is not accepted
+	const FString& ExpectedHash = Entry.File.HASH;
+	if (bInSuccess && !ExpectedHash.IsEmpty() && !ExpectedHash.Equals(DownloadedFile.HASH, ESearchCase::IgnoreCase))
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("UDownloadBatch:the hash of %s is %s,expected %s."), *Entry.File.URL, *DownloadedFile.HASH, *ExpectedHash);
+		bInSuccess = false;
+	}
+	CompleteEntry(Index, bInSuccess ? EDownloadBatchFileStatus::Succeeded : EDownloadBatchFileStatus::Failed);
+	EnqueuePendingFiles();
+	CheckBatchComplete();
+}
+
+void UDownloadBatch::OnFileCanceled(UDownloadProxy* InProxy)
+{
+	// canceled out of the batch(by the manager or the proxy),the file is faild.
+	UE_LOG(DownloadTookitLog, Warning, TEXT("UDownloadBatch:a file of the batch is canceled."));
+	OnFileComplete(InProxy, false);
+}
+
+void UDownloadBatch::CompleteEntry(int32 InEntryIndex, EDownloadBatchFileStatus InStatus)
+{
+	FDownloadBatchEntry& Entry = Entries[InEntryIndex];
+	Entry.Status = InStatus;
+	++CompletedCount;
+	bool bSuccess = InStatus != EDownloadBatchFileStatus::Failed;
+	if (!bSuccess)
+	{
+		// the duplicates have no source
+		for (int32 DuplicateIndex : Entry.DuplicateIndices)
+		{
+			Entries[DuplicateIndex].Status = EDownloadBatchFileStatus::Failed;
+			++CompletedCount;
+		}
+	}
+	else if (Entry.DuplicateIndices.Num())
+	{
+		CopyDuplicates(InEntryIndex);
+	}
+
+	OnFileCompleteDyMultiDlg.Broadcast(this, Entry.File, bSuccess);
+	if (!bSuccess)
+	{
+		for (int32 DuplicateIndex : Entry.DuplicateIndices)
+		{
+			OnFileCompleteDyMultiDlg.Broadcast(this, Entries[DuplicateIndex].File, false);
+		}
+	}
+}
+
+void UDownloadBatch::CopyDuplicates(int32 InSourceIndex)
+{
+	const FDownloadBatchEntry& Source = Entries[InSourceIndex];
+	TArray<FString> TargetPaths;
+	for (int32 DuplicateIndex : Source.DuplicateIndices)
+	{
+		const FDownloadBatchEntry& Duplicate = Entries[DuplicateIndex];
+		// the matched file and the same path not need copy
+		bool bSkip = Duplicate.bLocalMatched || FPaths::IsSamePath(Duplicate.File.SavePath, Source.File.SavePath);
+		TargetPaths.Add(bSkip ? FString() : Duplicate.File.SavePath);
+	}
+
+	++CopyingCount;
+	FString SourcePath = Source.File.SavePath;
+	TWeakObjectPtr<UDownloadBatch> WeakThis(this);
+	Async(EAsyncExecution::ThreadPool, [WeakThis, InSourceIndex, SourcePath, TargetPaths]()
+	{
+		TArray<bool> Copied;
+		for (const FString& TargetPath : TargetPaths)
+		{
+			Copied.Add(TargetPath.IsEmpty() || IFileManager::Get().Copy(*TargetPath, *SourcePath) == COPY_OK);
+		}
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, InSourceIndex, Copied]()
+		{
+			UDownloadBatch* Batch = WeakThis.Get();
+			if (Batch)
+			{
+				Batch->OnDuplicatesCopied(InSourceIndex, Copied);
+			}
+		});
+	});
+}
+
+void UDownloadBatch::OnDuplicatesCopied(int32 InSourceIndex, const TArray<bool>& InCopied)
+{
+	--CopyingCount;
+	if (Status != EDownloadStatus::Downloading)
+	{
+		return;
+	}
+	const TArray<int32> DuplicateIndices = Entries[InSourceIndex].DuplicateIndices;
+	for (int32 Index = 0; Index < DuplicateIndices.Num(); ++Index)
+	{
+		FDownloadBatchEntry& Duplicate = Entries[DuplicateIndices[Index]];
+		Duplicate.Status = !InCopied[Index] ? EDownloadBatchFileStatus::Failed : (Duplicate.bLocalMatched ? EDownloadBatchFileStatus::Skipped : EDownloadBatchFileStatus::Copied);
+		++CompletedCount;
+		if (!InCopied[Index])
+		{
+			UE_LOG(DownloadTookitLog, Error, TEXT("UDownloadBatch:copy %s to %s faild."), *Entries[InSourceIndex].File.SavePath, *Duplicate.File.SavePath);
+		}
+		OnFileCompleteDyMultiDlg.Broadcast(this, Duplicate.File, InCopied[Index]);
+	}
+	CheckBatchComplete();
+}
+
+void UDownloadBatch::CheckBatchComplete()
+{
+	if (Status != EDownloadStatus::Downloading || CompletedCount < Entries.Num() || CopyingCount > 0)
+	{
+		return;
+	}
+	bool bSuccess = !Entries.ContainsByPredicate([](const FDownloadBatchEntry& Entry) { return Entry.Status == EDownloadBatchFileStatus::Failed; });
+	UpdateProgress();
+	Status = bSuccess ? EDownloadStatus::Succeeded : EDownloadStatus::Failed;
+	UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadBatch:batch of %d files is %s."), Entries.Num(), bSuccess ? TEXT("succeeded") : TEXT("faild"));
+	OnBatchCompleteDyMultiDlg.Broadcast(this, bSuccess);
+}
+
+void UDownloadBatch::Tick(float InDeltaTime)
+{
+	if (Status != EDownloadStatus::Downloading)
+	{
+		return;
+	}
+	UpdateProgress();
+	Metrics.Update();
+}
+
+void UDownloadBatch::UpdateProgress()
+{
+	int64 ActiveDownloadedByte = 0;
+	int64 ActiveTotalByte = 0;
+	for (const FDownloadBatchEntry& Entry : Entries)
+	{
+		if (!Entry.Proxy)
+			continue;
+		ActiveDownloadedByte += Entry.Proxy->GetDownloadedSize64();
+		ActiveTotalByte += Entry.Proxy->GetTotalSize64() > 0 ? Entry.Proxy->GetTotalSize64() : Entry.Size;
+	}
+	int64 PendingByte = 0;
+	for (int32 Index : PendingIndices)
+	{
+		PendingByte += Entries[Index].Size;
+	}
+	TotalByte = CompletedByte + ActiveTotalByte + PendingByte;
+
+	// the finished file is counted by its size,the difference is the bytes of this tick.
+	int64 NewDownloadedByte = CompletedByte + ActiveDownloadedByte;
+	if (NewDownloadedByte > DownloadedByte)
+	{
+		Metrics.AddReceivedByte(NewDownloadedByte - DownloadedByte);
+	}
+	else if (NewDownloadedByte < DownloadedByte)
+	{
+		Metrics.RemoveReceivedByte(DownloadedByte - NewDownloadedByte);
+	}
+	DownloadedByte = NewDownloadedByte;
+	Metrics.SetTotalByte(TotalByte);
+}
+
+void UDownloadBatch::Cancel()
+{
+	if (Status != EDownloadStatus::Downloading)
+	{
+		return;
+	}
+	Status = EDownloadStatus::Canceled;
+	PendingIndices.Reset();
+	UDownloadManager* Manager = UDownloadManager::Get();
+	TArray<UDownloadProxy*> CanceledProxies = ActiveProxies;
+	ActiveProxies.Reset();
+	for (UDownloadProxy* Proxy : CanceledProxies)
+	{
+		Proxy->OnDownloadCompleteDyMultiDlg.RemoveDynamic(this, &UDownloadBatch::OnFileComplete);
+		Proxy->OnDownloadCanceledDyMultiDlg.RemoveDynamic(this, &UDownloadBatch::OnFileCanceled);
+		if (Manager)
+		{
+			Manager->CancelDownload(Proxy);
+		}
+	}
+	for (FDownloadBatchEntry& Entry : Entries)
+	{
+		Entry.Proxy = nullptr;
+	}
+	UE_LOG(DownloadTookitLog, Warning, TEXT("UDownloadBatch:batch is canceled,%d of %d files are completed."), CompletedCount, Entries.Num());
+}
+
+EDownloadStatus UDownloadBatch::GetDownloadStatus()const
+{
+	return Status;
+}
+
+float UDownloadBatch::GetDownloadProgress()const
+{
+	if (Status == EDownloadStatus::Succeeded)
+	{
+		return 1.f;
+	}
+	return TotalByte > 0 ? (float)((double)DownloadedByte / TotalByte) : 0.f;
+}
+
+int64 UDownloadBatch::GetDownloadedSize64()const
+{
+	return DownloadedByte;
+}
+
+int64 UDownloadBatch::GetTotalSize64()const
+{
+	return TotalByte;
+}
+
+FDownloadMetrics UDownloadBatch::GetMetrics()const
+{
+	FDownloadMetrics Result = Metrics.GetMetrics();
+	for (const UDownloadProxy* Proxy : ActiveProxies)
+	{
+		if (Proxy)
+			Result.ConnectionCount += Proxy->GetMetrics().ConnectionCount;
+	}
+	return Result;
+}
+
+int32 UDownloadBatch::GetFileCount()const
+{
+	return Entries.Num();
+}
+
+int32 UDownloadBatch::GetCompletedFileCount()const
+{
+	return CompletedCount;
+}
+
+EDownloadBatchFileStatus UDownloadBatch::GetFileStatus(int32 InFileIndex)const
+{
+	return Entries.IsValidIndex(InFileIndex) ? Entries[InFileIndex].Status : EDownloadBatchFileStatus::Pending;
+}
+
+TArray<FDownloadFile> UDownloadBatch::GetFailedFiles()const
+{
+	TArray<FDownloadFile> FailedFiles;
+	for (const FDownloadBatchEntry& Entry : Entries)
+	{
+		if (Entry.Status == EDownloadBatchFileStatus::Failed)
+			FailedFiles.Add(Entry.File);
+	}
+	return FailedFiles;
+}
+
+bool UDownloadBatch::IsLocalFileMatched(const FDownloadFile& InDownloadFile)
+{
+	// without HASH the file could not be trusted,the proxy revalidate it by the metadata cache.
+	FDownloadVerifySettings Settings;
+	Settings.ReadBufferSize = BATCH_HASH_BUFFER_SIZE;
+	return UDownloadVerifier::VerifyFile(InDownloadFile, Settings, [](int64) { return true; }) == EDownloadVerifyStatus::Matched;
+}
@@ -0,0 +1,89 @@
+#include "DownloadBufferPool.h"
+#include "DownloadTookitStats.h"
+
+#define MAX_POOLED_BUFFER 16
+
+FDownloadBufferPool::FDownloadBufferPool(int32 InMaxPooledBuffer)
+	: MaxPooledBuffer(InMaxPooledBuffer > 0 ? InMaxPooledBuffer : MAX_POOLED_BUFFER),
+	PooledByte(0)
+{
+}
+
+FDownloadBufferPool::~FDownloadBufferPool()
+{
+	Reset();
+}
+
+FDownloadBufferPtr FDownloadBufferPool::Acquire(int64 InLength)
+{
+	check(InLength >= 0 && InLength <= MAX_int32);
+	// prefer the smallest idle buffer large enough,avoid realloc.
+	FDownloadBufferPtr* Found = NULL;
+	for (FDownloadBufferPtr& Buffer : Buffers)
+	{
+		if (!Buffer.IsUnique())
+			continue;
+		if (!Found)
+		{
+			Found = &Buffer;
+			continue;
+		}
+		const int32 FoundMax = (*Found)->Max();
+		const int32 BufferMax = Buffer->Max();
+		bool bFoundFit = FoundMax >= InLength;
+		bool bBufferFit = BufferMax >= InLength;
+		if ((bBufferFit && (!bFoundFit || BufferMax < FoundMax)) || (!bFoundFit && !bBufferFit && BufferMax > FoundMax))
+		{
+			Found = &Buffer;
+		}
+	}
+
+	FDownloadBufferPtr Result;
+	if (Found)
+	{
+		Result = *Found;
+	}
+	else
+	{
+		Result = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+		if (Buffers.Num() < MaxPooledBuffer)
+		{
+			Buffers.Add(Result);
+		}
+	}
+	Result->SetNumUninitialized((int32)InLength, false);
+	UpdateMemoryStat();
+	return Result;
+}
+
+void FDownloadBufferPool::Trim()
+{
+	Buffers.RemoveAll([](const FDownloadBufferPtr& Buffer) { return Buffer.IsUnique(); });
+	UpdateMemoryStat();
+}
+
+void FDownloadBufferPool::Reset()
+{
+	// the buffers still used by stages are freed after released.
+	Buffers.Empty();
+	UpdateMemoryStat();
+}
+
+void FDownloadBufferPool::UpdateMemoryStat()
+{
+	int64 Byte = 0;
+	for (const FDownloadBufferPtr& Buffer : Buffers)
+	{
+		Byte += Buffer->GetAllocatedSize();
+	}
+	// the counter is shared by all pools
+	if (Byte > PooledByte)
+	{
+		INC_MEMORY_STAT_BY(STAT_DownloadPooledMemory, Byte - PooledByte);
+	}
+	else if (Byte < PooledByte)
+	{
+		DEC_MEMORY_STAT_BY(STAT_DownloadPooledMemory, PooledByte - Byte);
+	}
+	PooledByte = Byte;
+}
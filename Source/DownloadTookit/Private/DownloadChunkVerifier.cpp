@@ -0,0 +1,200 @@
+#include "DownloadChunkVerifier.h"
+#include "DownloadTookitLog.h"
+#include "DownloadTookitStats.h"
+
+// engine header
+#include "Async/Async.h"
+#include "Misc/ScopeLock.h"
+
+DECLARE_CYCLE_STAT(TEXT("Verify Chunk"), STAT_DownloadVerifyChunk, STATGROUP_DownloadTookit);
+
+FDownloadChunkVerifier::FDownloadChunkVerifier(EDownloadHashAlgorithm InAlgorithm, const TArray<FString>& InChunkHashes, const FString& InMerkleRoot)
+	: Algorithm(InAlgorithm),
+	ChunkHashes(InChunkHashes),
+	MerkleRoot(InMerkleRoot)
+{
+}
+
+bool FDownloadChunkVerifier::Prepare(int32 InChunkCount)
+{
+	if (ChunkHashes.Num() && ChunkHashes.Num() != InChunkCount)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadChunkVerifier:chunk hash count is %d,but the file has %d chunks."), ChunkHashes.Num(), InChunkCount);
+		return false;
+	}
+	if (ChunkHashes.Num() && !MerkleRoot.IsEmpty() && !MerkleRoot.Equals(CalcMerkleRoot(Algorithm, ChunkHashes), ESearchCase::IgnoreCase))
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadChunkVerifier:chunk hash list not match the root %s."), *MerkleRoot);
+		return false;
+	}
+	LeafHashes.Reset();
+	LeafHashes.SetNum(InChunkCount);
+	ChunkStates.Reset();
+	for (int32 ChunkIndex = 0; ChunkIndex < InChunkCount; ++ChunkIndex)
+	{
+		TSharedRef<FChunkState, ESPMode::ThreadSafe> State = MakeShared<FChunkState, ESPMode::ThreadSafe>();
+		State->ChunkIndex = ChunkIndex;
+		ChunkStates.Add(State);
+	}
+	return true;
+}
+
+void FDownloadChunkVerifier::Update(int32 InChunkIndex, const FDownloadBufferPtr& InBuffer)
+{
+	FChunkCommand Command;
+	Command.Buffer = InBuffer;
+	AddCommand(InChunkIndex, MoveTemp(Command));
+}
+
+void FDownloadChunkVerifier::VerifyChunk(int32 InChunkIndex, TFunction<void(int32, bool)> InOnVerified)
+{
+	FChunkCommand Command;
+	Command.OnVerified = MoveTemp(InOnVerified);
+	AddCommand(InChunkIndex, MoveTemp(Command));
+}
+
+void FDownloadChunkVerifier::AddCommand(int32 InChunkIndex, FChunkCommand&& InCommand)
+{
+	if (!ChunkStates.IsValidIndex(InChunkIndex))
+	{
+		return;
+	}
+	TSharedRef<FChunkState, ESPMode::ThreadSafe> State = ChunkStates[InChunkIndex];
+	{
+		FScopeLock ScopeLock(&State->Lock);
+		State->Commands.Add(MoveTemp(InCommand));
+		// the running task consume it
+		if (State->bScheduled)
+		{
+			return;
+		}
+		State->bScheduled = true;
+	}
+	TSharedRef<FDownloadChunkVerifier, ESPMode::ThreadSafe> Verifier = AsShared();
+	Async(EAsyncExecution::ThreadPool, [Verifier, State]()
+	{
+		ProcessCommands(Verifier, State);
+	});
+}
+
+void FDownloadChunkVerifier::ProcessCommands(TSharedRef<FDownloadChunkVerifier, ESPMode::ThreadSafe> InVerifier, TSharedRef<FChunkState, ESPMode::ThreadSafe> InState)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadVerifyChunk);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadChunkVerifier Verify"));
+	while (true)
+	{
+		FChunkCommand Command;
+		{
+			FScopeLock ScopeLock(&InState->Lock);
+			if (!InState->Commands.Num())
+			{
+				InState->bScheduled = false;
+				return;
+			}
+			Command = MoveTemp(InState->Commands[0]);
+			InState->Commands.RemoveAt(0, 1, false);
+		}
+		if (!InState->Hasher.IsValid())
+		{
+			InState->Hasher = IDownloadHasher::Create(InVerifier->Algorithm);
+		}
+		if (Command.Buffer.IsValid())
+		{
+			if (InState->Hasher.IsValid())
+			{
+				InState->Hasher->Update(Command.Buffer->GetData(), Command.Buffer->Num());
+			}
+			continue;
+		}
+		// the end of chunk,a chunk fetched again is hashed from its begin.
+		FString Digest = InState->Hasher.IsValid() ? InState->Hasher->Final() : FString();
+		InState->Hasher.Reset();
+		const int32 ChunkIndex = InState->ChunkIndex;
+		AsyncTask(ENamedThreads::GameThread, [InVerifier, ChunkIndex, Digest, OnVerified = MoveTemp(Command.OnVerified)]()
+		{
+			InVerifier->OnChunkHashed(ChunkIndex, Digest, OnVerified);
+		});
+	}
+}
+
+void FDownloadChunkVerifier::OnChunkHashed(int32 InChunkIndex, const FString& InDigest, TFunction<void(int32, bool)> InOnVerified)
+{
+	bool bVerified = !InDigest.IsEmpty() && LeafHashes.IsValidIndex(InChunkIndex);
+	if (bVerified)
+	{
+		LeafHashes[InChunkIndex] = InDigest;
+		if (ChunkHashes.Num())
+		{
+			bVerified = InDigest.Equals(ChunkHashes[InChunkIndex], ESearchCase::IgnoreCase);
+		}
+	}
+	if (!bVerified)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadChunkVerifier:chunk %d is corrupted,digest is %s."), InChunkIndex, *InDigest);
+	}
+	if (InOnVerified)
+		InOnVerified(InChunkIndex, bVerified);
+}
+
+void FDownloadChunkVerifier::RestoreLeafHashes(const TArray<FString>& InLeafHashes)
+{
+	if (InLeafHashes.Num() == LeafHashes.Num())
+	{
+		LeafHashes = InLeafHashes;
+	}
+}
+
+bool FDownloadChunkVerifier::VerifyMerkleRoot()const
+{
+	if (MerkleRoot.IsEmpty())
+	{
+		return true;
+	}
+	FString CalcedRoot = CalcMerkleRoot(Algorithm, LeafHashes);
+	bool bVerified = MerkleRoot.Equals(CalcedRoot, ESearchCase::IgnoreCase);
+	if (!bVerified)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadChunkVerifier:root is %s,calced root is %s."), *MerkleRoot, *CalcedRoot);
+	}
+	return bVerified;
+}
+
+FString FDownloadChunkVerifier::CalcMerkleRoot(EDownloadHashAlgorithm InAlgorithm, const TArray<FString>& InLeafHashes)
+{
+	TUniquePtr<IDownloadHasher> Hasher = IDownloadHasher::Create(InAlgorithm);
+	if (!Hasher.IsValid() || !InLeafHashes.Num())
+	{
+		return FString();
+	}
+
+	TArray<TArray<uint8>> Level;
+	for (const FString& LeafHash : InLeafHashes)
+	{
+		TArray<uint8>& Node = Level.AddDefaulted_GetRef();
+		Node.SetNumZeroed((LeafHash.Len() + 1) / 2);
+		HexToBytes(LeafHash, Node.GetData());
+	}
+
+	while (Level.Num() > 1)
+	{
+		TArray<TArray<uint8>> NextLevel;
+		for (int32 Index = 0; Index < Level.Num(); Index += 2)
+		{
+			if (Index + 1 == Level.Num())
+			{
+				NextLevel.Add(MoveTemp(Level[Index]));
+				break;
+			}
+			Hasher->Reset();
+			Hasher->Update(Level[Index].GetData(), Level[Index].Num());
+			Hasher->Update(Level[Index + 1].GetData(), Level[Index + 1].Num());
+			FString Digest = Hasher->Final();
+
+			TArray<uint8>& Node = NextLevel.AddDefaulted_GetRef();
+			Node.SetNumZeroed(Digest.Len() / 2);
+			HexToBytes(Digest, Node.GetData());
+		}
+		Level = MoveTemp(NextLevel);
+	}
+	return IDownloadHasher::ToHexString(Level[0].GetData(), Level[0].Num());
+}
@@ -0,0 +1,351 @@
+#include "DownloadContentStore.h"
+#include "DownloadTookitLog.h"
+
+// engine header
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#if PLATFORM_LINUX
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/ioctl.h>
+	#ifndef FICLONE
+		#define FICLONE _IOW(0x94, 9, int)
+	#endif
+#elif PLATFORM_MAC
+	#include <unistd.h>
+	#include <sys/clonefile.h>
+#endif
+
+#define CONTENT_STORE_MAGIC 0x53435444 // DTCS
+#define CONTENT_STORE_VERSION 2 // 2:ModifiedTime
+#define CONTENT_STORE_SAVE_DELAY 1.0f // second
+
+FArchive& operator<<(FArchive& Ar, FDownloadContentEntry& Entry)
+{
+	uint8 Algorithm = (uint8)Entry.Algorithm;
+	Ar << Algorithm << Entry.Digest << Entry.Size << Entry.LastAccessTime;
+	Entry.Algorithm = (EDownloadHashAlgorithm)Algorithm;
+	return Ar;
+}
+
+FDownloadContentStore& FDownloadContentStore::Get()
+{
+	static FDownloadContentStore Instance;
+	return Instance;
+}
+
+FDownloadContentStore::FDownloadContentStore()
+	: Capacity(0),
+	StoredSize(0),
+	bLoaded(false)
+{
+}
+
+FString FDownloadContentStore::GetStoreDir()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("DownloadTookit"), TEXT("ContentStore"));
+}
+
+FString FDownloadContentStore::GetEntryKey(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest)
+{
+	return IDownloadHasher::GetAlgorithmName(InAlgorithm) + TEXT(":") + InDigest.ToLower();
+}
+
+FString FDownloadContentStore::GetObjectPath(const FDownloadContentEntry& InEntry)const
+{
+	// fan out by the first byte of digest,so a directory not hold too many files.
+	return FPaths::Combine(GetStoreDir(), IDownloadHasher::GetAlgorithmName(InEntry.Algorithm), InEntry.Digest.Left(2), InEntry.Digest);
+}
+
+void FDownloadContentStore::SetCapacity(int64 InCapacity)
+{
+	Capacity = FMath::Max<int64>(0, InCapacity);
+	if (IsEnabled())
+	{
+		Load();
+		Evict();
+	}
+}
+
+FString FDownloadContentStore::Find(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest, int64& OutSize)
+{
+	OutSize = 0;
+	if (!IsEnabled() || InDigest.IsEmpty())
+	{
+		return FString();
+	}
+	Load();
+	FString Key = GetEntryKey(InAlgorithm, InDigest);
+	FDownloadContentEntry* Entry = Entries.Find(Key);
+	if (!Entry)
+	{
+		return FString();
+	}
+	// the stored file is deleted or changed outside
+	FString ObjectPath = GetObjectPath(*Entry);
+	if (IFileManager::Get().FileSize(*ObjectPath) != Entry->Size || GetModifiedTime(ObjectPath) != Entry->ModifiedTime)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadContentStore:%s is missing or changed,remove it from the store."), *ObjectPath);
+		Remove(InAlgorithm, InDigest);
+		return FString();
+	}
+	Entry->LastAccessTime = FDateTime::UtcNow().GetTicks();
+	OutSize = Entry->Size;
+	++PinnedKeys.FindOrAdd(Key);
+	MarkDirty();
+	return ObjectPath;
+}
+
+void FDownloadContentStore::Release(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest)
+{
+	FString Key = GetEntryKey(InAlgorithm, InDigest);
+	int32* PinCount = PinnedKeys.Find(Key);
+	if (!PinCount)
+	{
+		return;
+	}
+	if (--(*PinCount) <= 0)
+	{
+		PinnedKeys.Remove(Key);
+		// the pinned files may be skipped by last eviction
+		Evict();
+	}
+}
+
+void FDownloadContentStore::Add(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest, const FString& InFilePath)
+{
+	if (!IsEnabled() || InDigest.IsEmpty())
+	{
+		return;
+	}
+	Load();
+	FString Key = GetEntryKey(InAlgorithm, InDigest);
+	if (Entries.Contains(Key) || AddingKeys.Contains(Key))
+	{
+		return;
+	}
+	FDownloadContentEntry Entry;
+	Entry.Algorithm = InAlgorithm;
+	Entry.Digest = InDigest.ToLower();
+	Entry.Size = IFileManager::Get().FileSize(*InFilePath);
+	// a file larger than the store is never kept
+	if (Entry.Size < 0 || Entry.Size > Capacity)
+	{
+		return;
+	}
+	AddingKeys.Add(Key);
+
+	// the file is copied on a worker thread if it could not be cloned
+	FString ObjectPath = GetObjectPath(Entry);
+	Async(EAsyncExecution::ThreadPool, [Entry, ObjectPath, InFilePath]() mutable
+	{
+		bool bAdded = FDownloadContentStore::CloneFile(ObjectPath, InFilePath);
+		Entry.ModifiedTime = GetModifiedTime(ObjectPath);
+		AsyncTask(ENamedThreads::GameThread, [Entry, bAdded]()
+		{
+			FDownloadContentStore::Get().OnAdded(Entry, bAdded);
+		});
+	});
+}
+
+void FDownloadContentStore::OnAdded(const FDownloadContentEntry& InEntry, bool bInAdded)
+{
+	FString Key = GetEntryKey(InEntry.Algorithm, InEntry.Digest);
+	AddingKeys.Remove(Key);
+	if (!bInAdded)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadContentStore:store %s faild."), *Key);
+		return;
+	}
+	FDownloadContentEntry& Entry = Entries.Add(Key, InEntry);
+	Entry.LastAccessTime = FDateTime::UtcNow().GetTicks();
+	StoredSize += Entry.Size;
+	Evict();
+	MarkDirty();
+}
+
+void FDownloadContentStore::Remove(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest)
+{
+	Load();
+	FString Key = GetEntryKey(InAlgorithm, InDigest);
+	FDownloadContentEntry Entry;
+	if (Entries.RemoveAndCopyValue(Key, Entry))
+	{
+		StoredSize -= Entry.Size;
+		IFileManager::Get().Delete(*GetObjectPath(Entry), false, true, true);
+		MarkDirty();
+	}
+}
+
+void FDownloadContentStore::Evict()
+{
+	if (StoredSize <= Capacity)
+	{
+		return;
+	}
+	// the least recently used first
+	TArray<FDownloadContentEntry> SortedEntries;
+	Entries.GenerateValueArray(SortedEntries);
+	SortedEntries.Sort([](const FDownloadContentEntry& Lhs, const FDownloadContentEntry& Rhs) { return Lhs.LastAccessTime < Rhs.LastAccessTime; });
+	int32 EvictedCount = 0;
+	for (const FDownloadContentEntry& Entry : SortedEntries)
+	{
+		if (StoredSize <= Capacity)
+			break;
+		// the file is being fetched
+		if (PinnedKeys.Contains(GetEntryKey(Entry.Algorithm, Entry.Digest)))
+			continue;
+		Remove(Entry.Algorithm, Entry.Digest);
+		++EvictedCount;
+	}
+	UE_LOG(DownloadTookitLog, Log, TEXT("FDownloadContentStore:%d files are evicted,%lld bytes stored."), EvictedCount, StoredSize);
+}
+
+void FDownloadContentStore::Flush()
+{
+	if (SaveDelegateHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(SaveDelegateHandle);
+		SaveDelegateHandle.Reset();
+		Save();
+	}
+}
+
+int64 FDownloadContentStore::GetModifiedTime(const FString& InFilePath)
+{
+	FDateTime TimeStamp = IFileManager::Get().GetTimeStamp(*InFilePath);
+	return TimeStamp == FDateTime::MinValue() ? 0 : TimeStamp.GetTicks();
+}
+
+bool FDownloadContentStore::CloneFile(const FString& InTargetPath, const FString& InSourcePath)
+{
+	IFileManager& FileManager = IFileManager::Get();
+	FileManager.MakeDirectory(*FPaths::GetPath(InTargetPath), true);
+	FileManager.Delete(*InTargetPath, false, true, true);
+	const FString TargetPath = FPaths::ConvertRelativePathToFull(InTargetPath);
+	const FString SourcePath = FPaths::ConvertRelativePathToFull(InSourcePath);
+	bool bCloned = false;
+#if PLATFORM_LINUX
+	// clone the extents on btrfs/xfs
+	int SourceFile = open(TCHAR_TO_UTF8(*SourcePath), O_RDONLY);
+	if (SourceFile >= 0)
+	{
+		int TargetFile = open(TCHAR_TO_UTF8(*TargetPath), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (TargetFile >= 0)
+		{
+			bCloned = ioctl(TargetFile, FICLONE, SourceFile) == 0;
+			close(TargetFile);
+			if (!bCloned)
+			{
+				unlink(TCHAR_TO_UTF8(*TargetPath));
+			}
+		}
+		close(SourceFile);
+	}
+#elif PLATFORM_MAC
+	// clone on APFS
+	bCloned = clonefile(TCHAR_TO_UTF8(*SourcePath), TCHAR_TO_UTF8(*TargetPath), 0) == 0;
+#endif
+	// different volume or not supported
+	return bCloned || FileManager.Copy(*InTargetPath, *InSourcePath) == COPY_OK;
+}
+
+void FDownloadContentStore::Load()
+{
+	if (bLoaded)
+	{
+		return;
+	}
+	bLoaded = true;
+	TArray<uint8> Data;
+	FString IndexPath = FPaths::Combine(GetStoreDir(), TEXT("Index.bin"));
+	if (!FFileHelper::LoadFileToArray(Data, *IndexPath, FILEREAD_Silent))
+	{
+		return;
+	}
+	FMemoryReader Reader(Data);
+	Serialize(Reader);
+	if (Reader.IsError())
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadContentStore:%s is corrupted."), *IndexPath);
+		Entries.Reset();
+		StoredSize = 0;
+	}
+}
+
+bool FDownloadContentStore::Save()
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	Serialize(Writer);
+
+	FString IndexPath = FPaths::Combine(GetStoreDir(), TEXT("Index.bin"));
+	FString TempPath = IndexPath + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Data, *TempPath) || !IFileManager::Get().Move(*IndexPath, *TempPath, true, true))
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadContentStore:save %s faild."), *IndexPath);
+		return false;
+	}
+	return true;
+}
+
+void FDownloadContentStore::MarkDirty()
+{
+	if (!SaveDelegateHandle.IsValid())
+	{
+		SaveDelegateHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FDownloadContentStore::OnSaveTick), CONTENT_STORE_SAVE_DELAY);
+	}
+}
+
+bool FDownloadContentStore::OnSaveTick(float InDeltaTime)
+{
+	SaveDelegateHandle.Reset();
+	Save();
+	// save once
+	return false;
+}
+
+void FDownloadContentStore::Serialize(FArchive& Ar)
+{
+	uint32 Magic = CONTENT_STORE_MAGIC;
+	int32 Version = CONTENT_STORE_VERSION;
+	Ar << Magic << Version;
+	if (Ar.IsLoading() && (Magic != CONTENT_STORE_MAGIC || Version < 1 || Version > CONTENT_STORE_VERSION))
+	{
+		Ar.SetError();
+		return;
+	}
+	int32 EntryCount = Entries.Num();
+	Ar << EntryCount;
+	if (Ar.IsLoading())
+	{
+		Entries.Reset();
+		Entries.Reserve(EntryCount);
+		StoredSize = 0;
+		for (int32 Index = 0; Index < EntryCount && !Ar.IsError(); ++Index)
+		{
+			FDownloadContentEntry Entry;
+			Ar << Entry;
+			// the files of version 1 may be hard linked,they are dropped at first find.
+			if (Version >= 2)
+			{
+				Ar << Entry.ModifiedTime;
+			}
+			StoredSize += Entry.Size;
+			Entries.Add(GetEntryKey(Entry.Algorithm, Entry.Digest), Entry);
+		}
+	}
+	else
+	{
+		for (auto& Entry : Entries)
+		{
+			Ar << Entry.Value << Entry.Value.ModifiedTime;
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#include "DownloadDecodeStage.h"
+#include "DownloadTookitLog.h"
+#include "DownloadTookitStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Decode"), STAT_DownloadDecode, STATGROUP_DownloadTookit);
+
+// decoded bytes are handed over in buffers of this size
+#define DECODE_BUFFER_SIZE 1024*1024 // 1MB
+
+FDownloadDecodeStage::FDownloadDecodeStage(EDownloadContentEncoding InEncoding, const TArray<TSharedPtr<FDownloadStage, ESPMode::ThreadSafe>>& InNextStages)
+	: FDownloadStage(TEXT("DownloadDecodeStage")),
+	Encoding(InEncoding),
+	NextStages(InNextStages),
+	InputOffset(0),
+	OutputOffset(0)
+{
+}
+
+FDownloadDecodeStage::~FDownloadDecodeStage()
+{
+	StopThread();
+}
+
+bool FDownloadDecodeStage::OnStart()
+{
+	Decoder = IDownloadDecoder::Create(Encoding);
+	return Decoder.IsValid();
+}
+
+void FDownloadDecodeStage::OnBuffer(int64 InOffset, const TArray<uint8>& InData)
+{
+	if (InOffset != InputOffset)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadDecodeStage:buffer at %lld is out of order,decoded offset is %lld."), InOffset, InputOffset);
+		SetError();
+		return;
+	}
+	InputOffset += InData.Num();
+	SCOPE_CYCLE_COUNTER(STAT_DownloadDecode);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadDecodeStage Decode"));
+	bool bDecoded = Decoder->Decode(InData.GetData(), InData.Num(), [this](const uint8* InOutput, int64 InLength)
+	{
+		return AppendOutput(InOutput, InLength);
+	});
+	if (!bDecoded)
+	{
+		SetError();
+	}
+}
+
+void FDownloadDecodeStage::OnFinish()
+{
+	if (IsStopping() || HasError())
+	{
+		return;
+	}
+	if (!Decoder->Finish())
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadDecodeStage:the stream is truncated at %lld."), InputOffset);
+		SetError();
+		return;
+	}
+	if (!FlushOutput())
+	{
+		SetError();
+		return;
+	}
+	UE_LOG(DownloadTookitLog, Log, TEXT("FDownloadDecodeStage:%lld bytes are decoded to %lld bytes."), InputOffset, OutputOffset);
+}
+
+bool FDownloadDecodeStage::AppendOutput(const uint8* InData, int64 InLength)
+{
+	while (InLength > 0)
+	{
+		if (!Output.IsValid())
+		{
+			Output = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+			Output->Reserve(DECODE_BUFFER_SIZE);
+		}
+		int64 CopyLength = FMath::Min<int64>(InLength, DECODE_BUFFER_SIZE - Output->Num());
+		Output->Append(InData, (int32)CopyLength);
+		InData += CopyLength;
+		InLength -= CopyLength;
+		if (Output->Num() >= DECODE_BUFFER_SIZE && !FlushOutput())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FDownloadDecodeStage::FlushOutput()
+{
+	if (!Output.IsValid() || !Output->Num())
+	{
+		return true;
+	}
+	// the buffer is shared by the next stages,a new one is used for the next output.
+	for (const TSharedPtr<FDownloadStage, ESPMode::ThreadSafe>& NextStage : NextStages)
+	{
+		if (!NextStage->Enqueue(OutputOffset, Output))
+		{
+			UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadDecodeStage:the next stage is faild at %lld."), OutputOffset);
+			return false;
+		}
+	}
+	OutputOffset += Output->Num();
+	Output.Reset();
+	return true;
+}
@@ -0,0 +1,112 @@
+#include "DownloadDecoder.h"
+#include "DownloadTookitLog.h"
+
+// engine header
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+#define DECODE_OUTPUT_SIZE 1024*256 // 256KB
+
+namespace DownloadDecoder
+{
+	class FZlibDecoder : public IDownloadDecoder
+	{
+	public:
+		explicit FZlibDecoder(bool bInGzip)
+			: bGzip(bInGzip),
+			bInitialized(false),
+			bStreamEnd(false)
+		{
+			FMemory::Memzero(Stream);
+			// 32 enable the gzip/zlib header detection
+			bInitialized = inflateInit2(&Stream, bGzip ? MAX_WBITS + 32 : MAX_WBITS) == Z_OK;
+			Output.SetNumUninitialized(DECODE_OUTPUT_SIZE);
+		}
+		virtual ~FZlibDecoder()
+		{
+			if (bInitialized)
+			{
+				inflateEnd(&Stream);
+			}
+		}
+
+		virtual bool Decode(const uint8* InData, int64 InLength, TFunctionRef<bool(const uint8*, int64)> InOnOutput)override
+		{
+			if (!bInitialized)
+			{
+				return false;
+			}
+			// avail_in is 32 bits
+			while (InLength > 0)
+			{
+				uInt InputLength = (uInt)FMath::Min<int64>(InLength, MAX_uint32);
+				Stream.next_in = (Bytef*)InData;
+				Stream.avail_in = InputLength;
+				while (Stream.avail_in > 0)
+				{
+					// a gzip file may be several members
+					if (bStreamEnd)
+					{
+						if (!bGzip || inflateReset(&Stream) != Z_OK)
+						{
+							UE_LOG(DownloadTookitLog, Error, TEXT("FZlibDecoder:data after the end of stream."));
+							return false;
+						}
+						bStreamEnd = false;
+					}
+					Stream.next_out = Output.GetData();
+					Stream.avail_out = Output.Num();
+					int Result = inflate(&Stream, Z_NO_FLUSH);
+					if (Result != Z_OK && Result != Z_STREAM_END && Result != Z_BUF_ERROR)
+					{
+						UE_LOG(DownloadTookitLog, Error, TEXT("FZlibDecoder:inflate faild,%d."), Result);
+						return false;
+					}
+					bStreamEnd = Result == Z_STREAM_END;
+					int64 OutputLength = Output.Num() - Stream.avail_out;
+					// no progress with the input left
+					if (Result == Z_BUF_ERROR && OutputLength == 0)
+					{
+						UE_LOG(DownloadTookitLog, Error, TEXT("FZlibDecoder:the stream is corrupted."));
+						return false;
+					}
+					if (OutputLength > 0 && !InOnOutput(Output.GetData(), OutputLength))
+					{
+						return false;
+					}
+				}
+				InData += InputLength;
+				InLength -= InputLength;
+			}
+			return true;
+		}
+
+		virtual bool Finish()override
+		{
+			// the output is flushed by Decode,the stream must be ended.
+			return bInitialized && bStreamEnd;
+		}
+
+	private:
+		z_stream Stream;
+		bool bGzip;
+		bool bInitialized;
+		bool bStreamEnd;
+		TArray<uint8> Output;
+	};
+}
+
+TUniquePtr<IDownloadDecoder> IDownloadDecoder::Create(EDownloadContentEncoding InEncoding)
+{
+	switch (InEncoding)
+	{
+	case EDownloadContentEncoding::Gzip:
+		return MakeUnique<DownloadDecoder::FZlibDecoder>(true);
+	case EDownloadContentEncoding::Zlib:
+		return MakeUnique<DownloadDecoder::FZlibDecoder>(false);
+	default:
+		UE_LOG(DownloadTookitLog, Error, TEXT("IDownloadDecoder:encoding %d is not supported."), (int32)InEncoding);
+		return nullptr;
+	}
+}
@@ -0,0 +1,282 @@
+#include "DownloadDelta.h"
+#include "DownloadTookitLog.h"
+
+// engine header
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Templates/UniquePtr.h"
+
+#define DELTA_INDEX_MAGIC 0x49445444 // DTDI
+#define DELTA_INDEX_VERSION 1
+#define MAX_DELTA_BLOCK_SIZE 1024*1024*16 // 16MB
+// the old file is scanned in regions of this size by each worker
+#define DELTA_SCAN_REGION_SIZE 1024*1024*16 // 16MB
+
+namespace DownloadDelta
+{
+	// rsync checksum,a is the sum of bytes,b is the sum of a at every byte.
+	struct FRollingChecksum
+	{
+		uint32 A = 0;
+		uint32 B = 0;
+		int32 Length = 0;
+
+		void Init(const uint8* InData, int32 InLength)
+		{
+			A = 0;
+			B = 0;
+			Length = InLength;
+			for (int32 Index = 0; Index < InLength; ++Index)
+			{
+				A += InData[Index];
+				B += (uint32)(InLength - Index) * InData[Index];
+			}
+		}
+		void Roll(uint8 InOut, uint8 InIn)
+		{
+			A = A - InOut + InIn;
+			B = B - (uint32)Length * InOut + A;
+		}
+		uint32 Get()const { return (A & 0xffff) | (B << 16); }
+	};
+}
+
+int32 FDownloadDeltaIndex::GetBlockCount()const
+{
+	return BlockSize > 0 ? (int32)FMath::DivideAndRoundUp(FileSize, (int64)BlockSize) : 0;
+}
+
+int64 FDownloadDeltaIndex::GetBlockLength(int32 InBlockIndex)const
+{
+	return FMath::Min<int64>(BlockSize, FileSize - (int64)InBlockIndex * BlockSize);
+}
+
+uint32 FDownloadDeltaIndex::CalcWeakChecksum(const uint8* InData, int32 InLength)
+{
+	DownloadDelta::FRollingChecksum Checksum;
+	Checksum.Init(InData, InLength);
+	return Checksum.Get();
+}
+
+bool FDownloadDeltaIndex::Load(const TArray<uint8>& InData)
+{
+	FMemoryReader Reader(InData);
+	Serialize(Reader);
+	if (Reader.IsError() || BlockSize <= 0 || BlockSize > MAX_DELTA_BLOCK_SIZE || FileSize <= 0 ||
+		WeakChecksums.Num() != GetBlockCount() || StrongChecksums.Num() != GetBlockCount())
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadDeltaIndex:the index is corrupted."));
+		return false;
+	}
+	return true;
+}
+
+bool FDownloadDeltaIndex::Save(const FString& InIndexPath)
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	Serialize(Writer);
+	return FFileHelper::SaveArrayToFile(Data, *InIndexPath);
+}
+
+bool FDownloadDeltaIndex::Build(const FString& InFilePath, int32 InBlockSize, FDownloadDeltaIndex& OutIndex)
+{
+	TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*InFilePath));
+	if (!FileHandle.IsValid() || InBlockSize <= 0 || InBlockSize > MAX_DELTA_BLOCK_SIZE)
+	{
+		return false;
+	}
+	OutIndex = FDownloadDeltaIndex();
+	OutIndex.FileSize = FileHandle->Size();
+	OutIndex.BlockSize = InBlockSize;
+
+	TUniquePtr<IDownloadHasher> BlockHasher = IDownloadHasher::Create(OutIndex.BlockHashAlgorithm);
+	TUniquePtr<IDownloadHasher> FileHasher = IDownloadHasher::Create(OutIndex.FileHashAlgorithm);
+	TArray<uint8> Block;
+	Block.SetNumUninitialized(InBlockSize);
+	for (int32 BlockIndex = 0; BlockIndex < OutIndex.GetBlockCount(); ++BlockIndex)
+	{
+		int32 BlockLength = (int32)OutIndex.GetBlockLength(BlockIndex);
+		if (!FileHandle->Read(Block.GetData(), BlockLength))
+		{
+			return false;
+		}
+		OutIndex.WeakChecksums.Add(CalcWeakChecksum(Block.GetData(), BlockLength));
+		BlockHasher->Reset();
+		BlockHasher->Update(Block.GetData(), BlockLength);
+		OutIndex.StrongChecksums.Add(BlockHasher->Final());
+		FileHasher->Update(Block.GetData(), BlockLength);
+	}
+	OutIndex.FileHash = FileHasher->Final();
+	return true;
+}
+
+void FDownloadDeltaIndex::Serialize(FArchive& Ar)
+{
+	uint32 Magic = DELTA_INDEX_MAGIC;
+	int32 Version = DELTA_INDEX_VERSION;
+	Ar << Magic << Version;
+	if (Ar.IsLoading() && (Magic != DELTA_INDEX_MAGIC || Version != DELTA_INDEX_VERSION))
+	{
+		Ar.SetError();
+		return;
+	}
+	uint8 BlockAlgorithm = (uint8)BlockHashAlgorithm;
+	uint8 FileAlgorithm = (uint8)FileHashAlgorithm;
+	Ar << FileSize << BlockSize << BlockAlgorithm << FileAlgorithm << FileHash;
+	BlockHashAlgorithm = (EDownloadHashAlgorithm)BlockAlgorithm;
+	FileHashAlgorithm = (EDownloadHashAlgorithm)FileAlgorithm;
+	Ar << WeakChecksums << StrongChecksums;
+}
+
+bool FDownloadDelta::FindBlocks(const FDownloadDeltaIndex& InIndex, const FString& InBasePath, TArray<int64>& OutBaseOffsets)
+{
+	const int32 BlockSize = InIndex.BlockSize;
+	OutBaseOffsets.Init(-1, InIndex.GetBlockCount());
+	const int64 BaseSize = IFileManager::Get().FileSize(*InBasePath);
+	if (BaseSize < BlockSize)
+	{
+		return BaseSize >= 0;
+	}
+
+	// the tail block shorter than BlockSize is always downloaded
+	TMap<uint32, TArray<int32>> BlockTable;
+	for (int32 BlockIndex = 0; BlockIndex < InIndex.GetBlockCount(); ++BlockIndex)
+	{
+		if (InIndex.GetBlockLength(BlockIndex) == BlockSize)
+		{
+			BlockTable.FindOrAdd(InIndex.WeakChecksums[BlockIndex]).Add(BlockIndex);
+		}
+	}
+
+	// a region overlap the next one by a block,so every offset of the file is a window start of one region.
+	const int64 RegionSize = FMath::Max<int64>(DELTA_SCAN_REGION_SIZE, (int64)BlockSize * 4);
+	const int32 RegionCount = (int32)FMath::DivideAndRoundUp(BaseSize, RegionSize);
+	TArray<TArray<TPair<int32, int64>>> RegionMatches;
+	RegionMatches.SetNum(RegionCount);
+	FThreadSafeBool bReadFaild = false;
+	ParallelFor(RegionCount, [&](int32 RegionIndex)
+	{
+		if (InIndex.bCanceled)
+		{
+			return;
+		}
+		const int64 RegionOffset = RegionIndex * RegionSize;
+		const int64 RegionEnd = FMath::Min(RegionOffset + RegionSize + BlockSize - 1, BaseSize);
+		TArray<uint8> Data;
+		Data.SetNumUninitialized((int32)(RegionEnd - RegionOffset));
+		TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*InBasePath));
+		if (!FileHandle.IsValid() || !FileHandle->Seek(RegionOffset) || !FileHandle->Read(Data.GetData(), Data.Num()))
+		{
+			bReadFaild = true;
+			return;
+		}
+		ScanRegion(InIndex, BlockTable, Data, RegionOffset, RegionMatches[RegionIndex]);
+	});
+	if (bReadFaild)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadDelta:read %s faild."), *InBasePath);
+		return false;
+	}
+	if (InIndex.bCanceled)
+	{
+		return false;
+	}
+
+	int32 FoundCount = 0;
+	for (const TArray<TPair<int32, int64>>& Matches : RegionMatches)
+	{
+		for (const TPair<int32, int64>& Match : Matches)
+		{
+			if (OutBaseOffsets[Match.Key] < 0)
+			{
+				OutBaseOffsets[Match.Key] = Match.Value;
+				++FoundCount;
+			}
+		}
+	}
+	UE_LOG(DownloadTookitLog, Log, TEXT("FDownloadDelta:%d of %d blocks are found in %s."), FoundCount, InIndex.GetBlockCount(), *InBasePath);
+	return true;
+}
+
+void FDownloadDelta::ScanRegion(const FDownloadDeltaIndex& InIndex, const TMap<uint32, TArray<int32>>& InBlockTable, const TArray<uint8>& InData, int64 InRegionOffset, TArray<TPair<int32, int64>>& OutMatches)
+{
+	const int32 BlockSize = InIndex.BlockSize;
+	const int32 WindowCount = InData.Num() - BlockSize + 1;
+	if (WindowCount <= 0)
+	{
+		return;
+	}
+	TUniquePtr<IDownloadHasher> Hasher = IDownloadHasher::Create(InIndex.BlockHashAlgorithm);
+	const uint8* Data = InData.GetData();
+	DownloadDelta::FRollingChecksum Checksum;
+	Checksum.Init(Data, BlockSize);
+	int32 Position = 0;
+	while (Position < WindowCount)
+	{
+		bool bMatched = false;
+		const TArray<int32>* Candidates = InBlockTable.Find(Checksum.Get());
+		if (Candidates)
+		{
+			// the strong checksum is calculated once for all candidates
+			Hasher->Reset();
+			Hasher->Update(Data + Position, BlockSize);
+			FString StrongChecksum = Hasher->Final();
+			for (int32 BlockIndex : *Candidates)
+			{
+				if (InIndex.StrongChecksums[BlockIndex] == StrongChecksum)
+				{
+					OutMatches.Add(TPair<int32, int64>(BlockIndex, InRegionOffset + Position));
+					bMatched = true;
+				}
+			}
+		}
+		// skip the matched block,the next block is usually right after it.
+		if (bMatched && Position + BlockSize < WindowCount)
+		{
+			Position += BlockSize;
+			Checksum.Init(Data + Position, BlockSize);
+			continue;
+		}
+		if (bMatched || Position + 1 >= WindowCount)
+		{
+			break;
+		}
+		Checksum.Roll(Data[Position], Data[Position + BlockSize]);
+		++Position;
+	}
+}
+
+bool FDownloadDelta::CopyBlocks(const FDownloadDeltaIndex& InIndex, const FString& InBasePath, const FString& InTargetPath, const TArray<int64>& InBaseOffsets)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TUniquePtr<IFileHandle> Reader(PlatformFile.OpenRead(*InBasePath));
+	// append mode not truncate the file,writes are positioned by Seek.
+	TUniquePtr<IFileHandle> Writer(PlatformFile.OpenWrite(*InTargetPath, true, false));
+	if (!Reader.IsValid() || !Writer.IsValid())
+	{
+		return false;
+	}
+	TArray<uint8> Block;
+	Block.SetNumUninitialized(InIndex.BlockSize);
+	for (int32 BlockIndex = 0; BlockIndex < InBaseOffsets.Num(); ++BlockIndex)
+	{
+		if (InBaseOffsets[BlockIndex] < 0)
+			continue;
+		if (InIndex.bCanceled)
+			return false;
+		int64 BlockLength = InIndex.GetBlockLength(BlockIndex);
+		if (!Reader->Seek(InBaseOffsets[BlockIndex]) || !Reader->Read(Block.GetData(), BlockLength) ||
+			!Writer->Seek((int64)BlockIndex * InIndex.BlockSize) || !Writer->Write(Block.GetData(), BlockLength))
+		{
+			UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadDelta:copy block %d to %s faild."), BlockIndex, *InTargetPath);
+			return false;
+		}
+	}
+	return Writer->Flush();
+}
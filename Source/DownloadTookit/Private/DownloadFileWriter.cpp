@@ -0,0 +1,401 @@
+#include "DownloadFileWriter.h"
+#include "DownloadTookitLog.h"
+#include "DownloadTookitStats.h"
+
+// engine header
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+#define DOWNLOAD_POSIX_FILE (PLATFORM_LINUX || PLATFORM_ANDROID || PLATFORM_MAC || PLATFORM_IOS)
+#if DOWNLOAD_POSIX_FILE
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+DECLARE_CYCLE_STAT(TEXT("Write File"), STAT_DownloadWriteFile, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Sync File"), STAT_DownloadSyncFile, STATGROUP_DownloadTookit);
+
+#define WRITE_BLOCK_SIZE 1024*1024 // 1MB
+// multiple of the page size
+#define MAPPED_WINDOW_SIZE 1024*1024*64ll // 64MB
+
+FDownloadFileWriter::FDownloadFileWriter(const FString& InFilePath, int64 InMaxQueuedByte, int32 InWriteBlockSize, EDownloadWriteMode InWriteMode, int64 InFileSize)
+	: FDownloadStage(TEXT("DownloadFileWriter"), InMaxQueuedByte),
+	FilePath(InFilePath),
+	WriteBlockSize(InWriteBlockSize > 0 ? InWriteBlockSize : WRITE_BLOCK_SIZE),
+	WriteMode(InWriteMode),
+	FileSize(FMath::Max<int64>(InFileSize, 0)),
+	FilePosition(0),
+	FileDescriptor(-1),
+	MappedWindow(nullptr),
+	MappedOffset(0),
+	MappedLength(0),
+	StagingOffset(0)
+{
+}
+
+FDownloadFileWriter::~FDownloadFileWriter()
+{
+	StopThread();
+	CloseHandle();
+}
+
+bool FDownloadFileWriter::OnStart()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	AbsoluteFilePath = PlatformFile.ConvertToAbsolutePathForExternalAppForWrite(*FilePath);
+	return true;
+}
+
+bool FDownloadFileWriter::OnThreadStart()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+	// fail before the first buffer written
+	if (!HasDiskSpace())
+	{
+		return false;
+	}
+	if (WriteMode != EDownloadWriteMode::Buffered && !OpenDescriptor())
+	{
+		WriteMode = EDownloadWriteMode::Buffered;
+	}
+	if (WriteMode == EDownloadWriteMode::Buffered)
+	{
+		// append mode not truncate the file,writes are positioned by Seek.
+		FileHandle.Reset(PlatformFile.OpenWrite(*FilePath, true, true));
+		if (!FileHandle.IsValid())
+		{
+			UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadFileWriter:open %s faild."), *FilePath);
+			return false;
+		}
+		FilePosition = FileHandle->Tell();
+	}
+	bool bReserved = false;
+	if (!Preallocate(bReserved))
+	{
+		CloseHandle();
+		return false;
+	}
+	// a mapped page of sparse file raise SIGBUS when the disk is full
+	if (WriteMode == EDownloadWriteMode::Mapped && !bReserved)
+	{
+		WriteMode = EDownloadWriteMode::Positional;
+	}
+	Staging.Reserve(WriteBlockSize * 2);
+	return true;
+}
+
+bool FDownloadFileWriter::HasDiskSpace()const
+{
+	if (FileSize <= 0)
+	{
+		return true;
+	}
+	// a resumed file is already allocated
+	int64 RequiredByte = FileSize - FMath::Max<int64>(IFileManager::Get().FileSize(*FilePath), 0);
+	uint64 TotalByte = 0;
+	uint64 FreeByte = 0;
+	if (RequiredByte <= 0 || !FPlatformMisc::GetDiskTotalAndFreeSpace(FPaths::GetPath(AbsoluteFilePath), TotalByte, FreeByte))
+	{
+		return true;
+	}
+	if ((uint64)RequiredByte > FreeByte)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadFileWriter:%lld bytes is required by %s,only %llu bytes is free."), RequiredByte, *FilePath, FreeByte);
+		return false;
+	}
+	return true;
+}
+
+bool FDownloadFileWriter::OpenDescriptor()
+{
+#if DOWNLOAD_POSIX_FILE
+	// the mapped window is readable too
+	FileDescriptor = open(TCHAR_TO_UTF8(*AbsoluteFilePath), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (FileDescriptor >= 0)
+	{
+		return true;
+	}
+	UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadFileWriter:open %s faild,errno is %d,fall back to buffered write."), *FilePath, errno);
+#endif
+	return false;
+}
+
+bool FDownloadFileWriter::Preallocate(bool& bOutReserved)
+{
+	bOutReserved = false;
+	if (FileSize <= 0)
+	{
+		return true;
+	}
+#if DOWNLOAD_POSIX_FILE
+	// the buffered handle not expose its descriptor
+	int32 Descriptor = FileDescriptor >= 0 ? FileDescriptor : open(TCHAR_TO_UTF8(*AbsoluteFilePath), O_WRONLY | O_CLOEXEC);
+	if (Descriptor >= 0)
+	{
+		int32 Error = 0;
+		struct stat FileStat;
+		int64 CurrentSize = fstat(Descriptor, &FileStat) == 0 ? (int64)FileStat.st_size : 0;
+#if PLATFORM_LINUX || (PLATFORM_ANDROID && __ANDROID_API__ >= 21)
+		// allocate the extents and extend the file,not supported by some file systems.
+		Error = posix_fallocate(Descriptor, 0, FileSize);
+		bOutReserved = Error == 0;
+#elif PLATFORM_MAC || PLATFORM_IOS
+		if (CurrentSize < FileSize)
+		{
+			// contiguous first,then any space
+			fstore_t Store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, FileSize - CurrentSize, 0 };
+			bOutReserved = fcntl(Descriptor, F_PREALLOCATE, &Store) != -1;
+			if (!bOutReserved)
+			{
+				Store.fst_flags = F_ALLOCATEALL;
+				bOutReserved = fcntl(Descriptor, F_PREALLOCATE, &Store) != -1;
+			}
+			Error = bOutReserved ? 0 : errno;
+		}
+		else
+		{
+			bOutReserved = true;
+		}
+#endif
+		// F_PREALLOCATE not change the size,posix_fallocate faild on some file systems.
+		if (CurrentSize < FileSize && Error != ENOSPC && ftruncate(Descriptor, FileSize) != 0)
+		{
+			Error = errno;
+		}
+		if (Descriptor != FileDescriptor)
+		{
+			close(Descriptor);
+		}
+		if (Error == ENOSPC)
+		{
+			UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadFileWriter:preallocate %lld bytes for %s faild,the disk is full."), FileSize, *FilePath);
+			return false;
+		}
+		return true;
+	}
+#endif
+	// extend the file,the clusters are allocated but not zeroed until written on NTFS.
+	if (FileHandle.IsValid() && FileHandle->Size() < FileSize && !FileHandle->Truncate(FileSize))
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadFileWriter:preallocate %lld bytes for %s faild."), FileSize, *FilePath);
+	}
+	return true;
+}
+
+void FDownloadFileWriter::OnBuffer(int64 InOffset, const TArray<uint8>& InData)
+{
+	// not contiguous with the staging bytes,write them out first.
+	if (Staging.Num() && InOffset != StagingOffset + Staging.Num())
+	{
+		FlushStaging(true);
+	}
+	if (!Staging.Num())
+	{
+		StagingOffset = InOffset;
+	}
+	Staging.Append(InData.GetData(), InData.Num());
+	FlushStaging(false);
+}
+
+void FDownloadFileWriter::OnFinish()
+{
+	FlushStaging(true);
+	CloseHandle();
+}
+
+bool FDownloadFileWriter::OnBarrier()
+{
+	FlushStaging(true);
+	if (!SyncFile())
+	{
+		SetError();
+	}
+	return !HasError();
+}
+
+void FDownloadFileWriter::FlushStaging(bool bInForce)
+{
+	if (!Staging.Num() || HasError())
+	{
+		return;
+	}
+	int64 WriteLength = Staging.Num();
+	if (!bInForce)
+	{
+		if (Staging.Num() < WriteBlockSize)
+		{
+			return;
+		}
+		// end the write at a block boundary of the file,keep the tail for next buffer.
+		WriteLength = AlignDown(StagingOffset + Staging.Num(), (int64)WriteBlockSize) - StagingOffset;
+		if (WriteLength <= 0)
+		{
+			return;
+		}
+	}
+
+	if (!WriteToHandle(StagingOffset, Staging.GetData(), WriteLength))
+	{
+		SetError();
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadFileWriter:write %s at %lld faild."), *FilePath, StagingOffset);
+		return;
+	}
+	Staging.RemoveAt(0, WriteLength, false);
+	StagingOffset += WriteLength;
+}
+
+bool FDownloadFileWriter::WriteToHandle(int64 InOffset, const uint8* InData, int64 InLength)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadWriteFile);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadFileWriter Write"));
+	DOWNLOAD_TRACE_EVENT(TEXT("Download Write %lld-%lld"), InOffset, InOffset + InLength - 1);
+	if (WriteMode == EDownloadWriteMode::Mapped)
+	{
+		return WriteMapped(InOffset, InData, InLength);
+	}
+	if (WriteMode == EDownloadWriteMode::Positional)
+	{
+		return WritePositional(InOffset, InData, InLength);
+	}
+	if (!FileHandle.IsValid())
+	{
+		return false;
+	}
+	if (FilePosition != InOffset)
+	{
+		if (!FileHandle->Seek(InOffset))
+			return false;
+		FilePosition = InOffset;
+	}
+	if (!FileHandle->Write(InData, InLength))
+	{
+		return false;
+	}
+	FilePosition += InLength;
+	return true;
+}
+
+bool FDownloadFileWriter::WritePositional(int64 InOffset, const uint8* InData, int64 InLength)
+{
+#if DOWNLOAD_POSIX_FILE
+	while (InLength > 0)
+	{
+		ssize_t Written = pwrite(FileDescriptor, InData, (size_t)FMath::Min<int64>(InLength, MAX_int32), (off_t)InOffset);
+		if (Written < 0 && errno == EINTR)
+			continue;
+		if (Written <= 0)
+		{
+			UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadFileWriter:pwrite faild,errno is %d."), Written < 0 ? errno : 0);
+			return false;
+		}
+		InData += Written;
+		InOffset += Written;
+		InLength -= Written;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool FDownloadFileWriter::WriteMapped(int64 InOffset, const uint8* InData, int64 InLength)
+{
+	// only the preallocated range is mapped
+	if (InOffset + InLength > FileSize)
+	{
+		return WritePositional(InOffset, InData, InLength);
+	}
+	while (InLength > 0)
+	{
+		if (!MappedWindow || InOffset < MappedOffset || InOffset >= MappedOffset + MappedLength)
+		{
+			if (!MapWindow(InOffset))
+				return false;
+		}
+		int64 CopyLength = FMath::Min(InLength, MappedOffset + MappedLength - InOffset);
+		FMemory::Memcpy(MappedWindow + (InOffset - MappedOffset), InData, CopyLength);
+		InData += CopyLength;
+		InOffset += CopyLength;
+		InLength -= CopyLength;
+	}
+	return true;
+}
+
+bool FDownloadFileWriter::MapWindow(int64 InOffset)
+{
+	UnmapWindow();
+#if DOWNLOAD_POSIX_FILE
+	MappedOffset = AlignDown(InOffset, MAPPED_WINDOW_SIZE);
+	MappedLength = FMath::Min<int64>(MAPPED_WINDOW_SIZE, FileSize - MappedOffset);
+	void* Address = mmap(nullptr, (size_t)MappedLength, PROT_READ | PROT_WRITE, MAP_SHARED, FileDescriptor, (off_t)MappedOffset);
+	if (Address != MAP_FAILED)
+	{
+		MappedWindow = (uint8*)Address;
+		return true;
+	}
+	UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadFileWriter:map %s at %lld faild,errno is %d."), *FilePath, MappedOffset, errno);
+#endif
+	return false;
+}
+
+void FDownloadFileWriter::UnmapWindow()
+{
+#if DOWNLOAD_POSIX_FILE
+	// the dirty pages are kept by the page cache
+	if (MappedWindow)
+	{
+		munmap(MappedWindow, (size_t)MappedLength);
+	}
+#endif
+	MappedWindow = nullptr;
+	MappedLength = 0;
+}
+
+bool FDownloadFileWriter::SyncFile()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadSyncFile);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadFileWriter Sync"));
+	if (FileHandle.IsValid())
+	{
+		return FileHandle->Flush();
+	}
+#if DOWNLOAD_POSIX_FILE
+	if (FileDescriptor >= 0)
+	{
+		if (MappedWindow && msync(MappedWindow, (size_t)MappedLength, MS_SYNC) != 0)
+		{
+			return false;
+		}
+#if PLATFORM_LINUX || PLATFORM_ANDROID
+		return fdatasync(FileDescriptor) == 0;
+#else
+		return fsync(FileDescriptor) == 0;
+#endif
+	}
+#endif
+	return true;
+}
+
+void FDownloadFileWriter::CloseHandle()
+{
+	if (!SyncFile())
+	{
+		SetError();
+	}
+	FileHandle.Reset();
+	UnmapWindow();
+#if DOWNLOAD_POSIX_FILE
+	if (FileDescriptor >= 0)
+	{
+		close(FileDescriptor);
+	}
+#endif
+	FileDescriptor = -1;
+}
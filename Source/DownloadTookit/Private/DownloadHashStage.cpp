@@ -0,0 +1,124 @@
+#include "DownloadHashStage.h"
+#include "DownloadTookitLog.h"
+#include "DownloadTookitStats.h"
+
+// engine header
+#include "HAL/PlatformFilemanager.h"
+#include "Templates/UniquePtr.h"
+#include "Misc/ScopeLock.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hash Update"), STAT_DownloadHashUpdate, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Hash Read Back"), STAT_DownloadHashReadBack, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Hash Finalize"), STAT_DownloadHashFinalize, STATGROUP_DownloadTookit);
+
+#define READ_BACK_BUFFER_SIZE 1024*1024*4 // 4MB
+
+FDownloadHashStage::FDownloadHashStage(const TArray<EDownloadHashAlgorithm>& InAlgorithms)
+	: FDownloadStage(TEXT("DownloadHashStage")),
+	Hasher(InAlgorithms),
+	HashedOffset(0),
+	BarrierHashedOffset(0)
+{
+}
+
+FDownloadHashStage::~FDownloadHashStage()
+{
+	StopThread();
+}
+
+void FDownloadHashStage::SetReadBackFile(const FString& InFilePath)
+{
+	ReadBackFilePath = InFilePath;
+}
+
+FString FDownloadHashStage::GetDigest(EDownloadHashAlgorithm InAlgorithm)const
+{
+	const FString* Digest = Digests.Find(InAlgorithm);
+	return Digest ? *Digest : FString();
+}
+
+bool FDownloadHashStage::RestoreState(int64 InHashedOffset, const TArray<uint8>& InState)
+{
+	if (!Hasher.LoadState(InState))
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadHashStage:restore hash state at %lld faild."), InHashedOffset);
+		Hasher.Reset();
+		HashedOffset = 0;
+		return false;
+	}
+	HashedOffset = InHashedOffset;
+	return true;
+}
+
+void FDownloadHashStage::GetBarrierState(int64& OutHashedOffset, TArray<uint8>& OutState)const
+{
+	FScopeLock ScopeLock(&BarrierStateLock);
+	OutHashedOffset = BarrierHashedOffset;
+	OutState = BarrierState;
+}
+
+bool FDownloadHashStage::OnBarrier()
+{
+	FScopeLock ScopeLock(&BarrierStateLock);
+	BarrierHashedOffset = HashedOffset;
+	Hasher.SaveState(BarrierState);
+	return true;
+}
+
+void FDownloadHashStage::OnBuffer(int64 InOffset, const TArray<uint8>& InData)
+{
+	if (InOffset != HashedOffset)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadHashStage:buffer at %lld is out of order,hashed offset is %lld."), InOffset, HashedOffset);
+		SetError();
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_DownloadHashUpdate);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadHashStage Update"));
+	Hasher.Update(InData.GetData(), InData.Num());
+	HashedOffset += InData.Num();
+}
+
+void FDownloadHashStage::OnFinish()
+{
+	if (IsStopping() || HasError())
+	{
+		return;
+	}
+	if (!ReadBackFilePath.IsEmpty())
+	{
+		Hasher.Reset();
+		if (!HashFile(ReadBackFilePath))
+		{
+			UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadHashStage:read back %s faild."), *ReadBackFilePath);
+			SetError();
+			return;
+		}
+	}
+	SCOPE_CYCLE_COUNTER(STAT_DownloadHashFinalize);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadHashStage Finalize"));
+	DOWNLOAD_TRACE_EVENT(TEXT("Download HashFinalize %lld"), HashedOffset);
+	Digests = Hasher.Final();
+}
+
+bool FDownloadHashStage::HashFile(const FString& InFilePath)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadHashReadBack);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadHashStage ReadBack"));
+	TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*InFilePath));
+	if (!FileHandle.IsValid())
+		return false;
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(READ_BACK_BUFFER_SIZE);
+	int64 RemainingSize = FileHandle->Size();
+	while (RemainingSize > 0 && !IsStopping())
+	{
+		int64 ReadSize = FMath::Min<int64>(RemainingSize, Buffer.Num());
+		if (!FileHandle->Read(Buffer.GetData(), ReadSize))
+			return false;
+		Hasher.Update(Buffer.GetData(), ReadSize);
+		RemainingSize -= ReadSize;
+	}
+	return RemainingSize == 0;
+}
@@ -0,0 +1,583 @@
+#include "DownloadHasher.h"
+#include "DownloadTookitLog.h"
+
+// engine header
+#include "openssl/md5.h"
+#include "openssl/sha.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+	#define DOWNLOAD_HASH_X86 1
+	#include <nmmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define DOWNLOAD_HASH_TARGET_SSE42
+	#else
+		#define DOWNLOAD_HASH_TARGET_SSE42 __attribute__((target("sse4.2")))
+	#endif
+#else
+	#define DOWNLOAD_HASH_X86 0
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+	#define DOWNLOAD_HASH_ARM_CRC32 1
+	#define DOWNLOAD_HASH_ARM_CRC32_RUNTIME 0
+	#include <arm_acle.h>
+	#define DOWNLOAD_HASH_TARGET_CRC32
+	#define DOWNLOAD_HASH_CRC32CD __crc32cd
+	#define DOWNLOAD_HASH_CRC32CB __crc32cb
+#elif defined(__aarch64__) && (PLATFORM_LINUX || PLATFORM_ANDROID)
+	// built without +crc,the instructions are used if the cpu report them at runtime.
+	#define DOWNLOAD_HASH_ARM_CRC32 1
+	#define DOWNLOAD_HASH_ARM_CRC32_RUNTIME 1
+	#include <sys/auxv.h>
+	#ifndef HWCAP_CRC32
+		#define HWCAP_CRC32 (1 << 7)
+	#endif
+	#if defined(__clang__)
+		#define DOWNLOAD_HASH_TARGET_CRC32 __attribute__((target("crc")))
+		#define DOWNLOAD_HASH_CRC32CD __builtin_arm_crc32cd
+		#define DOWNLOAD_HASH_CRC32CB __builtin_arm_crc32cb
+	#else
+		#define DOWNLOAD_HASH_TARGET_CRC32 __attribute__((target("+crc")))
+		#define DOWNLOAD_HASH_CRC32CD __builtin_aarch64_crc32cx
+		#define DOWNLOAD_HASH_CRC32CB __builtin_aarch64_crc32cb
+	#endif
+#else
+	// other arm targets(windows,ios) use the instructions only if enabled at compile time
+	#define DOWNLOAD_HASH_ARM_CRC32 0
+#endif
+
+#define MULTI_HASH_BLOCK_SIZE 1024*64 // 64KB
+
+namespace DownloadHasher
+{
+	static const ANSICHAR HexChars[] = "0123456789abcdef";
+
+	static FORCEINLINE uint64 RotateLeft64(uint64 InValue, int32 InBits)
+	{
+		return (InValue << InBits) | (InValue >> (64 - InBits));
+	}
+
+	static FORCEINLINE uint64 Read64(const uint8* InData)
+	{
+		uint64 Value;
+		FMemory::Memcpy(&Value, InData, sizeof(Value));
+		return Value;
+	}
+
+	static FORCEINLINE uint32 Read32(const uint8* InData)
+	{
+		uint32 Value;
+		FMemory::Memcpy(&Value, InData, sizeof(Value));
+		return Value;
+	}
+
+	template<typename T>
+	static void WriteState(TArray<uint8>& OutState, const T& InValue)
+	{
+		OutState.Append(reinterpret_cast<const uint8*>(&InValue), sizeof(T));
+	}
+
+	template<typename T>
+	static bool ReadState(const TArray<uint8>& InState, int32& InOutOffset, T& OutValue)
+	{
+		if (InOutOffset + (int32)sizeof(T) > InState.Num())
+			return false;
+		FMemory::Memcpy(&OutValue, InState.GetData() + InOutOffset, sizeof(T));
+		InOutOffset += sizeof(T);
+		return true;
+	}
+
+	static void WriteBigEndian(uint64 InValue, uint8* OutDigest, int32 InLength)
+	{
+		for (int32 Index = 0; Index < InLength; ++Index)
+		{
+			OutDigest[Index] = (uint8)(InValue >> ((InLength - 1 - Index) * 8));
+		}
+	}
+}
+
+class FDownloadMD5Hasher : public IDownloadHasher
+{
+public:
+	FDownloadMD5Hasher() { Reset(); }
+	virtual EDownloadHashAlgorithm GetAlgorithm()const override { return EDownloadHashAlgorithm::MD5; }
+	virtual void Reset()override { MD5_Init(&Context); }
+	virtual void Update(const uint8* InData, int64 InLength)override { MD5_Update(&Context, InData, InLength); }
+	virtual FString Final()override
+	{
+		uint8 Digest[MD5_DIGEST_LENGTH];
+		MD5_Final(Digest, &Context);
+		return IDownloadHasher::ToHexString(Digest, MD5_DIGEST_LENGTH);
+	}
+	virtual void SaveState(TArray<uint8>& OutState)const override { DownloadHasher::WriteState(OutState, Context); }
+	virtual bool LoadState(const TArray<uint8>& InState)override
+	{
+		int32 Offset = 0;
+		return DownloadHasher::ReadState(InState, Offset, Context) && Offset == InState.Num();
+	}
+
+private:
+	MD5_CTX Context;
+};
+
+class FDownloadSHA256Hasher : public IDownloadHasher
+{
+public:
+	FDownloadSHA256Hasher() { Reset(); }
+	virtual EDownloadHashAlgorithm GetAlgorithm()const override { return EDownloadHashAlgorithm::SHA256; }
+	virtual void Reset()override { SHA256_Init(&Context); }
+	virtual void Update(const uint8* InData, int64 InLength)override { SHA256_Update(&Context, InData, InLength); }
+	virtual FString Final()override
+	{
+		uint8 Digest[SHA256_DIGEST_LENGTH];
+		SHA256_Final(Digest, &Context);
+		return IDownloadHasher::ToHexString(Digest, SHA256_DIGEST_LENGTH);
+	}
+	virtual void SaveState(TArray<uint8>& OutState)const override { DownloadHasher::WriteState(OutState, Context); }
+	virtual bool LoadState(const TArray<uint8>& InState)override
+	{
+		int32 Offset = 0;
+		return DownloadHasher::ReadState(InState, Offset, Context) && Offset == InState.Num();
+	}
+
+private:
+	SHA256_CTX Context;
+};
+
+// XXH64,seed is 0,digest is the canonical(big endian) representation.
+class FDownloadXXHash64Hasher : public IDownloadHasher
+{
+public:
+	FDownloadXXHash64Hasher() { Reset(); }
+	virtual EDownloadHashAlgorithm GetAlgorithm()const override { return EDownloadHashAlgorithm::XXHash64; }
+
+	virtual void Reset()override
+	{
+		Acc[0] = Prime1 + Prime2;
+		Acc[1] = Prime2;
+		Acc[2] = 0;
+		Acc[3] = 0 - Prime1;
+		TotalLength = 0;
+		BufferedLength = 0;
+	}
+
+	virtual void Update(const uint8* InData, int64 InLength)override
+	{
+		TotalLength += InLength;
+		if (BufferedLength + InLength < StripeSize)
+		{
+			FMemory::Memcpy(Buffered + BufferedLength, InData, InLength);
+			BufferedLength += (int32)InLength;
+			return;
+		}
+
+		const uint8* Cursor = InData;
+		const uint8* End = InData + InLength;
+		if (BufferedLength)
+		{
+			int32 FillLength = StripeSize - BufferedLength;
+			FMemory::Memcpy(Buffered + BufferedLength, Cursor, FillLength);
+			ConsumeStripe(Buffered);
+			Cursor += FillLength;
+			BufferedLength = 0;
+		}
+		while (Cursor + StripeSize <= End)
+		{
+			ConsumeStripe(Cursor);
+			Cursor += StripeSize;
+		}
+		if (Cursor < End)
+		{
+			BufferedLength = (int32)(End - Cursor);
+			FMemory::Memcpy(Buffered, Cursor, BufferedLength);
+		}
+	}
+
+	virtual FString Final()override
+	{
+		using namespace DownloadHasher;
+		uint64 Hash;
+		if (TotalLength >= StripeSize)
+		{
+			Hash = RotateLeft64(Acc[0], 1) + RotateLeft64(Acc[1], 7) + RotateLeft64(Acc[2], 12) + RotateLeft64(Acc[3], 18);
+			for (int32 Index = 0; Index < 4; ++Index)
+			{
+				Hash ^= Round(0, Acc[Index]);
+				Hash = Hash * Prime1 + Prime4;
+			}
+		}
+		else
+		{
+			Hash = Prime5;
+		}
+		Hash += (uint64)TotalLength;
+
+		const uint8* Cursor = Buffered;
+		const uint8* End = Buffered + BufferedLength;
+		for (; Cursor + 8 <= End; Cursor += 8)
+		{
+			Hash ^= Round(0, Read64(Cursor));
+			Hash = RotateLeft64(Hash, 27) * Prime1 + Prime4;
+		}
+		if (Cursor + 4 <= End)
+		{
+			Hash ^= (uint64)Read32(Cursor) * Prime1;
+			Hash = RotateLeft64(Hash, 23) * Prime2 + Prime3;
+			Cursor += 4;
+		}
+		for (; Cursor < End; ++Cursor)
+		{
+			Hash ^= (*Cursor) * Prime5;
+			Hash = RotateLeft64(Hash, 11) * Prime1;
+		}
+
+		Hash ^= Hash >> 33;
+		Hash *= Prime2;
+		Hash ^= Hash >> 29;
+		Hash *= Prime3;
+		Hash ^= Hash >> 32;
+
+		uint8 Digest[8];
+		WriteBigEndian(Hash, Digest, 8);
+		return IDownloadHasher::ToHexString(Digest, 8);
+	}
+
+	virtual void SaveState(TArray<uint8>& OutState)const override
+	{
+		DownloadHasher::WriteState(OutState, Acc);
+		DownloadHasher::WriteState(OutState, TotalLength);
+		DownloadHasher::WriteState(OutState, Buffered);
+		DownloadHasher::WriteState(OutState, BufferedLength);
+	}
+
+	virtual bool LoadState(const TArray<uint8>& InState)override
+	{
+		int32 Offset = 0;
+		bool bLoaded = DownloadHasher::ReadState(InState, Offset, Acc) &&
+			DownloadHasher::ReadState(InState, Offset, TotalLength) &&
+			DownloadHasher::ReadState(InState, Offset, Buffered) &&
+			DownloadHasher::ReadState(InState, Offset, BufferedLength);
+		return bLoaded && Offset == InState.Num() && BufferedLength >= 0 && BufferedLength < StripeSize;
+	}
+
+private:
+	static FORCEINLINE uint64 Round(uint64 InAcc, uint64 InInput)
+	{
+		InAcc += InInput * Prime2;
+		InAcc = DownloadHasher::RotateLeft64(InAcc, 31);
+		return InAcc * Prime1;
+	}
+
+	FORCEINLINE void ConsumeStripe(const uint8* InStripe)
+	{
+		Acc[0] = Round(Acc[0], DownloadHasher::Read64(InStripe));
+		Acc[1] = Round(Acc[1], DownloadHasher::Read64(InStripe + 8));
+		Acc[2] = Round(Acc[2], DownloadHasher::Read64(InStripe + 16));
+		Acc[3] = Round(Acc[3], DownloadHasher::Read64(InStripe + 24));
+	}
+
+	static const uint64 Prime1 = 0x9E3779B185EBCA87ull;
+	static const uint64 Prime2 = 0xC2B2AE3D27D4EB4Full;
+	static const uint64 Prime3 = 0x165667B19E3779F9ull;
+	static const uint64 Prime4 = 0x85EBCA77C2B2AE63ull;
+	static const uint64 Prime5 = 0x27D4EB2F165667C5ull;
+	static const int32 StripeSize = 32;
+
+	uint64 Acc[4];
+	int64 TotalLength;
+	uint8 Buffered[32];
+	int32 BufferedLength;
+};
+
+// CRC32C(Castagnoli),use SSE4.2 or ARMv8 crc32 instructions when the cpu support.
+// the arm instructions are checked at runtime on linux/android,other arm targets need them enabled at compile time.
+class FDownloadCRC32CHasher : public IDownloadHasher
+{
+public:
+	FDownloadCRC32CHasher() { Reset(); }
+	virtual EDownloadHashAlgorithm GetAlgorithm()const override { return EDownloadHashAlgorithm::CRC32C; }
+	virtual void Reset()override { Crc = 0xFFFFFFFFu; }
+
+	virtual void Update(const uint8* InData, int64 InLength)override
+	{
+#if DOWNLOAD_HASH_X86
+		if (HasHardwareSupport())
+		{
+			Crc = UpdateSSE42(Crc, InData, InLength);
+			return;
+		}
+#elif DOWNLOAD_HASH_ARM_CRC32
+		if (HasHardwareSupport())
+		{
+			Crc = UpdateARM(Crc, InData, InLength);
+			return;
+		}
+#endif
+		Crc = UpdateSoftware(Crc, InData, InLength);
+	}
+
+	virtual FString Final()override
+	{
+		uint8 Digest[4];
+		DownloadHasher::WriteBigEndian(Crc ^ 0xFFFFFFFFu, Digest, 4);
+		return IDownloadHasher::ToHexString(Digest, 4);
+	}
+	virtual void SaveState(TArray<uint8>& OutState)const override { DownloadHasher::WriteState(OutState, Crc); }
+	virtual bool LoadState(const TArray<uint8>& InState)override
+	{
+		int32 Offset = 0;
+		return DownloadHasher::ReadState(InState, Offset, Crc) && Offset == InState.Num();
+	}
+
+private:
+	struct FTable
+	{
+		uint32 Entries[8][256];
+		FTable()
+		{
+			for (uint32 Index = 0; Index < 256; ++Index)
+			{
+				uint32 Value = Index;
+				for (int32 Bit = 0; Bit < 8; ++Bit)
+					Value = (Value >> 1) ^ (0x82F63B78u & (0u - (Value & 1u)));
+				Entries[0][Index] = Value;
+			}
+			for (uint32 Index = 0; Index < 256; ++Index)
+			{
+				for (int32 Slice = 1; Slice < 8; ++Slice)
+					Entries[Slice][Index] = (Entries[Slice - 1][Index] >> 8) ^ Entries[0][Entries[Slice - 1][Index] & 0xFF];
+			}
+		}
+	};
+
+	// slicing-by-8
+	static uint32 UpdateSoftware(uint32 InCrc, const uint8* InData, int64 InLength)
+	{
+		static const FTable Table;
+		const uint32 (&T)[8][256] = Table.Entries;
+		for (; InLength >= 8; InLength -= 8, InData += 8)
+		{
+			uint32 Low = DownloadHasher::Read32(InData) ^ InCrc;
+			uint32 High = DownloadHasher::Read32(InData + 4);
+			InCrc = T[7][Low & 0xFF] ^ T[6][(Low >> 8) & 0xFF] ^ T[5][(Low >> 16) & 0xFF] ^ T[4][Low >> 24] ^
+				T[3][High & 0xFF] ^ T[2][(High >> 8) & 0xFF] ^ T[1][(High >> 16) & 0xFF] ^ T[0][High >> 24];
+		}
+		for (; InLength > 0; --InLength, ++InData)
+		{
+			InCrc = (InCrc >> 8) ^ T[0][(InCrc ^ *InData) & 0xFF];
+		}
+		return InCrc;
+	}
+
+#if DOWNLOAD_HASH_X86
+	static bool HasHardwareSupport()
+	{
+		static const bool bSupportSSE42 = []()
+		{
+	#if defined(_MSC_VER)
+			int32 CPUInfo[4];
+			__cpuid(CPUInfo, 1);
+			return (CPUInfo[2] & (1 << 20)) != 0;
+	#else
+			return __builtin_cpu_supports("sse4.2") != 0;
+	#endif
+		}();
+		return bSupportSSE42;
+	}
+
+	static DOWNLOAD_HASH_TARGET_SSE42 uint32 UpdateSSE42(uint32 InCrc, const uint8* InData, int64 InLength)
+	{
+	#if defined(_M_X64) || defined(__x86_64__)
+		uint64 Crc64 = InCrc;
+		for (; InLength >= 8; InLength -= 8, InData += 8)
+		{
+			Crc64 = _mm_crc32_u64(Crc64, DownloadHasher::Read64(InData));
+		}
+		InCrc = (uint32)Crc64;
+	#endif
+		for (; InLength >= 4; InLength -= 4, InData += 4)
+		{
+			InCrc = _mm_crc32_u32(InCrc, DownloadHasher::Read32(InData));
+		}
+		for (; InLength > 0; --InLength, ++InData)
+		{
+			InCrc = _mm_crc32_u8(InCrc, *InData);
+		}
+		return InCrc;
+	}
+#endif
+
+#if DOWNLOAD_HASH_ARM_CRC32
+	static bool HasHardwareSupport()
+	{
+	#if DOWNLOAD_HASH_ARM_CRC32_RUNTIME
+		static const bool bSupportCRC32 = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+		return bSupportCRC32;
+	#else
+		return true;
+	#endif
+	}
+
+	static DOWNLOAD_HASH_TARGET_CRC32 uint32 UpdateARM(uint32 InCrc, const uint8* InData, int64 InLength)
+	{
+		for (; InLength >= 8; InLength -= 8, InData += 8)
+		{
+			InCrc = DOWNLOAD_HASH_CRC32CD(InCrc, DownloadHasher::Read64(InData));
+		}
+		for (; InLength > 0; --InLength, ++InData)
+		{
+			InCrc = DOWNLOAD_HASH_CRC32CB(InCrc, *InData);
+		}
+		return InCrc;
+	}
+#endif
+
+	uint32 Crc;
+};
+
+TUniquePtr<IDownloadHasher> IDownloadHasher::Create(EDownloadHashAlgorithm InAlgorithm)
+{
+	switch (InAlgorithm)
+	{
+	case EDownloadHashAlgorithm::MD5:
+		return MakeUnique<FDownloadMD5Hasher>();
+	case EDownloadHashAlgorithm::SHA256:
+		return MakeUnique<FDownloadSHA256Hasher>();
+	case EDownloadHashAlgorithm::XXHash64:
+		return MakeUnique<FDownloadXXHash64Hasher>();
+	case EDownloadHashAlgorithm::CRC32C:
+		return MakeUnique<FDownloadCRC32CHasher>();
+	}
+	UE_LOG(DownloadTookitLog, Error, TEXT("IDownloadHasher:unknown hash algorithm %d."), (int32)InAlgorithm);
+	return nullptr;
+}
+
+FString IDownloadHasher::GetAlgorithmName(EDownloadHashAlgorithm InAlgorithm)
+{
+	switch (InAlgorithm)
+	{
+	case EDownloadHashAlgorithm::MD5: return TEXT("MD5");
+	case EDownloadHashAlgorithm::SHA256: return TEXT("SHA256");
+	case EDownloadHashAlgorithm::XXHash64: return TEXT("XXHash64");
+	case EDownloadHashAlgorithm::CRC32C: return TEXT("CRC32C");
+	}
+	return TEXT("Unknown");
+}
+
+bool IDownloadHasher::ParseAlgorithmName(const FString& InName, EDownloadHashAlgorithm& OutAlgorithm)
+{
+	const EDownloadHashAlgorithm Algorithms[] = { EDownloadHashAlgorithm::MD5, EDownloadHashAlgorithm::SHA256, EDownloadHashAlgorithm::XXHash64, EDownloadHashAlgorithm::CRC32C };
+	for (EDownloadHashAlgorithm Algorithm : Algorithms)
+	{
+		if (InName.Equals(GetAlgorithmName(Algorithm), ESearchCase::IgnoreCase))
+		{
+			OutAlgorithm = Algorithm;
+			return true;
+		}
+	}
+	return false;
+}
+
+FString IDownloadHasher::ToHexString(const uint8* InDigest, int32 InLength)
+{
+	FString Result;
+	TArray<TCHAR>& Chars = Result.GetCharArray();
+	Chars.SetNumUninitialized(InLength * 2 + 1);
+	for (int32 Index = 0; Index < InLength; ++Index)
+	{
+		Chars[Index * 2] = DownloadHasher::HexChars[InDigest[Index] >> 4];
+		Chars[Index * 2 + 1] = DownloadHasher::HexChars[InDigest[Index] & 0x0F];
+	}
+	Chars[InLength * 2] = 0;
+	return Result;
+}
+
+FDownloadMultiHasher::FDownloadMultiHasher(const TArray<EDownloadHashAlgorithm>& InAlgorithms)
+{
+	SetAlgorithms(InAlgorithms);
+}
+
+void FDownloadMultiHasher::SetAlgorithms(const TArray<EDownloadHashAlgorithm>& InAlgorithms)
+{
+	Hashers.Reset();
+	for (EDownloadHashAlgorithm Algorithm : InAlgorithms)
+	{
+		bool bDuplicated = Hashers.ContainsByPredicate([Algorithm](const TUniquePtr<IDownloadHasher>& Hasher) { return Hasher->GetAlgorithm() == Algorithm; });
+		TUniquePtr<IDownloadHasher> Hasher = bDuplicated ? nullptr : IDownloadHasher::Create(Algorithm);
+		if (Hasher.IsValid())
+		{
+			Hashers.Add(MoveTemp(Hasher));
+		}
+	}
+}
+
+void FDownloadMultiHasher::Reset()
+{
+	for (TUniquePtr<IDownloadHasher>& Hasher : Hashers)
+	{
+		Hasher->Reset();
+	}
+}
+
+void FDownloadMultiHasher::Update(const uint8* InData, int64 InLength)
+{
+	if (Hashers.Num() == 1)
+	{
+		Hashers[0]->Update(InData, InLength);
+		return;
+	}
+	for (int64 Offset = 0; Offset < InLength; Offset += MULTI_HASH_BLOCK_SIZE)
+	{
+		int64 BlockLength = FMath::Min<int64>(InLength - Offset, MULTI_HASH_BLOCK_SIZE);
+		for (TUniquePtr<IDownloadHasher>& Hasher : Hashers)
+		{
+			Hasher->Update(InData + Offset, BlockLength);
+		}
+	}
+}
+
+TMap<EDownloadHashAlgorithm, FString> FDownloadMultiHasher::Final()
+{
+	TMap<EDownloadHashAlgorithm, FString> Digests;
+	for (TUniquePtr<IDownloadHasher>& Hasher : Hashers)
+	{
+		Digests.Add(Hasher->GetAlgorithm(), Hasher->Final());
+	}
+	return Digests;
+}
+
+void FDownloadMultiHasher::SaveState(TArray<uint8>& OutState)const
+{
+	OutState.Reset();
+	for (const TUniquePtr<IDownloadHasher>& Hasher : Hashers)
+	{
+		TArray<uint8> HasherState;
+		Hasher->SaveState(HasherState);
+		DownloadHasher::WriteState(OutState, (uint8)Hasher->GetAlgorithm());
+		DownloadHasher::WriteState(OutState, HasherState.Num());
+		OutState.Append(HasherState);
+	}
+}
+
+bool FDownloadMultiHasher::LoadState(const TArray<uint8>& InState)
+{
+	int32 Offset = 0;
+	for (TUniquePtr<IDownloadHasher>& Hasher : Hashers)
+	{
+		uint8 Algorithm = 0;
+		int32 StateLength = 0;
+		if (!DownloadHasher::ReadState(InState, Offset, Algorithm) || Algorithm != (uint8)Hasher->GetAlgorithm() ||
+			!DownloadHasher::ReadState(InState, Offset, StateLength) || StateLength < 0 || Offset + StateLength > InState.Num())
+		{
+			return false;
+		}
+		TArray<uint8> HasherState(InState.GetData() + Offset, StateLength);
+		if (!Hasher->LoadState(HasherState))
+		{
+			return false;
+		}
+		Offset += StateLength;
+	}
+	return Offset == InState.Num();
+}
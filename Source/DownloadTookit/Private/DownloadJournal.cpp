@@ -0,0 +1,78 @@
+#include "DownloadJournal.h"
+#include "DownloadTookitLog.h"
+
+// engine header
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#define JOURNAL_MAGIC 0x4C4A5444 // DTJL
+#define JOURNAL_VERSION 1
+
+bool FDownloadJournal::Save(const FString& InJournalPath)
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	Serialize(Writer);
+
+	FString TempPath = InJournalPath + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Data, *TempPath) || !IFileManager::Get().Move(*InJournalPath, *TempPath, true, true))
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadJournal:save %s faild."), *InJournalPath);
+		return false;
+	}
+	return true;
+}
+
+bool FDownloadJournal::Load(const FString& InJournalPath)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *InJournalPath, FILEREAD_Silent))
+	{
+		return false;
+	}
+	FMemoryReader Reader(Data);
+	Serialize(Reader);
+	if (Reader.IsError())
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadJournal:%s is corrupted."), *InJournalPath);
+		return false;
+	}
+	return true;
+}
+
+bool FDownloadJournal::IsMatch(const FDownloadFile& InDownloadFile)const
+{
+	bool bSameContent = URL == InDownloadFile.URL && Size == InDownloadFile.Size && ChunkSize == InDownloadFile.ChunkSize;
+	bool bHasValidator = !ETag.IsEmpty() || !LastModified.IsEmpty();
+	bool bSameValidator = ETag == InDownloadFile.ETag && LastModified == InDownloadFile.LastModified;
+	return bSameContent && bHasValidator && bSameValidator && Segments.Num();
+}
+
+FString FDownloadJournal::GetJournalPath(const FString& InSavePath)
+{
+	return InSavePath + TEXT(".journal");
+}
+
+bool FDownloadJournal::Delete(const FString& InSavePath)
+{
+	FString JournalPath = GetJournalPath(InSavePath);
+	return !IFileManager::Get().FileExists(*JournalPath) || IFileManager::Get().Delete(*JournalPath, false, false, true);
+}
+
+void FDownloadJournal::Serialize(FArchive& Ar)
+{
+	uint32 Magic = JOURNAL_MAGIC;
+	int32 Version = JOURNAL_VERSION;
+	Ar << Magic << Version;
+	if (Ar.IsLoading() && (Magic != JOURNAL_MAGIC || Version != JOURNAL_VERSION))
+	{
+		Ar.SetError();
+		return;
+	}
+	Ar << URL << Size << ETag << LastModified << ChunkSize;
+	Ar << Segments;
+	Ar << HashedOffset << HashState;
+	Ar << LeafHashes;
+}
@@ -0,0 +1,425 @@
+#include "DownloadManager.h"
+#include "DownloadTookitLog.h"
+#include "DownloadContentStore.h"
+#include "DownloadTookitStats.h"
+
+// engine header
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+
+#define MAX_CONCURRENT_DOWNLOADS 8
+#define MAX_CONCURRENT_PER_HOST 4
+
+DECLARE_CYCLE_STAT(TEXT("Manager Tick"), STAT_DownloadManagerTick, STATGROUP_DownloadTookit);
+
+static FString GetHostByURL(const FString& InURL)
+{
+	FString Host = InURL;
+	int32 SchemeIndex = Host.Find(TEXT("://"));
+	if (SchemeIndex != INDEX_NONE)
+	{
+		Host = Host.Mid(SchemeIndex + 3);
+	}
+	int32 PathIndex = INDEX_NONE;
+	if (Host.FindChar(TEXT('/'), PathIndex))
+	{
+		Host = Host.Left(PathIndex);
+	}
+	return Host.ToLower();
+}
+
+UDownloadManager* UDownloadManager::Get()
+{
+	return GEngine ? GEngine->GetEngineSubsystem<UDownloadManager>() : nullptr;
+}
+
+void UDownloadManager::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	NextSequence = 0;
+	bScheduling = false;
+	MaxConcurrentDownloads = MAX_CONCURRENT_DOWNLOADS;
+	MaxConcurrentPerHost = MAX_CONCURRENT_PER_HOST;
+	TickDelegateHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UDownloadManager::Tick));
+}
+
+void UDownloadManager::Deinitialize()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
+	TickDelegateHandle.Reset();
+	for (FDownloadTask& Task : Tasks)
+	{
+		if (Task.Proxy)
+		{
+			Task.Proxy->OnDownloadCompleteDyMultiDlg.RemoveDynamic(this, &UDownloadManager::OnTaskComplete);
+			Task.Proxy->OnDownloadCanceledDyMultiDlg.RemoveDynamic(this, &UDownloadManager::OnTaskCanceled);
+		}
+	}
+	Tasks.Empty();
+	TickedTransfers.Empty();
+	Batches.Empty();
+	for (UDownloadVerifier* Verifier : Verifiers)
+	{
+		Verifier->Cancel();
+	}
+	Verifiers.Empty();
+	Super::Deinitialize();
+}
+
+UDownloadProxy* UDownloadManager::EnqueueDownload(const FDownloadFile& InDownloadFile, EDownloadPriority InPriority, int32 InConnectionCountOpt)
+{
+	UDownloadProxy* Proxy = NewObject<UDownloadProxy>(this);
+	Proxy->OnDownloadCompleteDyMultiDlg.AddDynamic(this, &UDownloadManager::OnTaskComplete);
+	Proxy->OnDownloadCanceledDyMultiDlg.AddDynamic(this, &UDownloadManager::OnTaskCanceled);
+
+	FDownloadTask& Task = Tasks.AddDefaulted_GetRef();
+	Task.Proxy = Proxy;
+	Task.DownloadFile = InDownloadFile;
+	Task.Priority = InPriority;
+	Task.ConnectionCount = FMath::Max(1, InConnectionCountOpt);
+	Task.Host = GetHostByURL(InDownloadFile.URL);
+	Task.Sequence = NextSequence++;
+
+	Schedule();
+	return Proxy;
+}
+
+UDownloadBatch* UDownloadManager::EnqueueBatch(const TArray<FDownloadFile>& InManifest, EDownloadPriority InPriority, int32 InConnectionCountOpt)
+{
+	UDownloadBatch* Batch = NewObject<UDownloadBatch>(this);
+	Batches.Add(Batch);
+	Batch->Start(InManifest, InPriority, InConnectionCountOpt);
+	return Batch;
+}
+
+UDownloadVerifier* UDownloadManager::VerifyFiles(const TArray<FDownloadFile>& InManifest, const FDownloadVerifySettings& InSettings)
+{
+	UDownloadVerifier* Verifier = NewObject<UDownloadVerifier>(this);
+	Verifiers.Add(Verifier);
+	Verifier->Start(InManifest, InSettings);
+	return Verifier;
+}
+
+void UDownloadManager::SetPriority(UDownloadProxy* InProxy, EDownloadPriority InPriority)
+{
+	FDownloadTask* Task = FindTask(InProxy);
+	if (Task)
+	{
+		Task->Priority = InPriority;
+		Schedule();
+	}
+}
+
+void UDownloadManager::CancelDownload(UDownloadProxy* InProxy)
+{
+	FDownloadTask* Task = FindTask(InProxy);
+	if (!Task || Task->bFinished)
+	{
+		return;
+	}
+	Task->bFinished = true;
+	if (!Task->bStarted)
+	{
+		// the transfer of a queued task is not started,its Cancel do nothing,so notify here.
+		UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadManager:%s is canceled in queue."), *Task->DownloadFile.URL);
+		if (!bScheduling)
+		{
+			RemoveTask(InProxy);
+		}
+		InProxy->OnDownloadCanceledDyMultiDlg.Broadcast(InProxy);
+	}
+	else
+	{
+		// the preempted task is paused,the transfer delete its journal and notify.
+		InProxy->Cancel();
+	}
+	Schedule();
+}
+
+void UDownloadManager::SetMaxConcurrentDownloads(int32 InMaxCount)
+{
+	MaxConcurrentDownloads = FMath::Max(1, InMaxCount);
+	Schedule();
+}
+
+void UDownloadManager::SetMaxConcurrentPerHost(int32 InMaxCount)
+{
+	MaxConcurrentPerHost = FMath::Max(1, InMaxCount);
+	Schedule();
+}
+
+void UDownloadManager::SetGlobalRateLimit(int64 InBytePerSecond)
+{
+	GlobalRateLimiter.SetByteRate(InBytePerSecond);
+}
+
+int64 UDownloadManager::GetGlobalRateLimit()const
+{
+	return GlobalRateLimiter.GetByteRate();
+}
+
+void UDownloadManager::SetContentStoreCapacity(int64 InCapacity)
+{
+	FDownloadContentStore::Get().SetCapacity(InCapacity);
+}
+
+int64 UDownloadManager::GetContentStoreCapacity()const
+{
+	return FDownloadContentStore::Get().GetCapacity();
+}
+
+FDownloadMetrics UDownloadManager::GetAggregateMetrics()const
+{
+	TArray<const FDownloadTransfer*> Transfers;
+	for (const FDownloadTask& Task : Tasks)
+	{
+		if (Task.Proxy && Task.bStarted && !Task.bFinished)
+			Transfers.AddUnique(&Task.Proxy->GetTransfer().Get());
+	}
+	// the ticked transfers include the ones without proxy
+	TArray<TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe>> TickedTransferPtrs;
+	for (const TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe>& Transfer : TickedTransfers)
+	{
+		TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> TransferPtr = Transfer.Pin();
+		if (TransferPtr.IsValid())
+		{
+			TickedTransferPtrs.Add(TransferPtr);
+			Transfers.AddUnique(TransferPtr.Get());
+		}
+	}
+
+	TArray<FDownloadMetrics> AllMetrics;
+	for (const FDownloadTransfer* Transfer : Transfers)
+	{
+		AllMetrics.Add(Transfer->GetMetrics());
+	}
+	return FDownloadMetricsTracker::Aggregate(AllMetrics);
+}
+
+int32 UDownloadManager::GetQueuedCount()const
+{
+	int32 QueuedCount = 0;
+	for (const FDownloadTask& Task : Tasks)
+	{
+		if (!Task.bFinished && (!Task.bStarted || Task.bPreempted))
+			++QueuedCount;
+	}
+	return QueuedCount;
+}
+
+int32 UDownloadManager::GetActiveCount()const
+{
+	int32 ActiveCount = 0;
+	for (const FDownloadTask& Task : Tasks)
+	{
+		if (IsTaskActive(Task))
+			++ActiveCount;
+	}
+	return ActiveCount;
+}
+
+void UDownloadManager::AddTickedTransfer(const TSharedRef<FDownloadTransfer, ESPMode::ThreadSafe>& InTransfer)
+{
+	// added once by FDownloadTransfer::StartTicker
+	TickedTransfers.Add(InTransfer);
+}
+
+void UDownloadManager::RemoveTickedTransfer(const FDownloadTransfer* InTransfer)
+{
+	// called by the destructor of transfer too,the expired one is removed by tick.
+	TickedTransfers.RemoveAll([InTransfer](const TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe>& Transfer) { return Transfer.HasSameObject(InTransfer); });
+}
+
+bool UDownloadManager::Tick(float InDeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadManagerTick);
+	// a transfer may stop ticking in its tick
+	TArray<TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe>> TickingTransfers = TickedTransfers;
+	for (const TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe>& Transfer : TickingTransfers)
+	{
+		TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> TransferPtr = Transfer.Pin();
+		if (TransferPtr.IsValid())
+		{
+			TransferPtr->Tick(InDeltaTime);
+		}
+	}
+	TickedTransfers.RemoveAll([](const TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe>& Transfer) { return !Transfer.IsValid(); });
+	TArray<UDownloadBatch*> TickingBatches = Batches;
+	for (UDownloadBatch* Batch : TickingBatches)
+	{
+		Batch->Tick(InDeltaTime);
+	}
+	Batches.RemoveAll([](const UDownloadBatch* Batch) { return Batch->GetDownloadStatus() != EDownloadStatus::Downloading; });
+	Verifiers.RemoveAll([](const UDownloadVerifier* Verifier) { return !Verifier->IsVerifying(); });
+	Schedule();
+	return true;
+}
+
+void UDownloadManager::Schedule()
+{
+	if (bScheduling)
+	{
+		return;
+	}
+	TGuardValue<bool> SchedulingGuard(bScheduling, true);
+	RemoveFinishedTasks();
+
+	TArray<const FDownloadTask*> WaitingTasks;
+	for (const FDownloadTask& Task : Tasks)
+	{
+		if (!Task.bFinished && (!Task.bStarted || Task.bPreempted))
+			WaitingTasks.Add(&Task);
+	}
+	WaitingTasks.Sort([](const FDownloadTask& Lhs, const FDownloadTask& Rhs)
+	{
+		return Lhs.Priority != Rhs.Priority ? Lhs.Priority > Rhs.Priority : Lhs.Sequence < Rhs.Sequence;
+	});
+	// delegates of a starting proxy may enqueue new task,so find the task by sequence every time.
+	TArray<uint64> WaitingSequences;
+	for (const FDownloadTask* Task : WaitingTasks)
+	{
+		WaitingSequences.Add(Task->Sequence);
+	}
+
+	for (uint64 WaitingSequence : WaitingSequences)
+	{
+		auto FindWaitingTask = [this, WaitingSequence]() { return Tasks.FindByPredicate([WaitingSequence](const FDownloadTask& Task) { return Task.Sequence == WaitingSequence; }); };
+		FDownloadTask* WaitingTask = FindWaitingTask();
+		if (!WaitingTask || WaitingTask->bFinished)
+		{
+			continue;
+		}
+		int32 ActiveCount = 0;
+		int32 HostActiveCount = 0;
+		for (const FDownloadTask& Task : Tasks)
+		{
+			if (IsTaskActive(Task))
+			{
+				++ActiveCount;
+				HostActiveCount += Task.Host == WaitingTask->Host ? 1 : 0;
+			}
+		}
+
+		bool bHasSlot = ActiveCount < MaxConcurrentDownloads && HostActiveCount < MaxConcurrentPerHost;
+		if (!bHasSlot)
+		{
+			// free a slot of the same host if the host is full
+			bHasSlot = PreemptTask(*WaitingTask, HostActiveCount >= MaxConcurrentPerHost);
+			WaitingTask = FindWaitingTask();
+		}
+		if (bHasSlot && WaitingTask)
+		{
+			StartTask(*WaitingTask);
+		}
+	}
+}
+
+void UDownloadManager::RemoveFinishedTasks()
+{
+	TArray<UDownloadProxy*> FinishedProxies;
+	for (const FDownloadTask& Task : Tasks)
+	{
+		if (Task.bFinished)
+			FinishedProxies.Add(Task.Proxy);
+	}
+	for (UDownloadProxy* Proxy : FinishedProxies)
+	{
+		RemoveTask(Proxy);
+	}
+}
+
+bool UDownloadManager::IsTaskActive(const FDownloadTask& InTask)const
+{
+	// paused by user not take a slot
+	return InTask.bStarted && !InTask.bPreempted && !InTask.bFinished && InTask.Proxy && InTask.Proxy->GetDownloadStatus() != EDownloadStatus::Paused;
+}
+
+bool UDownloadManager::StartTask(FDownloadTask& InTask)
+{
+	// the task may be moved by the delegates of proxy,not access it after call the proxy.
+	UDownloadProxy* Proxy = InTask.Proxy;
+	if (InTask.bPreempted)
+	{
+		UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadManager:resume %s."), *InTask.DownloadFile.URL);
+		InTask.bPreempted = false;
+		if (!Proxy->Resume())
+		{
+			FDownloadTask* Task = FindTask(Proxy);
+			if (Task)
+				Task->bPreempted = true;
+			return false;
+		}
+		return true;
+	}
+	InTask.bStarted = true;
+	UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadManager:start %s,priority is %d."), *InTask.DownloadFile.URL, (int32)InTask.Priority);
+	Proxy->RequestDownloadFile(FDownloadFile(InTask.DownloadFile), false, 0, false, InTask.ConnectionCount);
+	return true;
+}
+
+bool UDownloadManager::PreemptTask(const FDownloadTask& InWaitingTask, bool bInSameHost)
+{
+	// the lowest priority and latest enqueued task is paused first
+	FDownloadTask* Victim = nullptr;
+	for (FDownloadTask& Task : Tasks)
+	{
+		if (!IsTaskActive(Task) || Task.Priority >= InWaitingTask.Priority || (bInSameHost && Task.Host != InWaitingTask.Host))
+			continue;
+		if (Task.Proxy->GetDownloadStatus() != EDownloadStatus::Downloading)
+			continue;
+		if (!Victim || Task.Priority < Victim->Priority || (Task.Priority == Victim->Priority && Task.Sequence > Victim->Sequence))
+			Victim = &Task;
+	}
+	if (!Victim)
+	{
+		return false;
+	}
+	UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadManager:%s is preempted by %s."), *Victim->DownloadFile.URL, *InWaitingTask.DownloadFile.URL);
+	UDownloadProxy* VictimProxy = Victim->Proxy;
+	Victim->bPreempted = true;
+	VictimProxy->Pause();
+	if (VictimProxy->GetDownloadStatus() != EDownloadStatus::Paused)
+	{
+		Victim = FindTask(VictimProxy);
+		if (Victim)
+			Victim->bPreempted = false;
+		return false;
+	}
+	return true;
+}
+
+FDownloadTask* UDownloadManager::FindTask(UDownloadProxy* InProxy)
+{
+	return Tasks.FindByPredicate([InProxy](const FDownloadTask& Task) { return Task.Proxy == InProxy; });
+}
+
+void UDownloadManager::RemoveTask(UDownloadProxy* InProxy)
+{
+	if (InProxy)
+	{
+		InProxy->OnDownloadCompleteDyMultiDlg.RemoveDynamic(this, &UDownloadManager::OnTaskComplete);
+		InProxy->OnDownloadCanceledDyMultiDlg.RemoveDynamic(this, &UDownloadManager::OnTaskCanceled);
+	}
+	Tasks.RemoveAll([InProxy](const FDownloadTask& Task) { return Task.Proxy == InProxy; });
+}
+
+void UDownloadManager::OnTaskComplete(UDownloadProxy* InProxy, bool bInSuccess)
+{
+	FDownloadTask* Task = FindTask(InProxy);
+	if (Task)
+	{
+		UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadManager:%s is %s."), *Task->DownloadFile.URL, bInSuccess ? TEXT("succeeded") : TEXT("faild"));
+		Task->bFinished = true;
+	}
+	Schedule();
+}
+
+void UDownloadManager::OnTaskCanceled(UDownloadProxy* InProxy)
+{
+	FDownloadTask* Task = FindTask(InProxy);
+	if (Task)
+	{
+		Task->bFinished = true;
+	}
+	Schedule();
+}
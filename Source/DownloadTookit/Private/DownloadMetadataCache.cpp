@@ -0,0 +1,173 @@
+#include "DownloadMetadataCache.h"
+#include "DownloadTookitLog.h"
+
+// engine header
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#define METADATA_CACHE_MAGIC 0x43445444 // DTDC
+#define METADATA_CACHE_VERSION 1
+#define METADATA_CACHE_SAVE_DELAY 1.0f // second
+
+FArchive& operator<<(FArchive& Ar, FDownloadMetadata& Metadata)
+{
+	Ar << Metadata.URL << Metadata.SavePath << Metadata.Size << Metadata.ETag << Metadata.LastModified;
+	int32 DigestCount = Metadata.Digests.Num();
+	Ar << DigestCount;
+	if (Ar.IsLoading())
+	{
+		Metadata.Digests.Reset();
+		for (int32 Index = 0; Index < DigestCount && !Ar.IsError(); ++Index)
+		{
+			uint8 Algorithm = 0;
+			FString Digest;
+			Ar << Algorithm << Digest;
+			Metadata.Digests.Add((EDownloadHashAlgorithm)Algorithm, Digest);
+		}
+	}
+	else
+	{
+		for (auto& Digest : Metadata.Digests)
+		{
+			uint8 Algorithm = (uint8)Digest.Key;
+			Ar << Algorithm << Digest.Value;
+		}
+	}
+	return Ar;
+}
+
+FDownloadMetadataCache& FDownloadMetadataCache::Get()
+{
+	static FDownloadMetadataCache Instance;
+	return Instance;
+}
+
+FDownloadMetadataCache::FDownloadMetadataCache()
+	: bLoaded(false)
+{
+}
+
+FString FDownloadMetadataCache::GetCachePath()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("DownloadTookit"), TEXT("MetadataCache.bin"));
+}
+
+const FDownloadMetadata* FDownloadMetadataCache::Find(const FString& InURL)
+{
+	Load();
+	return Entries.Find(InURL);
+}
+
+void FDownloadMetadataCache::Add(const FDownloadMetadata& InMetadata)
+{
+	Load();
+	Entries.Add(InMetadata.URL, InMetadata);
+	MarkDirty();
+}
+
+void FDownloadMetadataCache::Remove(const FString& InURL)
+{
+	Load();
+	if (Entries.Remove(InURL))
+	{
+		MarkDirty();
+	}
+}
+
+void FDownloadMetadataCache::Flush()
+{
+	if (SaveDelegateHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(SaveDelegateHandle);
+		SaveDelegateHandle.Reset();
+		Save();
+	}
+}
+
+void FDownloadMetadataCache::Load()
+{
+	if (bLoaded)
+	{
+		return;
+	}
+	bLoaded = true;
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *GetCachePath(), FILEREAD_Silent))
+	{
+		return;
+	}
+	FMemoryReader Reader(Data);
+	Serialize(Reader);
+	if (Reader.IsError())
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadMetadataCache:%s is corrupted."), *GetCachePath());
+		Entries.Reset();
+	}
+}
+
+bool FDownloadMetadataCache::Save()
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	Serialize(Writer);
+
+	// written to a temp file and moved over the old one,same as the journal.
+	FString CachePath = GetCachePath();
+	FString TempPath = CachePath + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Data, *TempPath) || !IFileManager::Get().Move(*CachePath, *TempPath, true, true))
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadMetadataCache:save %s faild."), *CachePath);
+		return false;
+	}
+	return true;
+}
+
+void FDownloadMetadataCache::MarkDirty()
+{
+	if (!SaveDelegateHandle.IsValid())
+	{
+		SaveDelegateHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FDownloadMetadataCache::OnSaveTick), METADATA_CACHE_SAVE_DELAY);
+	}
+}
+
+bool FDownloadMetadataCache::OnSaveTick(float InDeltaTime)
+{
+	SaveDelegateHandle.Reset();
+	Save();
+	// save once
+	return false;
+}
+
+void FDownloadMetadataCache::Serialize(FArchive& Ar)
+{
+	uint32 Magic = METADATA_CACHE_MAGIC;
+	int32 Version = METADATA_CACHE_VERSION;
+	Ar << Magic << Version;
+	if (Ar.IsLoading() && (Magic != METADATA_CACHE_MAGIC || Version != METADATA_CACHE_VERSION))
+	{
+		Ar.SetError();
+		return;
+	}
+	int32 EntryCount = Entries.Num();
+	Ar << EntryCount;
+	if (Ar.IsLoading())
+	{
+		Entries.Reset();
+		for (int32 Index = 0; Index < EntryCount && !Ar.IsError(); ++Index)
+		{
+			FDownloadMetadata Metadata;
+			Ar << Metadata;
+			Entries.Add(Metadata.URL, Metadata);
+		}
+	}
+	else
+	{
+		for (auto& Entry : Entries)
+		{
+			Ar << Entry.Value;
+		}
+	}
+}
@@ -0,0 +1,149 @@
+#include "DownloadMetrics.h"
+
+// engine header
+#include "HAL/PlatformTime.h"
+
+#define METRICS_SAMPLE_INTERVAL 0.25 // second
+#define METRICS_WINDOW 5.0 // second
+#define METRICS_EWMA_TIME_CONSTANT 2.0 // second
+
+FDownloadMetricsTracker::FDownloadMetricsTracker()
+	: StartTime(0),
+	TotalLatency(0),
+	IntervalStartTime(0),
+	IntervalByte(0)
+{
+}
+
+void FDownloadMetricsTracker::Start(int64 InTotalByte, int64 InReceivedByte)
+{
+	Metrics = FDownloadMetrics();
+	Metrics.TotalByte = InTotalByte;
+	Metrics.ReceivedByte = InReceivedByte;
+	StartTime = FPlatformTime::Seconds();
+	TotalLatency = 0;
+	IntervalStartTime = StartTime;
+	IntervalByte = 0;
+	Samples.Reset();
+}
+
+void FDownloadMetricsTracker::Update()
+{
+	if (!IsStarted())
+	{
+		return;
+	}
+	double Now = FPlatformTime::Seconds();
+	double Duration = Now - IntervalStartTime;
+	if (Duration < METRICS_SAMPLE_INTERVAL)
+	{
+		return;
+	}
+
+	// the weight of a sample depend on its duration,so a long frame not skew the average.
+	double Rate = IntervalByte / Duration;
+	double Alpha = 1.0 - FMath::Exp(-Duration / METRICS_EWMA_TIME_CONSTANT);
+	Metrics.BytesPerSecondEWMA = (float)(Metrics.BytesPerSecondEWMA + Alpha * (Rate - Metrics.BytesPerSecondEWMA));
+
+	FSample& Sample = Samples.AddDefaulted_GetRef();
+	Sample.EndTime = Now;
+	Sample.Duration = Duration;
+	Sample.Byte = IntervalByte;
+	Samples.RemoveAll([Now](const FSample& InSample) { return Now - InSample.EndTime > METRICS_WINDOW; });
+
+	IntervalStartTime = Now;
+	IntervalByte = 0;
+}
+
+void FDownloadMetricsTracker::AddReceivedByte(int64 InByte)
+{
+	if (Metrics.TimeToFirstByte < 0 && InByte > 0 && IsStarted())
+	{
+		Metrics.TimeToFirstByte = (float)(FPlatformTime::Seconds() - StartTime);
+	}
+	Metrics.ReceivedByte += InByte;
+	IntervalByte += InByte;
+}
+
+void FDownloadMetricsTracker::RemoveReceivedByte(int64 InByte)
+{
+	Metrics.ReceivedByte -= InByte;
+	Metrics.RetriedByte += InByte;
+	Metrics.WastedByte += InByte;
+}
+
+void FDownloadMetricsTracker::AddRequestLatency(double InLatency)
+{
+	++Metrics.RequestCount;
+	TotalLatency += InLatency;
+	Metrics.LastRequestLatency = (float)InLatency;
+	Metrics.AverageRequestLatency = (float)(TotalLatency / Metrics.RequestCount);
+}
+
+FDownloadMetrics FDownloadMetricsTracker::GetMetrics()const
+{
+	FDownloadMetrics Result = Metrics;
+	if (!IsStarted())
+	{
+		return Result;
+	}
+	Result.ElapsedSeconds = (float)(FPlatformTime::Seconds() - StartTime);
+
+	double WindowDuration = 0;
+	int64 WindowByte = 0;
+	for (const FSample& Sample : Samples)
+	{
+		WindowDuration += Sample.Duration;
+		WindowByte += Sample.Byte;
+	}
+	Result.BytesPerSecondWindow = WindowDuration > 0 ? (float)(WindowByte / WindowDuration) : 0.f;
+
+	int64 RemainingByte = Result.TotalByte - Result.ReceivedByte;
+	if (RemainingByte <= 0)
+	{
+		Result.ETASeconds = Result.TotalByte > 0 ? 0.f : -1.f;
+	}
+	else if (Result.BytesPerSecondEWMA > 0)
+	{
+		Result.ETASeconds = (float)(RemainingByte / Result.BytesPerSecondEWMA);
+	}
+	return Result;
+}
+
+FDownloadMetrics FDownloadMetricsTracker::Aggregate(const TArray<FDownloadMetrics>& InMetrics)
+{
+	FDownloadMetrics Result;
+	double TotalLatency = 0;
+	for (const FDownloadMetrics& Metrics : InMetrics)
+	{
+		Result.BytesPerSecondEWMA += Metrics.BytesPerSecondEWMA;
+		Result.BytesPerSecondWindow += Metrics.BytesPerSecondWindow;
+		Result.RequestCount += Metrics.RequestCount;
+		Result.ReceivedByte += Metrics.ReceivedByte;
+		Result.TotalByte += Metrics.TotalByte;
+		Result.RetriedByte += Metrics.RetriedByte;
+		Result.RetryCount += Metrics.RetryCount;
+		Result.WastedByte += Metrics.WastedByte;
+		Result.ElapsedSeconds = FMath::Max(Result.ElapsedSeconds, Metrics.ElapsedSeconds);
+		Result.ConnectionCount += Metrics.ConnectionCount;
+		Result.RequestByte = FMath::Max(Result.RequestByte, Metrics.RequestByte);
+		TotalLatency += (double)Metrics.AverageRequestLatency * Metrics.RequestCount;
+		if (Metrics.TimeToFirstByte >= 0)
+		{
+			Result.TimeToFirstByte = Result.TimeToFirstByte < 0 ? Metrics.TimeToFirstByte : FMath::Min(Result.TimeToFirstByte, Metrics.TimeToFirstByte);
+		}
+		Result.LastRequestLatency = FMath::Max(Result.LastRequestLatency, Metrics.LastRequestLatency);
+	}
+	Result.AverageRequestLatency = Result.RequestCount ? (float)(TotalLatency / Result.RequestCount) : 0.f;
+
+	int64 RemainingByte = Result.TotalByte - Result.ReceivedByte;
+	if (RemainingByte <= 0)
+	{
+		Result.ETASeconds = Result.TotalByte > 0 ? 0.f : -1.f;
+	}
+	else if (Result.BytesPerSecondEWMA > 0)
+	{
+		Result.ETASeconds = (float)(RemainingByte / Result.BytesPerSecondEWMA);
+	}
+	return Result;
+}
@@ -0,0 +1,21 @@
+#include "DownloadRetryPolicy.h"
+
+bool FDownloadRetryPolicy::IsRetryable(int32 InResponseCode, bool bInConnected)const
+{
+	if (MaxRetryCount <= 0)
+	{
+		return false;
+	}
+	if (!bInConnected || InResponseCode == 0)
+	{
+		return bRetryConnectionError;
+	}
+	return RetryableResponseCodes.Contains(InResponseCode);
+}
+
+float FDownloadRetryPolicy::GetRetryDelay(int32 InRetryCount)const
+{
+	float Delay = InitialDelaySeconds * FMath::Pow(FMath::Max(BackoffMultiplier, 1.f), (float)FMath::Max(InRetryCount - 1, 0));
+	Delay = FMath::Clamp(Delay, 0.f, MaxDelaySeconds);
+	return Delay * (1.f - FMath::Clamp(JitterRatio, 0.f, 1.f) * FMath::FRand());
+}
@@ -0,0 +1,109 @@
+#include "DownloadSourceSelector.h"
+#include "DownloadTookitLog.h"
+
+#define MAX_SOURCE_CONSECUTIVE_ERROR 3
+#define SOURCE_THROUGHPUT_ALPHA 0.3
+
+void FDownloadSourceSelector::Reset(const FString& InURL, const TArray<FString>& InMirrorURLs)
+{
+	Sources.Reset();
+	Sources.AddDefaulted_GetRef().URL = InURL;
+	for (const FString& MirrorURL : InMirrorURLs)
+	{
+		if (!MirrorURL.IsEmpty() && !Sources.ContainsByPredicate([&MirrorURL](const FDownloadSource& Source) { return Source.URL == MirrorURL; }))
+		{
+			Sources.AddDefaulted_GetRef().URL = MirrorURL;
+		}
+	}
+}
+
+bool FDownloadSourceSelector::HasAvailableSource()const
+{
+	return Sources.ContainsByPredicate([](const FDownloadSource& Source) { return !Source.bExcluded; });
+}
+
+int32 FDownloadSourceSelector::Pick()const
+{
+	int32 BestIndex = INDEX_NONE;
+	double BestScore = -1;
+	for (int32 Index = 0; Index < Sources.Num(); ++Index)
+	{
+		const FDownloadSource& Source = Sources[Index];
+		if (Source.bExcluded)
+			continue;
+		// not measured yet,try it once
+		if (!Source.SampleCount && !Source.ActiveRequestCount)
+			return Index;
+		double Score = GetScore(Source);
+		if (Score > BestScore)
+		{
+			BestScore = Score;
+			BestIndex = Index;
+		}
+	}
+	return BestIndex;
+}
+
+double FDownloadSourceSelector::GetScore(const FDownloadSource& InSource)const
+{
+	double SuccessRate = (InSource.SampleCount + 1.0) / (InSource.SampleCount + InSource.ErrorCount + 1.0);
+	return InSource.BytesPerSecond * SuccessRate * SuccessRate / (1 + InSource.ActiveRequestCount);
+}
+
+void FDownloadSourceSelector::OnRequestStarted(int32 InSourceIndex)
+{
+	++Sources[InSourceIndex].ActiveRequestCount;
+}
+
+void FDownloadSourceSelector::OnRequestCompleted(int32 InSourceIndex, int64 InByte, double InSeconds)
+{
+	FDownloadSource& Source = Sources[InSourceIndex];
+	OnRequestFinished(InSourceIndex);
+	Source.ConsecutiveErrorCount = 0;
+	if (InSeconds <= 0)
+	{
+		return;
+	}
+	double Rate = InByte / InSeconds;
+	Source.BytesPerSecond = Source.SampleCount ? Source.BytesPerSecond + SOURCE_THROUGHPUT_ALPHA * (Rate - Source.BytesPerSecond) : Rate;
+	++Source.SampleCount;
+}
+
+void FDownloadSourceSelector::OnRequestFailed(int32 InSourceIndex)
+{
+	FDownloadSource& Source = Sources[InSourceIndex];
+	OnRequestFinished(InSourceIndex);
+	++Source.ErrorCount;
+	if (++Source.ConsecutiveErrorCount >= MAX_SOURCE_CONSECUTIVE_ERROR)
+	{
+		Exclude(InSourceIndex, TEXT("too many errors"));
+	}
+}
+
+void FDownloadSourceSelector::OnRequestFinished(int32 InSourceIndex)
+{
+	FDownloadSource& Source = Sources[InSourceIndex];
+	Source.ActiveRequestCount = FMath::Max(0, Source.ActiveRequestCount - 1);
+}
+
+void FDownloadSourceSelector::Exclude(int32 InSourceIndex, const TCHAR* InReason)
+{
+	FDownloadSource& Source = Sources[InSourceIndex];
+	if (!Source.bExcluded)
+	{
+		Source.bExcluded = true;
+		UE_LOG(DownloadTookitLog, Warning, TEXT("FDownloadSourceSelector:%s is excluded,%s."), *Source.URL, InReason);
+	}
+}
+
+bool FDownloadSourceSelector::UpdateValidators(int32 InSourceIndex, const FString& InETag, const FString& InLastModified)
+{
+	FDownloadSource& Source = Sources[InSourceIndex];
+	if (Source.ETag.IsEmpty() && Source.LastModified.IsEmpty())
+	{
+		Source.ETag = InETag;
+		Source.LastModified = InLastModified;
+		return true;
+	}
+	return Source.ETag == InETag && Source.LastModified == InLastModified;
+}
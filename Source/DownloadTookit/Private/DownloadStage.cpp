@@ -0,0 +1,183 @@
+#include "DownloadStage.h"
+#include "DownloadTookitLog.h"
+#include "DownloadTookitStats.h"
+
+// engine header
+#include "Async/Async.h"
+#include "HAL/PlatformProcess.h"
+
+#define STAGE_QUEUE_SIZE 1024*1024*32 // 32MB
+#define STAGE_WAIT_MS 100
+
+FDownloadStage::FDownloadStage(const TCHAR* InThreadName, int64 InMaxQueuedByte)
+	: ThreadName(InThreadName),
+	MaxQueuedByte(InMaxQueuedByte > 0 ? InMaxQueuedByte : STAGE_QUEUE_SIZE),
+	Thread(NULL),
+	WakeupEvent(NULL)
+{
+}
+
+FDownloadStage::~FDownloadStage()
+{
+	StopThread();
+}
+
+bool FDownloadStage::Start()
+{
+	if (Thread)
+	{
+		return true;
+	}
+	if (!OnStart())
+	{
+		return false;
+	}
+	WakeupEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, *ThreadName, 0, TPri_BelowNormal);
+	if (!Thread)
+	{
+		// the platform not support multithreading
+		UE_LOG(DownloadTookitLog, Error, TEXT("FDownloadStage:create %s thread faild."), *ThreadName);
+		FPlatformProcess::ReturnSynchEventToPool(WakeupEvent);
+		WakeupEvent = NULL;
+		OnFinish();
+		return false;
+	}
+	return true;
+}
+
+bool FDownloadStage::Enqueue(int64 InOffset, const FDownloadBufferPtr& InData)
+{
+	if (!Thread || bCloseRequested || bHasError || !InData.IsValid() || !InData->Num())
+	{
+		return false;
+	}
+	QueuedByte.Add(InData->Num());
+	INC_MEMORY_STAT_BY(STAT_DownloadQueuedMemory, InData->Num());
+	FStageCommand Command;
+	Command.Offset = InOffset;
+	Command.Data = InData;
+	Queue.Enqueue(MoveTemp(Command));
+	WakeupEvent->Trigger();
+	return true;
+}
+
+bool FDownloadStage::Barrier(TFunction<void(bool)> InOnReached)
+{
+	if (!Thread || bCloseRequested || bHasError)
+	{
+		return false;
+	}
+	FStageCommand Command;
+	Command.Offset = 0;
+	Command.OnReached = MoveTemp(InOnReached);
+	Queue.Enqueue(MoveTemp(Command));
+	WakeupEvent->Trigger();
+	return true;
+}
+
+void FDownloadStage::Close(TFunction<void(bool)> InOnClosed)
+{
+	if (!Thread || bCloseRequested)
+	{
+		if (InOnClosed)
+			InOnClosed(!bHasError);
+		return;
+	}
+	OnClosed = MoveTemp(InOnClosed);
+	bCloseRequested = true;
+	WakeupEvent->Trigger();
+}
+
+bool FDownloadStage::IsQueueFull()const
+{
+	return QueuedByte.GetValue() >= MaxQueuedByte;
+}
+
+uint32 FDownloadStage::Run()
+{
+	if (!OnThreadStart())
+	{
+		SetError();
+	}
+	while (!bStopping)
+	{
+		WakeupEvent->Wait(STAGE_WAIT_MS);
+		ProcessQueue();
+		if (bCloseRequested)
+		{
+			// all buffers are queued before close request
+			ProcessQueue();
+			break;
+		}
+	}
+	OnFinish();
+
+	if (OnClosed)
+	{
+		// moved to game thread,the callback may hold the last reference of the stage.
+		bool bSuccessd = !bHasError;
+		AsyncTask(ENamedThreads::GameThread, [ClosedCallback = MoveTemp(OnClosed), bSuccessd]()
+		{
+			ClosedCallback(bSuccessd);
+		});
+	}
+	return 0;
+}
+
+void FDownloadStage::Stop()
+{
+	bStopping = true;
+	if (WakeupEvent)
+	{
+		WakeupEvent->Trigger();
+	}
+}
+
+void FDownloadStage::StopThread()
+{
+	if (Thread)
+	{
+		Stop();
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = NULL;
+		// the buffers left in queue are released with the stage
+		DEC_MEMORY_STAT_BY(STAT_DownloadQueuedMemory, QueuedByte.GetValue());
+		QueuedByte.Reset();
+	}
+	if (WakeupEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WakeupEvent);
+		WakeupEvent = NULL;
+	}
+}
+
+void FDownloadStage::ProcessQueue()
+{
+	FStageCommand Command;
+	while (Queue.Dequeue(Command))
+	{
+		if (!Command.Data.IsValid())
+		{
+			// the owner may be gone when the stage is stopping
+			if (!bStopping && Command.OnReached)
+			{
+				bool bReached = !bHasError && OnBarrier();
+				AsyncTask(ENamedThreads::GameThread, [ReachedCallback = MoveTemp(Command.OnReached), bReached]()
+				{
+					ReachedCallback(bReached);
+				});
+			}
+			Command.OnReached = nullptr;
+			continue;
+		}
+		if (!bHasError && !bStopping)
+		{
+			OnBuffer(Command.Offset, *Command.Data);
+		}
+		QueuedByte.Subtract(Command.Data->Num());
+		DEC_MEMORY_STAT_BY(STAT_DownloadQueuedMemory, Command.Data->Num());
+		Command.Data.Reset();
+	}
+}
@@ -0,0 +1,65 @@
+#include "DownloadTokenBucket.h"
+
+// engine header
+#include "HAL/PlatformTime.h"
+
+#define PACING_INTERVAL 0.25 // second
+#define MIN_PACING_BYTE 1024*16 // 16KB
+#define MAX_PACING_BYTE 1024*1024*4 // 4MB
+
+FDownloadTokenBucket::FDownloadTokenBucket(int64 InByteRate, int64 InBurstByte)
+	: ByteRate(0),
+	BurstByte(0),
+	Tokens(0),
+	LastRefillTime(0)
+{
+	SetByteRate(InByteRate, InBurstByte);
+}
+
+void FDownloadTokenBucket::SetByteRate(int64 InByteRate, int64 InBurstByte)
+{
+	Refill();
+	ByteRate = FMath::Max<int64>(InByteRate, 0);
+	BurstByte = InBurstByte > 0 ? InBurstByte : ByteRate;
+	// not keep the tokens saved by a higher rate
+	Tokens = FMath::Min<double>(Tokens, (double)BurstByte);
+	LastRefillTime = FPlatformTime::Seconds();
+}
+
+bool FDownloadTokenBucket::CanConsume()
+{
+	if (!IsLimited())
+	{
+		return true;
+	}
+	Refill();
+	return Tokens > 0;
+}
+
+void FDownloadTokenBucket::Consume(int64 InByte)
+{
+	if (IsLimited())
+	{
+		Refill();
+		Tokens -= InByte;
+	}
+}
+
+int64 FDownloadTokenBucket::GetPacingByte()const
+{
+	if (!IsLimited())
+	{
+		return 0;
+	}
+	return FMath::Clamp<int64>((int64)(ByteRate * PACING_INTERVAL), MIN_PACING_BYTE, MAX_PACING_BYTE);
+}
+
+void FDownloadTokenBucket::Refill()
+{
+	double Now = FPlatformTime::Seconds();
+	if (IsLimited())
+	{
+		Tokens = FMath::Min<double>(Tokens + (Now - LastRefillTime) * ByteRate, (double)BurstByte);
+	}
+	LastRefillTime = Now;
+}
@@ -1,6 +1,8 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "DownloadTookit.h"
+#include "DownloadMetadataCache.h"
+#include "DownloadContentStore.h"
 
 #define LOCTEXT_NAMESPACE "FDownloadTookitModule"
 
@@ -13,6 +15,8 @@ void FDownloadTookitModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FDownloadMetadataCache::Get().Flush();
+	FDownloadContentStore::Get().Flush();
 }
 
 #undef LOCTEXT_NAMESPACE
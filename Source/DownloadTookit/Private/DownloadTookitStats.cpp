@@ -0,0 +1,4 @@
+#include "DownloadTookitStats.h"
+
+DEFINE_STAT(STAT_DownloadPooledMemory);
+DEFINE_STAT(STAT_DownloadQueuedMemory);
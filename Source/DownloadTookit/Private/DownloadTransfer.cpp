@@ -0,0 +1,2360 @@
+#include "DownloadTransfer.h"
+#include "DownloadManager.h"
+#include "DownloadTookitLog.h"
+#include "DownloadTookitStats.h"
+
+// engine header
+#include "Containers/Ticker.h"
+#include "Containers/Queue.h"
+#include "Misc/SecureHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/CString.h"
+#include "Templates/UniquePtr.h"
+#include "Interfaces/IHttpRequest.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/IPlatformFileModule.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/FileManager.h"
+#include "Async/Async.h"
+
+static FString GetFileNameByURL(const FString& InURL);
+static int64 GetResponseContentLength(FHttpResponsePtr InHttpResponse);
+
+#define SLICE_SIZE 1024*1024*20 // 20MB
+// a chunk is verified as one segment
+#define MAX_SEGMENT_SIZE 1024*1024*1024ll // 1GB
+// the response content is held by http module until completed,so every request is bounded.
+// the size is chosen by auto tuner if enabled.
+#define MAX_REQUEST_SIZE 1024*1024*4 // 4MB
+#define MAX_CHUNK_RETRY 3
+#define JOURNAL_SAVE_INTERVAL 1.0f // second
+#define MAX_PIPELINE_DEPTH 8
+
+DECLARE_CYCLE_STAT(TEXT("Transfer Tick"), STAT_DownloadTransferTick, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Send Request"), STAT_DownloadSendRequest, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Request Progress"), STAT_DownloadRequestProgress, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Request Complete"), STAT_DownloadRequestComplete, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Copy Response"), STAT_DownloadCopyResponse, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Commit Ranges"), STAT_DownloadCommitRanges, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("File Info Complete"), STAT_DownloadFileInfoComplete, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Open Pipeline"), STAT_DownloadOpenPipeline, STATGROUP_DownloadTookit);
+// FileExists,DeleteFile,journal load/save on game thread
+DECLARE_CYCLE_STAT(TEXT("File System"), STAT_DownloadFileSystem, STATGROUP_DownloadTookit);
+DECLARE_CYCLE_STAT(TEXT("Broadcast Delegates"), STAT_DownloadBroadcast, STATGROUP_DownloadTookit);
+
+FDownloadTransfer::FDownloadTransfer()
+	:bTickByManager(false),
+	Status(EDownloadStatus::NotStarted),
+	TotalDownloadedByte(0),
+	TotalByte(0),
+	DownloadSpeed(0),
+	bRangeIgnored(false),
+	RequestSerial(0),
+	PipelineDepth(1),
+	WriteMode(EDownloadWriteMode::Buffered)
+{
+	// the settings are kept by reset,the rate limiter,auto tune settings and retry policy are default constructed.
+	HashAlgorithms.Add(EDownloadHashAlgorithm::MD5);
+	ResetState();
+}
+
+FDownloadTransfer::~FDownloadTransfer()
+{
+	// the delegates of requests and ticker are bound to the shared reference,already expired.
+	CancelAllRequest();
+	CloseFileWriter();
+	StopTicker();
+}
+
+bool FDownloadTransfer::DeferToGameThread(TFunction<void(FDownloadTransfer&)> InCommand)
+{
+	if (IsInGameThread())
+	{
+		return false;
+	}
+	TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe> WeakThis(AsShared());
+	AsyncTask(ENamedThreads::GameThread, [WeakThis, InCommand]()
+	{
+		TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer = WeakThis.Pin();
+		if (Transfer.IsValid())
+		{
+			InCommand(*Transfer);
+		}
+	});
+	return true;
+}
+
+void FDownloadTransfer::RequestDownload(const FString& InURL, const FString& InSavePathOpt, bool bInSliceOpt, int32 InSliceByteSizeOpt, bool bInForceOpt, int32 InConnectionCountOpt)
+{
+#if WITH_LOG
+	UE_LOG(DownloadTookitLog, Log, TEXT("RequestDownload::InURL:%s\nInSavePath:%s\nbSlice:%s\nInSliceByteSize:%d\nInConnectionCount:%d"), *InURL, *InSavePathOpt, bInSliceOpt ? TEXT("true") : TEXT("false"), InSliceByteSizeOpt, InConnectionCountOpt);
+#endif
+	FDownloadFile MakeDownloadFileInfo;
+	MakeDownloadFileInfo.URL = InURL;
+	MakeDownloadFileInfo.SavePath = InSavePathOpt;
+	RequestDownloadFile(MakeDownloadFileInfo, bInSliceOpt, InSliceByteSizeOpt, bInForceOpt, InConnectionCountOpt);
+}
+
+void FDownloadTransfer::RequestDownloadFile(const FDownloadFile& InDownloadFile, bool bInSliceOpt, int32 InSliceByteSizeOpt, bool bInForceOpt, int32 InConnectionCountOpt)
+{
+	if (DeferToGameThread([InDownloadFile, bInSliceOpt, InSliceByteSizeOpt, bInForceOpt, InConnectionCountOpt](FDownloadTransfer& Transfer) { Transfer.RequestDownloadFile(InDownloadFile, bInSliceOpt, InSliceByteSizeOpt, bInForceOpt, InConnectionCountOpt); }))
+	{
+		return;
+	}
+	if (bInForceOpt || (!HasActiveRequest() && (Status != EDownloadStatus::Downloading)))
+	{
+		// Reset(); // reset all member data to default
+		CancelAllRequest();
+		CloseFileWriter();
+
+		FDownloadFile MakeDownloadFileInfo = InDownloadFile;
+		bUseSlice = bInSliceOpt;
+		if (bInSliceOpt)
+		{
+			SliceByteSize = InSliceByteSizeOpt > 0 ? InSliceByteSizeOpt : SLICE_SIZE;  // range:0-999 is first 1000 byte.
+			UE_LOG(DownloadTookitLog, Log, TEXT("RequestDownload:SliceByteSize is %lld."),SliceByteSize);
+		}
+		ConnectionCount = FMath::Max(1, InConnectionCountOpt);
+		
+		if (MakeDownloadFileInfo.Name.IsEmpty())
+		{
+			MakeDownloadFileInfo.Name = FGenericPlatformHttp::UrlDecode(GetFileNameByURL(MakeDownloadFileInfo.URL));
+		}
+		if (MakeDownloadFileInfo.SavePath.IsEmpty())
+		{
+			MakeDownloadFileInfo.SavePath = FPaths::Combine(FPaths::ProjectSavedDir(),MakeDownloadFileInfo.Name);
+			UE_LOG(DownloadTookitLog, Warning, TEXT("RequestDownload: InSavePath is empty,default is %s."), *MakeDownloadFileInfo.SavePath);
+		}
+		
+		PreRequestFileInfo(MakeDownloadFileInfo);
+	}
+	else
+	{
+		UE_LOG(DownloadTookitLog, Log, TEXT("RequestDownload::The Download mision is active,please cancel it and try again."));
+	}
+}
+
+void FDownloadTransfer::Pause()
+{
+	if (DeferToGameThread([](FDownloadTransfer& Transfer) { Transfer.Pause(); }))
+	{
+		return;
+	}
+	if (HasActiveRequest() || (Status == EDownloadStatus::Downloading && HasPendingRetry()))
+	{
+		// change status first,the canceled request may be completed immediately.
+		Status = EDownloadStatus::Paused;
+		CancelAllRequest();
+		SaveJournal();
+		// the decoder state is kept in memory,continued by resume.
+		if (!IsDecoding())
+			CloseFileWriter();
+		DownloadSpeed = 0;
+#if WITH_LOG
+		UE_LOG(DownloadTookitLog, Warning, TEXT("Download mission is paused,downloaded size is:%lld."), TotalDownloadedByte.Load());
+#endif
+		StartTicker();
+		SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+		OnDownloadPausedMultiDlg.Broadcast();
+
+	}
+	else if (IsPreparing())
+	{
+		// the file info,delta index or content store is dropped,started again by resume.
+		Status = EDownloadStatus::Paused;
+		CancelPreparing();
+		UE_LOG(DownloadTookitLog, Warning, TEXT("Download mission is paused before the segments are built."));
+		SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+		OnDownloadPausedMultiDlg.Broadcast();
+	}
+}
+
+bool FDownloadTransfer::Resume()
+{
+	if (DeferToGameThread([](FDownloadTransfer& Transfer) { Transfer.Resume(); }))
+	{
+		return true;
+	}
+	bool bResumeStatus = false;
+	if (!Segments.Num() && Status == EDownloadStatus::Paused)
+	{
+		// paused before the segments built
+		bResumeStatus = true;
+		{
+			SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+			OnDownloadResumedMultiDlg.Broadcast();
+		}
+		PreRequestFileInfo(PassInDownloadFileInfo);
+	}
+	else if (Segments.Num() && Status == EDownloadStatus::Paused)
+	{
+		// every uncompleted segment continue from its received byte
+		if (OpenFileWriter() && RequestPendingSegments())
+		{
+			bResumeStatus = true;
+			{
+				SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+				OnDownloadResumedMultiDlg.Broadcast();
+			}
+			// the last chunks are verified while paused
+			if (IsAllSegmentsCompleted())
+			{
+				ContinueDownload();
+			}
+		}
+		else
+		{
+			CancelAllRequest();
+			CloseFileWriter();
+			Status = EDownloadStatus::Paused;
+		}
+	}
+	else
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("Download Resume Faild, becouse the download mission is not paused."));
+	}
+	return bResumeStatus;
+}
+
+bool FDownloadTransfer::ReDownload()
+{
+	if (DeferToGameThread([](FDownloadTransfer& Transfer) { Transfer.ReDownload(); }))
+	{
+		return true;
+	}
+	bool bStatus = false;
+	if (GetDownloadStatus() == EDownloadStatus::Downloading)
+	{
+		PreRequestFileInfo(PassInDownloadFileInfo, false);
+		bStatus = true;
+	}
+
+	UE_LOG(DownloadTookitLog, Warning, TEXT("ReDwonload is %s."), bStatus ? TEXT("accept"):TEXT("not accept,because the downloadproxy is downloading"));
+	return bStatus;
+}
+
+void FDownloadTransfer::Cancel()
+{
+	if (DeferToGameThread([](FDownloadTransfer& Transfer) { Transfer.Cancel(); }))
+	{
+		return;
+	}
+	// not started,preparing or paused before the segments are built is canceled too.
+	if (Status == EDownloadStatus::NotStarted || Status == EDownloadStatus::Downloading || Status == EDownloadStatus::Paused)
+	{
+		CancelPreparing();
+		CancelAllRequest();
+		CloseFileWriter();
+		PendingJournal.Reset();
+		if (!InternalDownloadFileInfo.SavePath.IsEmpty())
+			FDownloadJournal::Delete(InternalDownloadFileInfo.SavePath);
+
+		StopTicker();
+		Status = EDownloadStatus::Canceled;
+#if WITH_LOG
+		UE_LOG(DownloadTookitLog, Warning, TEXT("Download Cancel"));
+#endif
+		{
+			SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+			OnDownloadCanceledMultiDlg.Broadcast();
+		}
+		Reset();
+	}
+}
+
+bool FDownloadTransfer::IsPreparing()const
+{
+	return Status == EDownloadStatus::Downloading && !Segments.Num();
+}
+
+void FDownloadTransfer::CancelPreparing()
+{
+	CancelAllRequest();
+	// the results of async work are ignored
+	++RequestSerial;
+	if (DeltaIndex.IsValid())
+	{
+		DeltaIndex->bCanceled = true;
+		DeltaIndex.Reset();
+	}
+}
+
+void FDownloadTransfer::Reset()
+{
+	if (DeferToGameThread([](FDownloadTransfer& Transfer) { Transfer.Reset(); }))
+	{
+		return;
+	}
+	// only the active mission is canceled,reset a not started one dont notify.
+	if (Status == EDownloadStatus::Downloading || Status == EDownloadStatus::Paused)
+		Cancel();
+	ResetState();
+}
+
+void FDownloadTransfer::ResetState()
+{
+	// the request of file info
+	CancelAllRequest();
+	CloseFileWriter();
+	HashStage.Reset();
+	HashDigests.Empty();
+	ChunkVerifier.Reset();
+	bHashReadBack = false;
+	StreamHashOffset = 0;
+	PendingJournal.Reset();
+	JournalElapsedTime = 0.f;
+	BufferPool.Reset();
+	Segments.Empty();
+	InternalDownloadFileInfo = FDownloadFile();
+	PassInDownloadFileInfo = FDownloadFile();
+	Status = EDownloadStatus::NotStarted;
+	TotalDownloadedByte = 0;
+	TotalByte = 0;
+	DownloadSpeed = 0;
+	ReceivedByteInFrame = 0;
+	DeltaTime = 0.f;
+	bUseSlice = false;
+	SliceCount = 0;
+	SliceByteSize = 0;
+	ConnectionCount = 1;
+	AutoTuner.Start(AutoTuneSettings, ConnectionCount, MAX_REQUEST_SIZE);
+	TotalRetryCount = 0;
+	DeltaIndex.Reset();
+	bRangeIgnored = false;
+	++RequestSerial;
+}
+
+bool FDownloadTransfer::Tick(float delta)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadTransferTick);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadTransfer Tick"));
+	DeltaTime = delta;
+	DownloadSpeed = ReceivedByteInFrame;
+	ReceivedByteInFrame = 0;
+	Metrics.Update();
+	AutoTuner.Update(Status == EDownloadStatus::Downloading && HasActiveRequest() && !IsRateLimited());
+	// requests wait for the tokens or the busy stages are sent by tick,
+	// the writer open and preallocate the file on its thread,the failure is found here.
+	if (Status == EDownloadStatus::Downloading && FileWriter.IsValid() && (FileWriter->HasError() || !RequestPendingSegments()))
+	{
+		FinishDownload(false);
+		return true;
+	}
+	if (Status == EDownloadStatus::Downloading)
+	{
+		JournalElapsedTime += delta;
+		if (JournalElapsedTime >= JOURNAL_SAVE_INTERVAL && !PendingJournal.IsValid())
+		{
+			JournalElapsedTime = 0.f;
+			SaveJournal();
+		}
+	}
+	return true;
+}
+
+FDownloadFile FDownloadTransfer::GetDownloadedFileInfo() const
+{
+	if (Status == EDownloadStatus::Succeeded)
+	{
+		return InternalDownloadFileInfo;
+	}
+	else
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("The Download Mission is not successed."));
+		return PassInDownloadFileInfo;
+	}
+}
+
+EDownloadStatus FDownloadTransfer::GetDownloadStatus() const
+{
+	return Status;
+}
+
+int64 FDownloadTransfer::GetDownloadedSize64() const
+{
+	return TotalDownloadedByte;
+}
+
+int64 FDownloadTransfer::GetTotalSize64() const
+{
+	return TotalByte;
+}
+
+FDownloadTransferSnapshot FDownloadTransfer::GetSnapshot() const
+{
+	FDownloadTransferSnapshot Snapshot;
+	Snapshot.Status = Status;
+	Snapshot.DownloadedByte = TotalDownloadedByte;
+	Snapshot.TotalByte = TotalByte;
+	Snapshot.DownloadSpeed = DownloadSpeed;
+	return Snapshot;
+}
+
+float FDownloadTransfer::GetDownloadProgress() const
+{
+	float result=0.f;
+	const EDownloadStatus CurrentStatus = Status;
+	const int64 CurrentTotalByte = TotalByte;
+	if ((CurrentStatus == EDownloadStatus::Downloading || CurrentStatus == EDownloadStatus::Paused) && CurrentTotalByte > 0)
+	{
+		result = (double)TotalDownloadedByte.Load()/(double)CurrentTotalByte;
+	}
+	
+	return result;
+}
+
+int64 FDownloadTransfer::GetDownloadSpeed()const
+{
+	return DownloadSpeed;
+}
+
+float FDownloadTransfer::GetDownloadSpeedKbs() const
+{
+	float result = 0.f;
+	if (GetDownloadStatus() == EDownloadStatus::Downloading)
+	{
+		result = Metrics.GetMetrics().BytesPerSecondWindow / 1024.f;
+	}
+	return result;
+}
+
+FDownloadMetrics FDownloadTransfer::GetMetrics()const
+{
+	FDownloadMetrics Result = Metrics.GetMetrics();
+	if (Status == EDownloadStatus::Downloading)
+	{
+		Result.ConnectionCount = AutoTuner.GetConnectionCount();
+		Result.RequestByte = AutoTuner.GetRequestByte();
+	}
+	return Result;
+}
+
+void FDownloadTransfer::SetAutoTuneSettings(const FDownloadAutoTuneSettings& InSettings)
+{
+	if (DeferToGameThread([InSettings](FDownloadTransfer& Transfer) { Transfer.SetAutoTuneSettings(InSettings); }))
+	{
+		return;
+	}
+	if (HashStage.IsValid())
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("SetAutoTuneSettings:the download mission is active,please set it before RequestDownload."));
+		return;
+	}
+	AutoTuneSettings = InSettings;
+}
+
+FDownloadAutoTuneSettings FDownloadTransfer::GetAutoTuneSettings()const
+{
+	return AutoTuneSettings;
+}
+
+int32 FDownloadTransfer::GetConnectionCount()const
+{
+	return AutoTuner.GetConnectionCount();
+}
+
+int64 FDownloadTransfer::GetRequestByte()const
+{
+	return AutoTuner.GetRequestByte();
+}
+
+void FDownloadTransfer::SetRetryPolicy(const FDownloadRetryPolicy& InPolicy)
+{
+	if (DeferToGameThread([InPolicy](FDownloadTransfer& Transfer) { Transfer.SetRetryPolicy(InPolicy); }))
+	{
+		return;
+	}
+	RetryPolicy = InPolicy;
+}
+
+FDownloadRetryPolicy FDownloadTransfer::GetRetryPolicy()const
+{
+	return RetryPolicy;
+}
+
+void FDownloadTransfer::SetWriteMode(EDownloadWriteMode InWriteMode)
+{
+	if (DeferToGameThread([InWriteMode](FDownloadTransfer& Transfer) { Transfer.SetWriteMode(InWriteMode); }))
+	{
+		return;
+	}
+	if (FileWriter.IsValid())
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("SetWriteMode:the file is opened,please set it before RequestDownload."));
+		return;
+	}
+	WriteMode = InWriteMode;
+}
+
+EDownloadWriteMode FDownloadTransfer::GetWriteMode()const
+{
+	return WriteMode;
+}
+
+bool FDownloadTransfer::HashCheck(const FString& InMD5Hash)const
+{
+	bool result = false;
+	if (Status == EDownloadStatus::Succeeded)
+	{
+		FString SavedFilePath = FPaths::Combine(InternalDownloadFileInfo.SavePath, InternalDownloadFileInfo.Name);
+		if (FPaths::FileExists(SavedFilePath))
+		{
+			result = InMD5Hash.Equals(InternalDownloadFileInfo.HASH,ESearchCase::IgnoreCase);
+#if WITH_LOG
+			UE_LOG(DownloadTookitLog, Log, TEXT("InMD5Hash is %s,CalcedHash is %s,is equal %s"), *InMD5Hash, *InternalDownloadFileInfo.HASH, result ? TEXT("true") : TEXT("false"));
+#endif
+		}
+	}
+	else
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("CheckFileHash:The Download Mission is not successed."));
+	}
+	return result;
+}
+
+void FDownloadTransfer::SetHashAlgorithms(const TArray<EDownloadHashAlgorithm>& InAlgorithms)
+{
+	if (DeferToGameThread([InAlgorithms](FDownloadTransfer& Transfer) { Transfer.SetHashAlgorithms(InAlgorithms); }))
+	{
+		return;
+	}
+	if (HashStage.IsValid())
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("SetHashAlgorithms:the download mission is active,please set it before RequestDownload."));
+		return;
+	}
+	HashAlgorithms.Reset();
+	for (EDownloadHashAlgorithm Algorithm : InAlgorithms)
+	{
+		HashAlgorithms.AddUnique(Algorithm);
+	}
+	if (!HashAlgorithms.Num())
+	{
+		HashAlgorithms.Add(EDownloadHashAlgorithm::MD5);
+	}
+}
+
+void FDownloadTransfer::SetPipelineDepth(int32 InDepth)
+{
+	if (DeferToGameThread([InDepth](FDownloadTransfer& Transfer) { Transfer.SetPipelineDepth(InDepth); }))
+	{
+		return;
+	}
+	PipelineDepth = FMath::Clamp(InDepth, 1, MAX_PIPELINE_DEPTH);
+	// deeper pipeline request the next ranges now
+	if (Status == EDownloadStatus::Downloading && FileWriter.IsValid() && !RequestPendingSegments())
+	{
+		FinishDownload(false);
+	}
+}
+
+int32 FDownloadTransfer::GetPipelineDepth()const
+{
+	return PipelineDepth;
+}
+
+void FDownloadTransfer::SetRateLimit(int64 InBytePerSecond)
+{
+	if (DeferToGameThread([InBytePerSecond](FDownloadTransfer& Transfer) { Transfer.SetRateLimit(InBytePerSecond); }))
+	{
+		return;
+	}
+	RateLimiter.SetByteRate(InBytePerSecond);
+}
+
+int64 FDownloadTransfer::GetRateLimit()const
+{
+	return RateLimiter.GetByteRate();
+}
+
+FString FDownloadTransfer::GetHashDigest(EDownloadHashAlgorithm InAlgorithm)const
+{
+	const FString* Digest = HashDigests.Find(InAlgorithm);
+	return Digest ? *Digest : FString();
+}
+
+TMap<EDownloadHashAlgorithm, FString> FDownloadTransfer::GetHashDigests()const
+{
+	return HashDigests;
+}
+
+void FDownloadTransfer::OnDownloadProcess(FHttpRequestPtr RequestPtr, int32 byteSent, int32 byteReceive)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadRequestProgress);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadTransfer Progress"));
+	if (EHttpRequestStatus::Processing != RequestPtr->GetStatus())
+	{
+#if WITH_LOG
+		UE_LOG(DownloadTookitLog, Log, TEXT("OnDownloadProcess:Request Status is %d,is not processing."), (int32)RequestPtr->GetStatus());
+#endif
+		return;
+	}
+	int32 RequestIndex = INDEX_NONE;
+	FDownloadSegment* Segment = FindSegment(RequestPtr, RequestIndex);
+	if (!Segment || EDownloadStatus::Downloading != Status)
+	{
+		return;
+	}
+
+	if (FileWriter.IsValid() && FileWriter->HasError())
+	{
+		FinishDownload(false);
+		return;
+	}
+	FDownloadSegmentRequest& SegmentRequest = Segment->Requests[RequestIndex];
+	// the server ignored Range,the response would hold the whole file in memory.
+	if (byteReceive > SegmentRequest.Length)
+	{
+		OnRangeIgnored(*Segment, RequestIndex);
+		return;
+	}
+	if (!SegmentRequest.bFirstByte && byteReceive > 0)
+	{
+		SegmentRequest.bFirstByte = true;
+		Metrics.AddRequestLatency(FPlatformTime::Seconds() - SegmentRequest.StartTime);
+		DOWNLOAD_TRACE_EVENT(TEXT("Download FirstByte %lld"), Segment->Range.BeginPosition + SegmentRequest.Offset);
+	}
+	// the content is read when completed,the progress only update the metrics.
+	int64 ProgressByte = FMath::Min<int64>(byteReceive, SegmentRequest.Length) - SegmentRequest.ResponseReceivedByte;
+	if (ProgressByte > 0)
+	{
+		SegmentRequest.ResponseReceivedByte += ProgressByte;
+		ReceivedByteInFrame += ProgressByte;
+		Metrics.AddReceivedByte(ProgressByte);
+		AutoTuner.AddReceivedByte(ProgressByte);
+	}
+}
+
+bool FDownloadTransfer::IsStageBusy()const
+{
+	return (FileWriter.IsValid() && FileWriter->IsQueueFull()) || (IsStreamHash() && HashStage->IsQueueFull()) ||
+		(DecodeStage.IsValid() && DecodeStage->IsQueueFull());
+}
+
+bool FDownloadTransfer::ReceiveSegmentRequest(FDownloadSegmentRequest& InRequest, FHttpResponsePtr ResponsePtr)
+{
+	if (!ResponsePtr.IsValid())
+	{
+		return false;
+	}
+	// the validators of file info are got from URL
+	int32 SourceIndex = InRequest.SourceIndex;
+	if (SourceIndex == 0)
+	{
+		UpdateValidators(ResponsePtr);
+	}
+	// a source of other content is not used any more
+	if (!Sources.UpdateValidators(SourceIndex, ResponsePtr->GetHeader(TEXT("ETag")), ResponsePtr->GetHeader(TEXT("Last-Modified"))))
+	{
+		Sources.Exclude(SourceIndex, TEXT("the validator is changed"));
+		return false;
+	}
+	FString TotalSize;
+	if (ResponsePtr->GetResponseCode() == 206 && ResponsePtr->GetHeader(TEXT("Content-Range")).Split(TEXT("/"), NULL, &TotalSize) &&
+		TotalSize.IsNumeric() && FCString::Atoi64(*TotalSize) != InternalDownloadFileInfo.Size)
+	{
+		Sources.Exclude(SourceIndex, TEXT("the size is mismatched"));
+		return false;
+	}
+	// the server not accept range
+	int64 ExpectedLength = InRequest.Length;
+	if (GetResponseContentLength(ResponsePtr) != ExpectedLength)
+	{
+		return false;
+	}
+	const TArray<uint8>& ResponseDataArray = ResponsePtr->GetContent();
+	if (ResponseDataArray.Num() != ExpectedLength)
+	{
+		return false;
+	}
+
+	// copy to a recycled buffer,the response is released with the request.
+	{
+		SCOPE_CYCLE_COUNTER(STAT_DownloadCopyResponse);
+		DOWNLOAD_TRACE_SCOPE(TEXT("DownloadTransfer CopyResponse"));
+		InRequest.Content = BufferPool.Acquire(ExpectedLength);
+		FMemory::Memcpy(InRequest.Content->GetData(), ResponseDataArray.GetData(), ExpectedLength);
+	}
+	// the last progress callback not always report the tail of the response
+	int64 UnreportedLength = ExpectedLength - InRequest.ResponseReceivedByte;
+	if (UnreportedLength > 0)
+	{
+		InRequest.ResponseReceivedByte += UnreportedLength;
+		ReceivedByteInFrame += UnreportedLength;
+		Metrics.AddReceivedByte(UnreportedLength);
+		AutoTuner.AddReceivedByte(UnreportedLength);
+	}
+	return true;
+}
+
+bool FDownloadTransfer::CommitSegmentRequests()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadCommitRanges);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadTransfer Commit"));
+	bool bCommitted = true;
+	while (bCommitted)
+	{
+		bCommitted = false;
+		for (int32 SegmentIndex = 0; SegmentIndex < Segments.Num(); ++SegmentIndex)
+		{
+			FDownloadSegment& Segment = Segments[SegmentIndex];
+			// the front request of segment is committed first
+			if (!Segment.Requests.Num() || !Segment.Requests[0].Content.IsValid())
+				continue;
+			int64 WriteOffset = Segment.Range.BeginPosition + Segment.ReceivedByte;
+			// the stream hash and decoder need the content in file order,the later slices wait for the previous one.
+			const bool bStreamHash = IsStreamHash();
+			const bool bStreamOrder = bStreamHash || IsDecoding();
+			if (bStreamOrder && WriteOffset != StreamHashOffset)
+				continue;
+
+			FDownloadBufferPtr Buffer = Segment.Requests[0].Content;
+			int64 PaddingLength = Buffer->Num();
+			TSharedPtr<FDownloadStage, ESPMode::ThreadSafe> FirstStage = FileWriter;
+			if (IsDecoding())
+				FirstStage = DecodeStage;
+			if (!FirstStage.IsValid() || !FirstStage->Enqueue(WriteOffset, Buffer))
+			{
+				return false;
+			}
+			if (bStreamHash)
+			{
+				HashStage->Enqueue(WriteOffset, Buffer);
+			}
+			if (bStreamOrder)
+			{
+				StreamHashOffset += PaddingLength;
+			}
+			// hashed on the thread pool and dropped,the chunk is not kept in memory.
+			if (ChunkVerifier.IsValid())
+			{
+				ChunkVerifier->Update(SegmentIndex, Buffer);
+			}
+			Segment.ReceivedByte += PaddingLength;
+			TotalDownloadedByte += PaddingLength;
+			Segment.Requests.RemoveAt(0);
+			bCommitted = true;
+#if WITH_LOG
+			UE_LOG(DownloadTookitLog, Log, TEXT("CommitSegmentRequests:Offset is %lld,PaddingLength is %lld,Toltal Downloaded Byte is %lld."), WriteOffset, PaddingLength, TotalDownloadedByte.Load());
+#endif
+			if (Segment.ReceivedByte < Segment.GetLength())
+				continue;
+
+			UE_LOG(DownloadTookitLog, Log, TEXT("CommitSegmentRequests:Segment %lld-%lld is completed,TotalDownloadedByte is %lld,FileTotalSize is %lld"), Segment.Range.BeginPosition, Segment.Range.EndPosition, TotalDownloadedByte.Load(), InternalDownloadFileInfo.Size);
+			DOWNLOAD_TRACE_EVENT(TEXT("Download Slice %lld-%lld"), Segment.Range.BeginPosition, Segment.Range.EndPosition);
+			++SliceCount;
+			if (ChunkVerifier.IsValid())
+			{
+				// completed after verified,fetch next segments meanwhile.
+				VerifySegment(SegmentIndex);
+			}
+			else
+			{
+				Segment.bCompleted = true;
+			}
+		}
+	}
+	return true;
+}
+
+bool FDownloadTransfer::OpenFileWriter()
+{
+	if (!FileWriter.IsValid())
+	{
+		// the size of decoded file is unknown
+		int64 PreallocateSize = IsDecoding() ? 0 : InternalDownloadFileInfo.Size;
+		FileWriter = MakeShared<FDownloadFileWriter, ESPMode::ThreadSafe>(InternalDownloadFileInfo.SavePath, 0, 0, WriteMode, PreallocateSize);
+		if (!FileWriter->Start())
+		{
+			FileWriter.Reset();
+		}
+	}
+	if (FileWriter.IsValid() && IsDecoding() && !DecodeStage.IsValid())
+	{
+		// the decoded content is written,and hashed if the HASH is of decoded content.
+		TArray<TSharedPtr<FDownloadStage, ESPMode::ThreadSafe>> NextStages;
+		NextStages.Add(FileWriter);
+		if (InternalDownloadFileInfo.bHashDecodedContent && HashStage.IsValid())
+		{
+			NextStages.Add(HashStage);
+		}
+		DecodeStage = MakeShared<FDownloadDecodeStage, ESPMode::ThreadSafe>(InternalDownloadFileInfo.ContentEncoding, NextStages);
+		if (!DecodeStage->Start())
+		{
+			DecodeStage.Reset();
+			CloseFileWriter();
+		}
+	}
+	return FileWriter.IsValid();
+}
+
+void FDownloadTransfer::CloseFileWriter(TFunction<void(bool)> InOnClosed)
+{
+	if (!FileWriter.IsValid())
+	{
+		if (InOnClosed)
+			InOnClosed(true);
+		return;
+	}
+	// the closing writer keep itself alive until its thread is finished.
+	TSharedPtr<FDownloadFileWriter, ESPMode::ThreadSafe> ClosingWriter = FileWriter;
+	FileWriter.Reset();
+	auto CloseWriter = [ClosingWriter, InOnClosed](bool bDecodeSuccessd)
+	{
+		ClosingWriter->Close([ClosingWriter, InOnClosed, bDecodeSuccessd](bool bWriteSuccessd)
+		{
+			if (InOnClosed)
+				InOnClosed(bDecodeSuccessd && bWriteSuccessd);
+		});
+	};
+	if (!DecodeStage.IsValid())
+	{
+		CloseWriter(true);
+		return;
+	}
+	// the decoder flush the tail of decoded content to the writer before it closed
+	TSharedPtr<FDownloadDecodeStage, ESPMode::ThreadSafe> ClosingDecodeStage = DecodeStage;
+	DecodeStage.Reset();
+	ClosingDecodeStage->Close([ClosingDecodeStage, CloseWriter](bool bDecodeSuccessd)
+	{
+		CloseWriter(bDecodeSuccessd);
+	});
+}
+
+void FDownloadTransfer::OnDownloadComplete(FHttpRequestPtr RequestPtr, FHttpResponsePtr ResponsePtr, bool bConnectedSuccessfully)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadRequestComplete);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadTransfer Complete"));
+#if WITH_LOG
+	UE_LOG(DownloadTookitLog, Warning, TEXT("OnDownloadComplete:Http Request is %s"), bConnectedSuccessfully ? TEXT("True") : TEXT("false"));
+#endif
+	
+	int32 RequestIndex = INDEX_NONE;
+	FDownloadSegment* Segment = FindSegment(RequestPtr, RequestIndex);
+	if (Status != EDownloadStatus::Downloading || !Segment)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("OnDownloadComplete:Current status is not downloading"));
+		return;
+	}
+
+	bool bRequestSuccessd = false;
+	if (bConnectedSuccessfully)
+	{
+		bool bHttpRequestSuccessed = RequestPtr.IsValid() && RequestPtr->GetStatus() == EHttpRequestStatus::Succeeded;
+		bool bResponseSuccessd = ResponsePtr.IsValid() && (ResponsePtr->GetResponseCode() >= 200 && ResponsePtr->GetResponseCode() < 300);
+		bRequestSuccessd = bConnectedSuccessfully && bHttpRequestSuccessed && bResponseSuccessd;
+
+#if WITH_LOG
+		if (RequestPtr.IsValid())
+			UE_LOG(DownloadTookitLog, Warning, TEXT("OnDownloadComplete:Http Request Status is %d"), (int32)RequestPtr->GetStatus());
+		if (ResponsePtr.IsValid())
+			UE_LOG(DownloadTookitLog, Warning, TEXT("OnDownloadComplete:Request Response code is %d."), ResponsePtr->GetResponseCode());
+#endif
+	}
+	FDownloadSegmentRequest& SegmentRequest = Segment->Requests[RequestIndex];
+	SegmentRequest.Request = NULL;
+	bool bRequestReceived = bRequestSuccessd && ReceiveSegmentRequest(SegmentRequest, ResponsePtr);
+	// the whole content of a range request,If-Range not matched or Range ignored.
+	bool bRangeFaild = !bRequestReceived && !bRangeIgnored && ResponsePtr.IsValid() && ResponsePtr->GetResponseCode() == 200;
+	bool bIfRangeFaild = bRangeFaild && IsIfRangeChanged(SegmentRequest.SourceIndex, ResponsePtr);
+	if (bRangeFaild && !bIfRangeFaild)
+	{
+		Sources.OnRequestFinished(SegmentRequest.SourceIndex);
+		OnRangeIgnored(*Segment, RequestIndex);
+		return;
+	}
+	if (bIfRangeFaild && SegmentRequest.SourceIndex > 0)
+	{
+		// the mirror is changed,the ranges of URL are still valid.
+		Sources.Exclude(SegmentRequest.SourceIndex, TEXT("the content is changed"));
+	}
+	else if (bIfRangeFaild)
+	{
+		// If-Range not matched,the received ranges are of the old content.
+		UE_LOG(DownloadTookitLog, Warning, TEXT("OnDownloadComplete:the remote content of %s is changed,download it again."), *InternalDownloadFileInfo.URL);
+		PendingJournal.Reset();
+		FDownloadJournal::Delete(InternalDownloadFileInfo.SavePath);
+		FDownloadMetadataCache::Get().Remove(InternalDownloadFileInfo.URL);
+	}
+	if (!bRequestReceived)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("OnDownloadComplete:Range %lld-%lld of Segment %lld-%lld is faild."), SegmentRequest.Offset, SegmentRequest.Offset + SegmentRequest.Length - 1, Segment->Range.BeginPosition, Segment->Range.EndPosition);
+		// a truncated 2xx response is retried like a broken connection,
+		// the source of other content(size or validator changed) is excluded and not fixed by retry.
+		bool bOtherContent = bIfRangeFaild || Sources.GetSource(SegmentRequest.SourceIndex).bExcluded;
+		AutoTuner.OnRequestFailed();
+		Sources.OnRequestFailed(SegmentRequest.SourceIndex);
+		int32 ResponseCode = ResponsePtr.IsValid() ? ResponsePtr->GetResponseCode() : 0;
+		bool bRetryable = bRequestSuccessd ? !bOtherContent && RetryPolicy.IsRetryable(0, false) :
+			RetryPolicy.IsRetryable(ResponseCode, bConnectedSuccessfully);
+		// other sources may serve the range,the source of fatal response is not used any more.
+		if (Sources.Num() > 1 && !bRetryable)
+		{
+			Sources.Exclude(SegmentRequest.SourceIndex, TEXT("the response is not retryable"));
+			bRetryable = true;
+		}
+		// the content of URL changed is not recoverable
+		bRetryable = bRetryable && Sources.HasAvailableSource() && !(bIfRangeFaild && SegmentRequest.SourceIndex == 0);
+		if (bRetryable && RetrySegmentRequest(*Segment, RequestIndex, ResponsePtr))
+		{
+			ContinueDownload();
+			return;
+		}
+		FinishDownload(false);
+		return;
+	}
+	Segment->RequestRetryCount = 0;
+	// paced requests not measure the network
+	double ElapsedTime = IsRateLimited() ? 0 : FPlatformTime::Seconds() - SegmentRequest.StartTime;
+	Sources.OnRequestCompleted(SegmentRequest.SourceIndex, SegmentRequest.Length, ElapsedTime);
+	if (!IsRateLimited())
+	{
+		AutoTuner.OnRequestCompleted(SegmentRequest.Length, ElapsedTime);
+	}
+	// bounded request,the rest of segment is requested later.
+	if (!CommitSegmentRequests() || !FileWriter.IsValid() || FileWriter->HasError())
+	{
+		FinishDownload(false);
+		return;
+	}
+	ContinueDownload();
+}
+
+void FDownloadTransfer::OnRangeIgnored(FDownloadSegment& InSegment, int32 InRequestIndex)
+{
+	const int32 SourceIndex = InSegment.Requests[InRequestIndex].SourceIndex;
+	UE_LOG(DownloadTookitLog, Warning, TEXT("OnRangeIgnored:%s ignored Range at %lld of Segment %lld-%lld."), *Sources.GetSource(SourceIndex).URL, InSegment.Requests[InRequestIndex].Offset, InSegment.Range.BeginPosition, InSegment.Range.EndPosition);
+	AutoTuner.OnRequestFailed();
+	// the whole file is larger than it
+	if (bRangeIgnored)
+	{
+		FinishDownload(false);
+		return;
+	}
+	// other sources serve the range
+	if (Sources.Num() > 1)
+	{
+		Sources.Exclude(SourceIndex, TEXT("Range is ignored"));
+		if (Sources.HasAvailableSource() && RetrySegmentRequest(InSegment, InRequestIndex, NULL))
+		{
+			ContinueDownload();
+		}
+		else
+		{
+			FinishDownload(false);
+		}
+		return;
+	}
+	if (!RequestWholeFile())
+	{
+		FinishDownload(false);
+	}
+}
+
+bool FDownloadTransfer::RequestWholeFile()
+{
+	// a chunk could not be verified alone,the decoder could not consume the content again.
+	if (ChunkVerifier.IsValid() || (IsDecoding() && StreamHashOffset > 0))
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("RequestWholeFile:%s not support Range,the chunk verification or decoding of it faild."), *InternalDownloadFileInfo.URL);
+		return false;
+	}
+	UE_LOG(DownloadTookitLog, Warning, TEXT("RequestWholeFile:%s not support Range,download it by one request,the content is held in memory until completed."), *InternalDownloadFileInfo.URL);
+	bRangeIgnored = true;
+	CancelAllRequest();
+	PendingJournal.Reset();
+	FDownloadJournal::Delete(InternalDownloadFileInfo.SavePath);
+	// the written ranges are overwritten in order by the whole content,the delta blocks too.
+	if (!IsDecoding())
+	{
+		HashStage = MakeShared<FDownloadHashStage, ESPMode::ThreadSafe>(HashAlgorithms);
+	}
+	DeltaIndex.Reset();
+	bHashReadBack = false;
+	StreamHashOffset = 0;
+	TotalDownloadedByte = 0;
+	SliceCount = 0;
+	BuildSegments();
+	return OpenDownload() && RequestPendingSegments();
+}
+
+bool FDownloadTransfer::IsIfRangeChanged(int32 InSourceIndex, FHttpResponsePtr ResponsePtr)const
+{
+	// a server ignored Range reply the same validators
+	const FString IfRange = GetIfRangeValidator(InSourceIndex);
+	return !IfRange.IsEmpty() && IfRange != ResponsePtr->GetHeader(TEXT("ETag")) && IfRange != ResponsePtr->GetHeader(TEXT("Last-Modified"));
+}
+
+void FDownloadTransfer::ContinueDownload()
+{
+	if (!IsAllSegmentsCompleted())
+	{
+		bool bRequestSuccess = RequestPendingSegments();
+		UE_LOG(DownloadTookitLog, Log, TEXT("ContinueDownload:Request Next Segment Content %s,count is %d."),bRequestSuccess?TEXT("Success"):TEXT("Faild"),SliceCount);
+		if (!bRequestSuccess)
+		{
+			FinishDownload(false);
+		}
+		return;
+	}
+
+	// every chunk is matched,the tree of them must match the root too.
+	bool bVerified = !ChunkVerifier.IsValid() || ChunkVerifier->VerifyMerkleRoot();
+	FinishDownload(bVerified);
+}
+
+bool FDownloadTransfer::OpenChunkVerifier()
+{
+	ChunkVerifier.Reset();
+	const FDownloadFile& DownloadFile = InternalDownloadFileInfo;
+	if (!DownloadFile.ChunkHashes.Num() && DownloadFile.MerkleRoot.IsEmpty())
+	{
+		return true;
+	}
+	// a chunk is fetched by range
+	if (bRangeIgnored)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("OpenChunkVerifier:%s not support Range,chunk verification is not possible."), *DownloadFile.URL);
+		return false;
+	}
+	// a corrupted chunk could not be fetched again after it is decoded
+	if (IsDecoding())
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("OpenChunkVerifier:chunk verification is not supported with ContentEncoding."));
+		return false;
+	}
+	if (DownloadFile.ChunkSize <= 0 || DownloadFile.ChunkSize > MAX_SEGMENT_SIZE)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("OpenChunkVerifier:ChunkSize %lld is invalid."), DownloadFile.ChunkSize);
+		return false;
+	}
+	ChunkVerifier = MakeShared<FDownloadChunkVerifier, ESPMode::ThreadSafe>(DownloadFile.ChunkHashAlgorithm, DownloadFile.ChunkHashes, DownloadFile.MerkleRoot);
+	if (!ChunkVerifier->Prepare(Segments.Num()))
+	{
+		ChunkVerifier.Reset();
+		return false;
+	}
+	return true;
+}
+
+void FDownloadTransfer::VerifySegment(int32 InSegmentIndex)
+{
+	FDownloadSegment& Segment = Segments[InSegmentIndex];
+	Segment.bVerifying = true;
+
+	TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe> WeakThis(AsShared());
+	TSharedPtr<FDownloadChunkVerifier, ESPMode::ThreadSafe> Verifier = ChunkVerifier;
+	ChunkVerifier->VerifyChunk(InSegmentIndex, [WeakThis, Verifier](int32 InChunkIndex, bool bVerified)
+	{
+		TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer = WeakThis.Pin();
+		if (Transfer.IsValid() && Transfer->ChunkVerifier == Verifier)
+		{
+			Transfer->OnChunkVerified(InChunkIndex, bVerified);
+		}
+	});
+}
+
+void FDownloadTransfer::OnChunkVerified(int32 InSegmentIndex, bool bVerified)
+{
+	if (!Segments.IsValidIndex(InSegmentIndex))
+	{
+		return;
+	}
+	FDownloadSegment& Segment = Segments[InSegmentIndex];
+	Segment.bVerifying = false;
+	if (bVerified)
+	{
+		Segment.bCompleted = true;
+	}
+	else
+	{
+		// drop the received content and fetch the chunk again
+		UE_LOG(DownloadTookitLog, Warning, TEXT("OnChunkVerified:Segment %lld-%lld is corrupted,retry count is %d."), Segment.Range.BeginPosition, Segment.Range.EndPosition, Segment.RetryCount);
+		TotalDownloadedByte -= Segment.ReceivedByte;
+		Metrics.RemoveReceivedByte(Segment.ReceivedByte);
+		AutoTuner.OnRequestFailed();
+		Segment.ReceivedByte = 0;
+		Segment.RequestedByte = 0;
+		bHashReadBack = true;
+		if (++Segment.RetryCount > MAX_CHUNK_RETRY)
+		{
+			if (Status == EDownloadStatus::Downloading)
+			{
+				FinishDownload(false);
+			}
+			return;
+		}
+	}
+	// paused,continue when resumed
+	if (Status == EDownloadStatus::Downloading)
+	{
+		ContinueDownload();
+	}
+}
+
+void FDownloadTransfer::FinishDownload(bool bSuccessd)
+{
+	StopTicker();
+	CancelAllRequest();
+	PendingJournal.Reset();
+	BufferPool.Reset();
+	DownloadSpeed = 0;
+	ReceivedByteInFrame = 0;
+#if WITH_LOG
+	UE_LOG(DownloadTookitLog, Warning, TEXT("FinishDownload:Download Mission %s."), bSuccessd ? TEXT("Successfuly") : TEXT("Faild"));
+#endif
+	if (!bSuccessd)
+	{
+		CloseFileWriter();
+		HashStage.Reset();
+		ChunkVerifier.Reset();
+		Status = EDownloadStatus::Failed;
+		SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+		OnDownloadCompleteMultiDlg.Broadcast(false);
+		return;
+	}
+
+	// the file is completed on disk when the writer closed.
+	TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe> WeakThis(AsShared());
+	CloseFileWriter([WeakThis](bool bWriteSuccessd)
+	{
+		TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer = WeakThis.Pin();
+		if (Transfer.IsValid() && Transfer->Status == EDownloadStatus::Downloading)
+		{
+			Transfer->OnFileWriterClosed(bWriteSuccessd);
+		}
+	});
+}
+
+void FDownloadTransfer::OnFileWriterClosed(bool bWriteSuccessd)
+{
+	if (!bWriteSuccessd || !HashStage.IsValid())
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("OnFileWriterClosed:write %s faild."), *InternalDownloadFileInfo.SavePath);
+		HashStage.Reset();
+		Status = EDownloadStatus::Failed;
+		SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+		OnDownloadCompleteMultiDlg.Broadcast(false);
+		return;
+	}
+	// segments are arrived out of order,the hash stage calc the hash by read back the file.
+	if (!IsStreamHash() && !IsDecoding())
+	{
+		HashStage->SetReadBackFile(InternalDownloadFileInfo.SavePath);
+	}
+
+	// wait for the digest without blocking game thread
+	TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe> WeakThis(AsShared());
+	TSharedPtr<FDownloadHashStage, ESPMode::ThreadSafe> ClosingHashStage = HashStage;
+	HashStage->Close([WeakThis, ClosingHashStage](bool bHashSuccessd)
+	{
+		TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer = WeakThis.Pin();
+		if (Transfer.IsValid() && Transfer->Status == EDownloadStatus::Downloading && Transfer->HashStage == ClosingHashStage)
+		{
+			Transfer->OnHashStageClosed(bHashSuccessd);
+		}
+	});
+}
+
+void FDownloadTransfer::OnHashStageClosed(bool bHashSuccessd)
+{
+	HashDigests = bHashSuccessd ? HashStage->GetDigests() : TMap<EDownloadHashAlgorithm, FString>();
+	InternalDownloadFileInfo.HASH = GetHashDigest(HashAlgorithms[0]);
+	HashStage.Reset();
+	for (const auto& Digest : HashDigests)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("OnDownloadComplete:%s calc result is %s"), *IDownloadHasher::GetAlgorithmName(Digest.Key), *Digest.Value);
+	}
+	// the blocks copied from the old file must make up the published file
+	if (bHashSuccessd && DeltaIndex.IsValid() && !DeltaIndex->FileHash.IsEmpty())
+	{
+		const FString* Digest = HashDigests.Find(DeltaIndex->FileHashAlgorithm);
+		if (!Digest || !Digest->Equals(DeltaIndex->FileHash, ESearchCase::IgnoreCase))
+		{
+			UE_LOG(DownloadTookitLog, Error, TEXT("OnHashStageClosed:the delta download of %s is corrupted."), *InternalDownloadFileInfo.SavePath);
+			FDownloadJournal::Delete(InternalDownloadFileInfo.SavePath);
+			bHashSuccessd = false;
+		}
+	}
+	DeltaIndex.Reset();
+	if (bHashSuccessd)
+	{
+		FDownloadJournal::Delete(InternalDownloadFileInfo.SavePath);
+		UpdateMetadataCache();
+		FDownloadContentStore::Get().Add(HashAlgorithms[0], InternalDownloadFileInfo.HASH, InternalDownloadFileInfo.SavePath);
+		// the old file is not needed any more
+		FString BackupPath = InternalDownloadFileInfo.SavePath + TEXT(".base");
+		if (!InternalDownloadFileInfo.DeltaIndexURL.IsEmpty() && FPaths::FileExists(BackupPath))
+		{
+			IFileManager::Get().Delete(*BackupPath);
+		}
+	}
+	Status = bHashSuccessd ? EDownloadStatus::Succeeded : EDownloadStatus::Failed;
+	SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+	OnDownloadCompleteMultiDlg.Broadcast(bHashSuccessd);
+}
+
+void FDownloadTransfer::BuildSegments()
+{
+	Segments.Reset();
+	if (InternalDownloadFileInfo.Size <= 0)
+	{
+		return;
+	}
+	AddSegments(0, InternalDownloadFileInfo.Size - 1);
+	UE_LOG(DownloadTookitLog, Log, TEXT("BuildSegments:file is divided into %d segments,ConnectionCount is %d."), Segments.Num(), GetMaxConnectionCount());
+}
+
+int64 FDownloadTransfer::GetSegmentSize()const
+{
+	const int64 FileSize = InternalDownloadFileInfo.Size;
+	int64 SegmentSize = FileSize;
+	// one request of the whole file
+	if (bRangeIgnored)
+	{
+		return FileSize;
+	}
+	if (InternalDownloadFileInfo.ChunkSize > 0 && (InternalDownloadFileInfo.ChunkHashes.Num() || !InternalDownloadFileInfo.MerkleRoot.IsEmpty()))
+	{
+		// a segment is a chunk,so it could be verified alone.
+		SegmentSize = InternalDownloadFileInfo.ChunkSize;
+	}
+	else if (bUseSlice)
+	{
+		SegmentSize = SliceByteSize;
+	}
+	else if (GetMaxConnectionCount() > 1)
+	{
+		SegmentSize = FMath::DivideAndRoundUp(FileSize, (int64)GetMaxConnectionCount());
+	}
+	return FMath::Min<int64>(SegmentSize, MAX_SEGMENT_SIZE);
+}
+
+void FDownloadTransfer::AddSegments(int64 InBeginPosition, int64 InEndPosition)
+{
+	const int64 SegmentSize = FMath::Max<int64>(GetSegmentSize(), 1);
+	for (int64 BeginPosition = InBeginPosition; BeginPosition <= InEndPosition; BeginPosition += SegmentSize)
+	{
+		FDownloadSegment Segment;
+		// Range:0-FILE_SIZE-1 is request full file
+		// Range:0-SLICE_SIZE is request part of file(SLICE_SIZE+1 byte)
+		Segment.Range.BeginPosition = BeginPosition;
+		Segment.Range.EndPosition = FMath::Min(BeginPosition + SegmentSize - 1, InEndPosition);
+		Segments.Add(Segment);
+	}
+}
+
+int32 FDownloadTransfer::GetMaxConnectionCount()const
+{
+	// the decoder consume the content in stream order,a later range could only wait for the earlier one.
+	if (IsDecoding() || bRangeIgnored)
+		return 1;
+	return AutoTuneSettings.bEnabled ? FMath::Max(ConnectionCount, AutoTuneSettings.MaxConnectionCount) : ConnectionCount;
+}
+
+bool FDownloadTransfer::RequestPendingSegments()
+{
+	// the requests waiting for commit hold the content too
+	const int32 MaxRequestCount = AutoTuner.GetConnectionCount() * PipelineDepth;
+	int32 RequestCount = 0;
+	int32 FetchingCount = 0;
+	for (const FDownloadSegment& Segment : Segments)
+	{
+		RequestCount += Segment.Requests.Num();
+		if (Segment.Requests.Num() && Segment.RequestedByte < Segment.GetLength())
+			++FetchingCount;
+	}
+
+	// request in file order,a connection fetch a segment range by range,
+	// when a segment is all requested the next one is requested on the same connection.
+	bool bEarlierPending = false;
+	const double Now = FPlatformTime::Seconds();
+	for (FDownloadSegment& Segment : Segments)
+	{
+		if (RequestCount >= MaxRequestCount)
+			break;
+		if (Segment.bCompleted || Segment.bVerifying || Segment.RequestedByte >= Segment.GetLength())
+			continue;
+		// waiting for the backoff of failed request,requested by tick later.
+		if (Segment.RetryTime > Now)
+		{
+			// the decoder could not skip the range,the later segments wait for it.
+			if (IsDecoding())
+				break;
+			bEarlierPending = true;
+			continue;
+		}
+		Segment.RetryTime = 0;
+		bool bFetching = Segment.Requests.Num() > 0;
+		if (!bFetching && FetchingCount >= AutoTuner.GetConnectionCount())
+		{
+			bEarlierPending = true;
+			continue;
+		}
+		while (RequestCount < MaxRequestCount && Segment.Requests.Num() < PipelineDepth && Segment.RequestedByte < Segment.GetLength())
+		{
+			// wait for the stages,requested by next tick.
+			if (IsStageBusy())
+				break;
+			// wait for the tokens,requested by next tick.
+			int64 MaxRequestByte = 0;
+			if (!AcquireRateLimit(MaxRequestByte))
+				break;
+			// the content of concurrent connections arrived out of order,hashed when the file closed.
+			if (bEarlierPending)
+				bHashReadBack = true;
+			if (!DoDownloadRequest(InternalDownloadFileInfo, Segment, MaxRequestByte))
+				return false;
+			ConsumeRateLimit(Segment.Requests.Last().Length);
+			++RequestCount;
+			if (!bFetching)
+			{
+				bFetching = true;
+				++FetchingCount;
+			}
+		}
+		if (Segment.RequestedByte < Segment.GetLength())
+		{
+			if (!bFetching)
+				break;
+			bEarlierPending = true;
+		}
+	}
+	Status = EDownloadStatus::Downloading;
+	return true;
+}
+
+FDownloadSegment* FDownloadTransfer::FindSegment(FHttpRequestPtr RequestPtr, int32& OutRequestIndex)
+{
+	OutRequestIndex = INDEX_NONE;
+	if (!RequestPtr.IsValid())
+		return NULL;
+	for (FDownloadSegment& Segment : Segments)
+	{
+		OutRequestIndex = Segment.Requests.IndexOfByPredicate([&RequestPtr](const FDownloadSegmentRequest& SegmentRequest) { return SegmentRequest.Request == RequestPtr; });
+		if (OutRequestIndex != INDEX_NONE)
+			return &Segment;
+	}
+	return NULL;
+}
+
+bool FDownloadTransfer::IsStreamHash()const
+{
+	// decoding use one connection(GetMaxConnectionCount),segments are committed in order and hashed with the stream.
+	if (IsDecoding())
+	{
+		// the decoded content is hashed by the decode stage
+		return !InternalDownloadFileInfo.bHashDecodedContent && HashStage.IsValid();
+	}
+	return !bHashReadBack && HashStage.IsValid();
+}
+
+bool FDownloadTransfer::IsDecoding()const
+{
+	return InternalDownloadFileInfo.ContentEncoding != EDownloadContentEncoding::None;
+}
+
+void FDownloadTransfer::SaveJournal()
+{
+	// the decoder state could not be saved,the whole file could not be resumed.
+	if (!FileWriter.IsValid() || !Segments.Num() || IsDecoding() || bRangeIgnored)
+	{
+		return;
+	}
+	TSharedPtr<FDownloadJournalSnapshot> Snapshot = MakeShared<FDownloadJournalSnapshot>();
+	FDownloadJournal& Journal = Snapshot->Journal;
+	Journal.URL = InternalDownloadFileInfo.URL;
+	Journal.Size = InternalDownloadFileInfo.Size;
+	Journal.ETag = InternalDownloadFileInfo.ETag;
+	Journal.LastModified = InternalDownloadFileInfo.LastModified;
+	Journal.ChunkSize = InternalDownloadFileInfo.ChunkSize;
+	for (const FDownloadSegment& Segment : Segments)
+	{
+		FDownloadJournalSegment& JournalSegment = Journal.Segments.AddDefaulted_GetRef();
+		JournalSegment.BeginPosition = Segment.Range.BeginPosition;
+		JournalSegment.EndPosition = Segment.Range.EndPosition;
+		JournalSegment.ReceivedByte = Segment.ReceivedByte;
+		JournalSegment.bCompleted = Segment.bCompleted;
+	}
+	if (ChunkVerifier.IsValid())
+	{
+		Journal.LeafHashes = ChunkVerifier->GetLeafHashes();
+	}
+
+	// the writer reach the barrier after all recorded bytes are flushed.
+	TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe> WeakThis(AsShared());
+	bool bBarrierAdded = FileWriter->Barrier([WeakThis, Snapshot](bool bReached)
+	{
+		TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer = WeakThis.Pin();
+		if (Transfer.IsValid())
+		{
+			Transfer->OnJournalBarrierReached(Snapshot, bReached);
+		}
+	});
+	if (!bBarrierAdded)
+	{
+		return;
+	}
+	++Snapshot->PendingBarrier;
+	PendingJournal = Snapshot;
+
+	// the hash state at the same offset of the stream
+	if (IsStreamHash())
+	{
+		TSharedPtr<FDownloadHashStage, ESPMode::ThreadSafe> BarrierHashStage = HashStage;
+		bBarrierAdded = HashStage->Barrier([WeakThis, Snapshot, BarrierHashStage](bool bReached)
+		{
+			if (bReached)
+			{
+				BarrierHashStage->GetBarrierState(Snapshot->Journal.HashedOffset, Snapshot->Journal.HashState);
+			}
+			TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer = WeakThis.Pin();
+			if (Transfer.IsValid())
+			{
+				// without hash state the file is read back when resumed.
+				Transfer->OnJournalBarrierReached(Snapshot, true);
+			}
+		});
+		if (bBarrierAdded)
+		{
+			++Snapshot->PendingBarrier;
+		}
+	}
+}
+
+void FDownloadTransfer::OnJournalBarrierReached(TSharedPtr<FDownloadJournalSnapshot> InSnapshot, bool bReached)
+{
+	// the download is finished or a newer journal is recorded
+	if (InSnapshot != PendingJournal)
+	{
+		return;
+	}
+	InSnapshot->bBarrierFaild |= !bReached;
+	if (--InSnapshot->PendingBarrier > 0)
+	{
+		return;
+	}
+	PendingJournal.Reset();
+	if (!InSnapshot->bBarrierFaild)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_DownloadFileSystem);
+		InSnapshot->Journal.Save(FDownloadJournal::GetJournalPath(InternalDownloadFileInfo.SavePath));
+	}
+}
+
+bool FDownloadTransfer::RestoreJournal(FDownloadJournal& OutJournal)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadFileSystem);
+	const FString& SavePath = InternalDownloadFileInfo.SavePath;
+	if (IsDecoding() || bRangeIgnored || !FPaths::FileExists(SavePath) || !OutJournal.Load(FDownloadJournal::GetJournalPath(SavePath)))
+	{
+		return false;
+	}
+	// the size is given,the validators are not known yet,
+	// the requests carry the validators of journal by If-Range,a changed content is not mixed with it.
+	FDownloadFile JournalFileInfo = InternalDownloadFileInfo;
+	if (JournalFileInfo.ETag.IsEmpty() && JournalFileInfo.LastModified.IsEmpty())
+	{
+		JournalFileInfo.ETag = OutJournal.ETag;
+		JournalFileInfo.LastModified = OutJournal.LastModified;
+	}
+	if (!OutJournal.IsMatch(JournalFileInfo))
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("RestoreJournal:the remote content of %s is changed,download it again."), *SavePath);
+		return false;
+	}
+	InternalDownloadFileInfo = JournalFileInfo;
+	TotalByte = InternalDownloadFileInfo.Size;
+
+	// received bytes of an unverified chunk are lost with the last run
+	const bool bChunkVerify = InternalDownloadFileInfo.ChunkHashes.Num() || !InternalDownloadFileInfo.MerkleRoot.IsEmpty();
+	Segments.Reset();
+	for (const FDownloadJournalSegment& JournalSegment : OutJournal.Segments)
+	{
+		FDownloadSegment& Segment = Segments.AddDefaulted_GetRef();
+		Segment.Range.BeginPosition = JournalSegment.BeginPosition;
+		Segment.Range.EndPosition = JournalSegment.EndPosition;
+		Segment.bCompleted = JournalSegment.bCompleted;
+		Segment.ReceivedByte = Segment.bCompleted ? Segment.GetLength() : (bChunkVerify ? 0 : FMath::Clamp<int64>(JournalSegment.ReceivedByte, 0, Segment.GetLength()));
+		Segment.RequestedByte = Segment.ReceivedByte;
+		TotalDownloadedByte += Segment.ReceivedByte;
+		SliceCount += Segment.bCompleted ? 1 : 0;
+	}
+
+	// continue the stream hash if the content after the saved state is not received
+	int64 StreamOffset = 0;
+	bool bStreamContiguous = true;
+	bool bStreamEnd = false;
+	for (const FDownloadSegment& Segment : Segments)
+	{
+		if (bStreamEnd)
+		{
+			bStreamContiguous &= Segment.ReceivedByte == 0;
+			continue;
+		}
+		StreamOffset += Segment.ReceivedByte;
+		bStreamEnd = !Segment.bCompleted;
+	}
+	StreamHashOffset = StreamOffset;
+	bHashReadBack = !bStreamContiguous || !OutJournal.HashState.Num() || OutJournal.HashedOffset != StreamOffset ||
+		!HashStage->RestoreState(StreamOffset, OutJournal.HashState);
+
+	UE_LOG(DownloadTookitLog, Log, TEXT("RestoreJournal:resume %s from %lld bytes,hash %s."), *SavePath, TotalDownloadedByte.Load(), bHashReadBack ? TEXT("read back the file") : TEXT("continue with the stream"));
+	return true;
+}
+
+bool FDownloadTransfer::IsRateLimited()const
+{
+	UDownloadManager* Manager = UDownloadManager::Get();
+	return RateLimiter.IsLimited() || (Manager && Manager->GetGlobalRateLimiter().IsLimited());
+}
+
+bool FDownloadTransfer::AcquireRateLimit(int64& OutMaxRequestByte)
+{
+	OutMaxRequestByte = 0;
+	UDownloadManager* Manager = UDownloadManager::Get();
+	FDownloadTokenBucket* Limiters[] = { &RateLimiter, Manager ? &Manager->GetGlobalRateLimiter() : nullptr };
+	for (FDownloadTokenBucket* Limiter : Limiters)
+	{
+		if (!Limiter || !Limiter->IsLimited())
+			continue;
+		if (!Limiter->CanConsume())
+			return false;
+		OutMaxRequestByte = OutMaxRequestByte > 0 ? FMath::Min(OutMaxRequestByte, Limiter->GetPacingByte()) : Limiter->GetPacingByte();
+	}
+	return true;
+}
+
+void FDownloadTransfer::ConsumeRateLimit(int64 InByte)
+{
+	RateLimiter.Consume(InByte);
+	UDownloadManager* Manager = UDownloadManager::Get();
+	if (Manager)
+	{
+		Manager->GetGlobalRateLimiter().Consume(InByte);
+	}
+}
+
+bool FDownloadTransfer::IsAllSegmentsCompleted()const
+{
+	return !Segments.ContainsByPredicate([](const FDownloadSegment& Segment) { return !Segment.bCompleted; });
+}
+
+bool FDownloadTransfer::HasActiveRequest()const
+{
+	for (const FDownloadSegment& Segment : Segments)
+	{
+		for (const FDownloadSegmentRequest& SegmentRequest : Segment.Requests)
+		{
+			if (SegmentRequest.Request.IsValid() && SegmentRequest.Request->GetStatus() == EHttpRequestStatus::Processing)
+				return true;
+		}
+	}
+	return false;
+}
+
+void FDownloadTransfer::CancelAllRequest()
+{
+	if (HeadRequest.IsValid())
+	{
+		HeadRequest->OnRequestProgress().Unbind();
+		HeadRequest->OnProcessRequestComplete().Unbind();
+		HeadRequest->CancelRequest();
+		HeadRequest.Reset();
+	}
+	for (FDownloadSegment& Segment : Segments)
+	{
+		for (FDownloadSegmentRequest& SegmentRequest : Segment.Requests)
+		{
+			if (SegmentRequest.Request.IsValid())
+			{
+				SegmentRequest.Request->OnHeaderReceived().Unbind();
+				SegmentRequest.Request->OnRequestProgress().Unbind();
+				SegmentRequest.Request->OnProcessRequestComplete().Unbind();
+				SegmentRequest.Request->CancelRequest();
+				Sources.OnRequestFinished(SegmentRequest.SourceIndex);
+			}
+			// the content of canceled or not committed response is dropped
+			Metrics.RemoveReceivedByte(SegmentRequest.ResponseReceivedByte);
+		}
+		Segment.Requests.Reset();
+		Segment.RequestedByte = Segment.ReceivedByte;
+	}
+}
+
+void FDownloadTransfer::DropSegmentRequests(FDownloadSegment& InSegment, int32 InRequestIndex)
+{
+	// the requests are committed in offset order,the later ones could not be committed before the dropped one.
+	for (int32 Index = InRequestIndex; Index < InSegment.Requests.Num(); ++Index)
+	{
+		FDownloadSegmentRequest& SegmentRequest = InSegment.Requests[Index];
+		if (SegmentRequest.Request.IsValid())
+		{
+			SegmentRequest.Request->OnHeaderReceived().Unbind();
+			SegmentRequest.Request->OnRequestProgress().Unbind();
+			SegmentRequest.Request->OnProcessRequestComplete().Unbind();
+			SegmentRequest.Request->CancelRequest();
+			Sources.OnRequestFinished(SegmentRequest.SourceIndex);
+		}
+		Metrics.RemoveReceivedByte(SegmentRequest.ResponseReceivedByte);
+	}
+	InSegment.RequestedByte = InSegment.Requests[InRequestIndex].Offset;
+	InSegment.Requests.RemoveAt(InRequestIndex, InSegment.Requests.Num() - InRequestIndex);
+}
+
+bool FDownloadTransfer::RetrySegmentRequest(FDownloadSegment& InSegment, int32 InRequestIndex, FHttpResponsePtr ResponsePtr)
+{
+	if (RetryPolicy.MaxRetryCount <= 0 || InSegment.RequestRetryCount >= RetryPolicy.MaxRetryCount ||
+		(RetryPolicy.RetryBudget > 0 && TotalRetryCount >= RetryPolicy.RetryBudget))
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("RetrySegmentRequest:retry count is %d of range,%d of download,no more retry."), InSegment.RequestRetryCount, TotalRetryCount);
+		return false;
+	}
+	++InSegment.RequestRetryCount;
+	++TotalRetryCount;
+	Metrics.AddRetry();
+	float Delay = RetryPolicy.GetRetryDelay(InSegment.RequestRetryCount);
+	// Retry-After of 429/503,only the seconds form is used.
+	FString RetryAfter = ResponsePtr.IsValid() ? ResponsePtr->GetHeader(TEXT("Retry-After")) : FString();
+	if (RetryAfter.IsNumeric())
+	{
+		Delay = FMath::Clamp(FCString::Atof(*RetryAfter), Delay, FMath::Max(Delay, RetryPolicy.MaxDelaySeconds));
+	}
+	// the range is requested from other source at once
+	const int32 SourceIndex = InSegment.Requests[InRequestIndex].SourceIndex;
+	if (Sources.GetSource(SourceIndex).bExcluded)
+	{
+		Delay = 0.f;
+	}
+	UE_LOG(DownloadTookitLog, Warning, TEXT("RetrySegmentRequest:Range at %lld of Segment %lld-%lld is requested again after %.2f seconds,retry count is %d."),
+		InSegment.Requests[InRequestIndex].Offset, InSegment.Range.BeginPosition, InSegment.Range.EndPosition, Delay, InSegment.RequestRetryCount);
+	DropSegmentRequests(InSegment, InRequestIndex);
+	InSegment.RetryTime = FPlatformTime::Seconds() + Delay;
+	// the responses of later segments could not be committed before the range,
+	// dropped to free the request slots for the retry,requested again after it.
+	if (IsDecoding())
+	{
+		for (int32 SegmentIndex = (int32)(&InSegment - Segments.GetData()) + 1; SegmentIndex < Segments.Num(); ++SegmentIndex)
+		{
+			if (Segments[SegmentIndex].Requests.Num())
+				DropSegmentRequests(Segments[SegmentIndex], 0);
+		}
+	}
+	return true;
+}
+
+bool FDownloadTransfer::HasPendingRetry()const
+{
+	return Segments.ContainsByPredicate([](const FDownloadSegment& Segment) { return !Segment.bCompleted && Segment.RetryTime > 0; });
+}
+
+void FDownloadTransfer::StartTicker()
+{
+	if (bTickByManager || TickDelegateHandle.IsValid())
+	{
+		return;
+	}
+	// all transfers share the tick of download manager,own ticker if the engine is not running.
+	UDownloadManager* Manager = UDownloadManager::Get();
+	if (Manager)
+	{
+		Manager->AddTickedTransfer(AsShared());
+		bTickByManager = true;
+	}
+	else
+	{
+		TickDelegateHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateThreadSafeSP(AsShared(), &FDownloadTransfer::Tick));
+	}
+}
+
+void FDownloadTransfer::StopTicker()
+{
+	if (bTickByManager)
+	{
+		UDownloadManager* Manager = UDownloadManager::Get();
+		if (Manager)
+		{
+			Manager->RemoveTickedTransfer(this);
+		}
+		bTickByManager = false;
+	}
+	if (TickDelegateHandle.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
+		TickDelegateHandle.Reset();
+	}
+}
+
+
+void FDownloadTransfer::PreRequestFileInfo(const FDownloadFile& InDownloadFile, bool bInRevalidate)
+{
+	PassInDownloadFileInfo = InDownloadFile;
+	if (PassInDownloadFileInfo.SavePath.IsEmpty())
+	{
+		PassInDownloadFileInfo.SavePath = FPaths::Combine(FPaths::ProjectSavedDir(),GetFileNameByURL(InDownloadFile.URL));
+	}
+	InternalDownloadFileInfo = PassInDownloadFileInfo;
+	TotalByte = InternalDownloadFileInfo.Size;
+	InternalDownloadFileInfo.ETag.Empty();
+	InternalDownloadFileInfo.LastModified.Empty();
+	// the old file scanned for last request is dropped
+	CancelPreparing();
+	// downloading from now,the segments are built after the file info.
+	Segments.Reset();
+	bRangeIgnored = false;
+	Status = EDownloadStatus::Downloading;
+
+	// same content is downloaded before,no network is needed.
+	if (FetchFromContentStore(bInRevalidate))
+	{
+		return;
+	}
+	RequestFileInfo(bInRevalidate);
+}
+
+void FDownloadTransfer::RequestFileInfo(bool bInRevalidate, bool bInHead)
+{
+	const FDownloadMetadata* Metadata = bInRevalidate ? FindRevalidateMetadata() : NULL;
+	if (!Metadata && InternalDownloadFileInfo.Size > 0)
+	{
+		UE_LOG(DownloadTookitLog, Log, TEXT("PreRequestFileInfo:Size is given,download %s directly."), *InternalDownloadFileInfo.URL);
+		StartDownload(NULL);
+		return;
+	}
+
+	// the first range is downloaded with the file info,only one byte if resumed from journal or the old file may be reused.
+	bool bProbeOnly = false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_DownloadFileSystem);
+		bProbeOnly = FPaths::FileExists(FDownloadJournal::GetJournalPath(InternalDownloadFileInfo.SavePath)) || CanDeltaDownload();
+	}
+	int64 HeadRequestByte = bProbeOnly ? 1 : MAX_REQUEST_SIZE;
+	TSharedRef<IHttpRequest,ESPMode::ThreadSafe> HttpHeadRequest = FHttpModule::Get().CreateRequest();
+	HttpHeadRequest->OnProcessRequestComplete().BindThreadSafeSP(AsShared(), &FDownloadTransfer::OnRequestFileInfoComplete);
+	HttpHeadRequest->SetURL(InternalDownloadFileInfo.URL);
+	if (bInHead)
+	{
+		HttpHeadRequest->SetVerb(TEXT("HEAD"));
+	}
+	else
+	{
+		// the whole content is held by the response if the server ignore Range
+		HttpHeadRequest->OnRequestProgress().BindThreadSafeSP(AsShared(), &FDownloadTransfer::OnRequestFileInfoProcess, HeadRequestByte, bInRevalidate);
+		HttpHeadRequest->SetVerb(TEXT("GET"));
+		HttpHeadRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=0-%lld"), HeadRequestByte - 1));
+	}
+	if (Metadata)
+	{
+		if (!Metadata->ETag.IsEmpty())
+			HttpHeadRequest->SetHeader(TEXT("If-None-Match"), Metadata->ETag);
+		else
+			HttpHeadRequest->SetHeader(TEXT("If-Modified-Since"), Metadata->LastModified);
+	}
+	if (!HttpHeadRequest->ProcessRequest())
+	{
+		FinishDownload(false);
+		return;
+	}
+	HeadRequest = HttpHeadRequest;
+	UE_LOG(DownloadTookitLog, Log, TEXT("Request File Info%s%s."), bInHead ? TEXT(" by HEAD") : TEXT(""), Metadata ? TEXT(",revalidate the cached file") : TEXT(""));
+}
+
+void FDownloadTransfer::OnRequestFileInfoProcess(FHttpRequestPtr RequestPtr, int32 byteSent, int32 byteReceive, int64 InRequestByte, bool bInRevalidate)
+{
+	// a range response is never larger than the range
+	if (RequestPtr != HeadRequest || byteReceive <= InRequestByte)
+	{
+		return;
+	}
+	UE_LOG(DownloadTookitLog, Warning, TEXT("OnRequestFileInfoProcess:%s ignored Range,%d bytes received,request the file info by HEAD."), *InternalDownloadFileInfo.URL, byteReceive);
+	bRangeIgnored = true;
+	HeadRequest->OnRequestProgress().Unbind();
+	HeadRequest->OnProcessRequestComplete().Unbind();
+	HeadRequest->CancelRequest();
+	HeadRequest.Reset();
+	RequestFileInfo(bInRevalidate, true);
+}
+
+void FDownloadTransfer::OnRequestFileInfoComplete(FHttpRequestPtr RequestPtr, FHttpResponsePtr ResponsePtr, bool bConnectedSuccessfully)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadFileInfoComplete);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadTransfer FileInfoComplete"));
+	UE_LOG(DownloadTookitLog, Log, TEXT("OnRequestFileInfoComplete"));
+	if (RequestPtr != HeadRequest)
+	{
+		return;
+	}
+	HeadRequest.Reset();
+	bool bHttpRequestSuccessed = RequestPtr.IsValid() && RequestPtr->GetStatus() == EHttpRequestStatus::Succeeded;
+	int32 ResponseCode = ResponsePtr.IsValid() ? ResponsePtr->GetResponseCode() : 0;
+	if (bConnectedSuccessfully && bHttpRequestSuccessed && ResponseCode == 304)
+	{
+		const FDownloadMetadata* Metadata = FindRevalidateMetadata();
+		if (Metadata)
+		{
+			OnRevalidated(*Metadata);
+			return;
+		}
+	}
+
+	bool bResponseSuccessd = ResponseCode >= 200 && ResponseCode < 300;
+	bool bDownloadSuccessd = bConnectedSuccessfully && bHttpRequestSuccessed && bResponseSuccessd;
+	int64 FileSize = 0;
+	if (bDownloadSuccessd)
+	{
+		// Content-Range:bytes 0-N/TOTAL,or the whole content if the server not accept range
+		FString ContentRange = ResponsePtr->GetHeader(TEXT("Content-Range"));
+		FString TotalSize;
+		if (ResponseCode == 206 && ContentRange.Split(TEXT("/"), NULL, &TotalSize))
+		{
+			FileSize = TotalSize.IsNumeric() ? FCString::Atoi64(*TotalSize) : 0;
+		}
+		else if (ResponseCode != 206)
+		{
+			FileSize = GetResponseContentLength(ResponsePtr);
+			// the whole content of the range probe
+			bRangeIgnored |= ResponseCode == 200 && RequestPtr->GetVerb() != TEXT("HEAD");
+		}
+		bDownloadSuccessd = FileSize > 0;
+	}
+#if WITH_LOG
+	UE_LOG(DownloadTookitLog, Log, TEXT("OnRequestFileInfoComplete: Request File Info %s,Size is %lld."),bDownloadSuccessd?TEXT("Successfuly"):TEXT("Faild.Please check URL or Network connection."), FileSize);
+#endif
+	if (!bDownloadSuccessd)
+	{
+		FinishDownload(false);
+		return;
+	}
+
+	InternalDownloadFileInfo.Size = FileSize;
+	TotalByte = FileSize;
+	UpdateValidators(ResponsePtr);
+	FDownloadBufferPtr HeadContent;
+	const TArray<uint8>& ResponseDataArray = ResponsePtr->GetContent();
+	if (ResponseDataArray.Num() > 0 && ResponseDataArray.Num() == GetResponseContentLength(ResponsePtr))
+	{
+		HeadContent = BufferPool.Acquire(ResponseDataArray.Num());
+		FMemory::Memcpy(HeadContent->GetData(), ResponseDataArray.GetData(), ResponseDataArray.Num());
+	}
+	StartDownload(HeadContent);
+}
+
+bool FDownloadTransfer::FetchFromContentStore(bool bInRevalidate)
+{
+	const FString& ExpectedHash = InternalDownloadFileInfo.HASH;
+	int64 StoredSize = 0;
+	FString StoredPath = FDownloadContentStore::Get().Find(HashAlgorithms[0], ExpectedHash, StoredSize);
+	if (StoredPath.IsEmpty())
+	{
+		return false;
+	}
+	// Size is of the encoded content if decoding
+	if (!IsDecoding() && InternalDownloadFileInfo.Size > 0 && InternalDownloadFileInfo.Size != StoredSize)
+	{
+		FDownloadContentStore::Get().Release(HashAlgorithms[0], ExpectedHash);
+		return false;
+	}
+	// a copy of large file take a while,cloned on a worker thread.
+	// the stored file is pinned by Find,released even if the transfer is gone.
+	FString SavePath = InternalDownloadFileInfo.SavePath;
+	EDownloadHashAlgorithm Algorithm = HashAlgorithms[0];
+	uint32 Serial = RequestSerial;
+	TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe> WeakThis(AsShared());
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Serial, StoredPath, SavePath, StoredSize, bInRevalidate, Algorithm, ExpectedHash]()
+	{
+		bool bFetched = FDownloadContentStore::CloneFile(SavePath, StoredPath);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Serial, bFetched, StoredSize, bInRevalidate, Algorithm, ExpectedHash]()
+		{
+			FDownloadContentStore::Get().Release(Algorithm, ExpectedHash);
+			TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer = WeakThis.Pin();
+			if (Transfer.IsValid() && Transfer->RequestSerial == Serial)
+			{
+				Transfer->OnContentStoreFetched(bFetched, StoredSize, bInRevalidate);
+			}
+		});
+	});
+	return true;
+}
+
+void FDownloadTransfer::OnContentStoreFetched(bool bFetched, int64 InSize, bool bInRevalidate)
+{
+	if (!bFetched)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("OnContentStoreFetched:link the stored file to %s faild,download it."), *InternalDownloadFileInfo.SavePath);
+		RequestFileInfo(bInRevalidate);
+		return;
+	}
+	UE_LOG(DownloadTookitLog, Log, TEXT("OnContentStoreFetched:%s is got from the content store."), *InternalDownloadFileInfo.SavePath);
+	FDownloadJournal::Delete(InternalDownloadFileInfo.SavePath);
+	InternalDownloadFileInfo.Size = InSize;
+	TotalByte = InSize;
+	InternalDownloadFileInfo.HASH = InternalDownloadFileInfo.HASH.ToLower();
+	HashDigests.Empty();
+	HashDigests.Add(HashAlgorithms[0], InternalDownloadFileInfo.HASH);
+	TotalDownloadedByte = InSize;
+	Status = EDownloadStatus::Succeeded;
+	SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+	OnDownloadCompleteMultiDlg.Broadcast(true);
+}
+
+const FDownloadMetadata* FDownloadTransfer::FindRevalidateMetadata()
+{
+	const FString& SavePath = InternalDownloadFileInfo.SavePath;
+	const FDownloadMetadata* Metadata = FDownloadMetadataCache::Get().Find(InternalDownloadFileInfo.URL);
+	if (!Metadata || !Metadata->HasValidator() || Metadata->SavePath != SavePath)
+	{
+		return NULL;
+	}
+	// the local file is changed or not completed
+	if (IFileManager::Get().FileSize(*SavePath) != Metadata->Size || FPaths::FileExists(FDownloadJournal::GetJournalPath(SavePath)))
+	{
+		return NULL;
+	}
+	if (InternalDownloadFileInfo.Size > 0 && InternalDownloadFileInfo.Size != Metadata->Size)
+	{
+		return NULL;
+	}
+	for (EDownloadHashAlgorithm Algorithm : HashAlgorithms)
+	{
+		if (!Metadata->Digests.Contains(Algorithm))
+			return NULL;
+	}
+	// the caller expect other content
+	const FString& ExpectedHash = InternalDownloadFileInfo.HASH;
+	if (!ExpectedHash.IsEmpty() && !ExpectedHash.Equals(Metadata->Digests.FindChecked(HashAlgorithms[0]), ESearchCase::IgnoreCase))
+	{
+		return NULL;
+	}
+	return Metadata;
+}
+
+void FDownloadTransfer::OnRevalidated(const FDownloadMetadata& InMetadata)
+{
+	UE_LOG(DownloadTookitLog, Log, TEXT("OnRevalidated:%s is not modified,use the local file."), *InternalDownloadFileInfo.SavePath);
+	InternalDownloadFileInfo.Size = InMetadata.Size;
+	TotalByte = InMetadata.Size;
+	InternalDownloadFileInfo.ETag = InMetadata.ETag;
+	InternalDownloadFileInfo.LastModified = InMetadata.LastModified;
+	HashDigests = InMetadata.Digests;
+	InternalDownloadFileInfo.HASH = GetHashDigest(HashAlgorithms[0]);
+	TotalDownloadedByte = InMetadata.Size;
+	Status = EDownloadStatus::Succeeded;
+	SCOPE_CYCLE_COUNTER(STAT_DownloadBroadcast);
+	OnDownloadCompleteMultiDlg.Broadcast(true);
+}
+
+void FDownloadTransfer::StartDownload(FDownloadBufferPtr InHeadContent)
+{
+	PreDownloadRequest();
+	// the journal of last run,continue the download from it.
+	FDownloadJournal Journal;
+	bool bResumed = RestoreJournal(Journal);
+	if (!bResumed)
+	{
+		FDownloadJournal::Delete(InternalDownloadFileInfo.SavePath);
+		// the preallocated file has the full size before completed,it could not be revalidated by size.
+		FDownloadMetadataCache::Get().Remove(InternalDownloadFileInfo.URL);
+		// the segments are built after the old file scanned
+		if (CanDeltaDownload())
+		{
+			RequestDeltaIndex();
+			return;
+		}
+		// FString SaveFilePath = FPaths::Combine(InternalDownloadFileInfo.SavePath, InternalDownloadFileInfo.Name);
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		SCOPE_CYCLE_COUNTER(STAT_DownloadFileSystem);
+		if (FPaths::FileExists(InternalDownloadFileInfo.SavePath))
+		{
+			bool bDeleted = PlatformFile.DeleteFile(*InternalDownloadFileInfo.SavePath);
+
+			UE_LOG(DownloadTookitLog, Warning, TEXT("StartDownload: Delete Exists File %s."), bDeleted ? TEXT("Successfuly") : TEXT("Faild"));
+			if (!bDeleted)
+			{
+				FinishDownload(false);
+				return;
+			}
+		}
+		BuildSegments();
+	}
+
+	if (!OpenDownload())
+	{
+		FinishDownload(false);
+		return;
+	}
+	if (bResumed && ChunkVerifier.IsValid())
+	{
+		ChunkVerifier->RestoreLeafHashes(Journal.LeafHashes);
+	}
+	// the journal may record all segments are completed
+	Status = EDownloadStatus::Downloading;
+
+	// commit the first range got with the file info
+	FDownloadSegment& FirstSegment = Segments[0];
+	// the whole file could not be continued from a part of it
+	const int64 MinHeadLength = bRangeIgnored ? FirstSegment.GetLength() : 1;
+	if (InHeadContent.IsValid() && FirstSegment.ReceivedByte == 0 && !FirstSegment.Requests.Num() && InHeadContent->Num() >= MinHeadLength && InHeadContent->Num() <= FirstSegment.GetLength())
+	{
+		FDownloadSegmentRequest& SegmentRequest = FirstSegment.Requests.AddDefaulted_GetRef();
+		SegmentRequest.Length = InHeadContent->Num();
+		SegmentRequest.ResponseReceivedByte = SegmentRequest.Length;
+		SegmentRequest.Content = InHeadContent;
+		FirstSegment.RequestedByte = SegmentRequest.Length;
+		Metrics.AddReceivedByte(SegmentRequest.Length);
+		if (!CommitSegmentRequests())
+		{
+			FinishDownload(false);
+			return;
+		}
+	}
+	ContinueDownload();
+}
+
+bool FDownloadTransfer::OpenDownload()
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadOpenPipeline);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadTransfer OpenPipeline"));
+	if (!Segments.Num() || !HashStage->Start() || !OpenChunkVerifier() || !OpenFileWriter())
+	{
+		return false;
+	}
+	Metrics.Start(InternalDownloadFileInfo.Size, TotalDownloadedByte.Load());
+	// one connection without tuning if decoding or the whole file is requested
+	FDownloadAutoTuneSettings TuneSettings = AutoTuneSettings;
+	if (IsDecoding() || bRangeIgnored)
+		TuneSettings.bEnabled = false;
+	AutoTuner.Start(TuneSettings, GetMaxConnectionCount(), MAX_REQUEST_SIZE);
+	return true;
+}
+
+bool FDownloadTransfer::CanDeltaDownload()const
+{
+	const FDownloadFile& DownloadFile = InternalDownloadFileInfo;
+	// a verified chunk is downloaded as a whole,the decoded file is not the published one.
+	if (DownloadFile.DeltaIndexURL.IsEmpty() || IsDecoding() || bRangeIgnored || DownloadFile.ChunkHashes.Num() || !DownloadFile.MerkleRoot.IsEmpty())
+	{
+		return false;
+	}
+	return FPaths::FileExists(GetDeltaBasePath());
+}
+
+FString FDownloadTransfer::GetDeltaBasePath()const
+{
+	if (!InternalDownloadFileInfo.DeltaBasePath.IsEmpty())
+	{
+		return InternalDownloadFileInfo.DeltaBasePath;
+	}
+	// the old file is moved aside while the new one is written at SavePath
+	FString BackupPath = InternalDownloadFileInfo.SavePath + TEXT(".base");
+	return FPaths::FileExists(BackupPath) ? BackupPath : InternalDownloadFileInfo.SavePath;
+}
+
+void FDownloadTransfer::RequestDeltaIndex()
+{
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> IndexRequest = FHttpModule::Get().CreateRequest();
+	IndexRequest->OnProcessRequestComplete().BindThreadSafeSP(AsShared(), &FDownloadTransfer::OnDeltaIndexComplete);
+	IndexRequest->SetURL(InternalDownloadFileInfo.DeltaIndexURL);
+	IndexRequest->SetVerb(TEXT("GET"));
+	if (!IndexRequest->ProcessRequest())
+	{
+		StartFullDownload();
+		return;
+	}
+	HeadRequest = IndexRequest;
+	UE_LOG(DownloadTookitLog, Log, TEXT("RequestDeltaIndex:%s."), *InternalDownloadFileInfo.DeltaIndexURL);
+}
+
+void FDownloadTransfer::OnDeltaIndexComplete(FHttpRequestPtr RequestPtr, FHttpResponsePtr ResponsePtr, bool bConnectedSuccessfully)
+{
+	if (RequestPtr != HeadRequest)
+	{
+		return;
+	}
+	HeadRequest.Reset();
+	int32 ResponseCode = ResponsePtr.IsValid() ? ResponsePtr->GetResponseCode() : 0;
+	TSharedPtr<FDownloadDeltaIndex, ESPMode::ThreadSafe> Index = MakeShared<FDownloadDeltaIndex, ESPMode::ThreadSafe>();
+	if (!bConnectedSuccessfully || ResponseCode != 200 || !Index->Load(ResponsePtr->GetContent()) || Index->FileSize != InternalDownloadFileInfo.Size)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("OnDeltaIndexComplete:the index is not available,download the whole file."));
+		StartFullDownload();
+		return;
+	}
+
+	// the file digest of index is calculated with the stream too
+	if (!Index->FileHash.IsEmpty() && !HashAlgorithms.Contains(Index->FileHashAlgorithm))
+	{
+		TArray<EDownloadHashAlgorithm> Algorithms = HashAlgorithms;
+		Algorithms.Add(Index->FileHashAlgorithm);
+		HashStage = MakeShared<FDownloadHashStage, ESPMode::ThreadSafe>(Algorithms);
+	}
+
+	// the new file is written at SavePath,so the old one there is moved aside.
+	const FString& SavePath = InternalDownloadFileInfo.SavePath;
+	FString BasePath = GetDeltaBasePath();
+	if (BasePath == SavePath)
+	{
+		BasePath = SavePath + TEXT(".base");
+		if (!IFileManager::Get().Move(*BasePath, *SavePath))
+		{
+			UE_LOG(DownloadTookitLog, Warning, TEXT("OnDeltaIndexComplete:move %s faild."), *SavePath);
+			StartFullDownload();
+			return;
+		}
+	}
+	else if (FPaths::FileExists(SavePath) && !IFileManager::Get().Delete(*SavePath))
+	{
+		FinishDownload(false);
+		return;
+	}
+
+	// scan the old file on worker threads,the result is ignored if the download is restarted.
+	DeltaIndex = Index;
+	TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe> WeakThis(AsShared());
+	Async(EAsyncExecution::ThreadPool, [WeakThis, Index, BasePath, SavePath]()
+	{
+		TArray<int64> BaseOffsets;
+		bool bPrepared = FDownloadDelta::FindBlocks(*Index, BasePath, BaseOffsets) && FDownloadDelta::CopyBlocks(*Index, BasePath, SavePath, BaseOffsets);
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Index, BaseOffsets, bPrepared]()
+		{
+			TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer = WeakThis.Pin();
+			if (Transfer.IsValid() && Transfer->DeltaIndex == Index)
+			{
+				Transfer->OnDeltaPrepared(BaseOffsets, bPrepared);
+			}
+		});
+	});
+}
+
+void FDownloadTransfer::OnDeltaPrepared(const TArray<int64>& InBaseOffsets, bool bPrepared)
+{
+	if (!bPrepared)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("OnDeltaPrepared:reuse the old file faild,download the whole file."));
+		StartFullDownload();
+		return;
+	}
+
+	// the found blocks are completed segments,the runs of missing blocks are downloaded as usual.
+	Segments.Reset();
+	const int64 FileSize = InternalDownloadFileInfo.Size;
+	const int64 BlockSize = DeltaIndex->BlockSize;
+	int32 BlockIndex = 0;
+	while (BlockIndex < InBaseOffsets.Num())
+	{
+		const bool bFound = InBaseOffsets[BlockIndex] >= 0;
+		int32 EndIndex = BlockIndex + 1;
+		while (EndIndex < InBaseOffsets.Num() && (InBaseOffsets[EndIndex] >= 0) == bFound)
+		{
+			++EndIndex;
+		}
+		int64 BeginPosition = BlockIndex * BlockSize;
+		int64 EndPosition = FMath::Min(EndIndex * BlockSize, FileSize) - 1;
+		if (bFound)
+		{
+			FDownloadSegment& Segment = Segments.AddDefaulted_GetRef();
+			Segment.Range.BeginPosition = BeginPosition;
+			Segment.Range.EndPosition = EndPosition;
+			Segment.ReceivedByte = Segment.RequestedByte = Segment.GetLength();
+			Segment.bCompleted = true;
+			TotalDownloadedByte += Segment.GetLength();
+			++SliceCount;
+		}
+		else
+		{
+			AddSegments(BeginPosition, EndPosition);
+		}
+		BlockIndex = EndIndex;
+	}
+	// the copied blocks are not in the stream,hashed when the file closed.
+	bHashReadBack = true;
+	UE_LOG(DownloadTookitLog, Log, TEXT("OnDeltaPrepared:%lld of %lld bytes are reused,%d segments."), TotalDownloadedByte.Load(), FileSize, Segments.Num());
+
+	if (!OpenDownload())
+	{
+		FinishDownload(false);
+		return;
+	}
+	Status = EDownloadStatus::Downloading;
+	ContinueDownload();
+}
+
+void FDownloadTransfer::StartFullDownload()
+{
+	DeltaIndex.Reset();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	bool bDeleted = true;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_DownloadFileSystem);
+		bDeleted = !FPaths::FileExists(InternalDownloadFileInfo.SavePath) || PlatformFile.DeleteFile(*InternalDownloadFileInfo.SavePath);
+	}
+	if (!bDeleted)
+	{
+		FinishDownload(false);
+		return;
+	}
+	BuildSegments();
+	if (!OpenDownload())
+	{
+		FinishDownload(false);
+		return;
+	}
+	Status = EDownloadStatus::Downloading;
+	ContinueDownload();
+}
+
+void FDownloadTransfer::UpdateValidators(FHttpResponsePtr ResponsePtr)
+{
+	if (!ResponsePtr.IsValid() || !InternalDownloadFileInfo.ETag.IsEmpty() || !InternalDownloadFileInfo.LastModified.IsEmpty())
+	{
+		return;
+	}
+	InternalDownloadFileInfo.ETag = ResponsePtr->GetHeader(TEXT("ETag"));
+	InternalDownloadFileInfo.LastModified = ResponsePtr->GetHeader(TEXT("Last-Modified"));
+}
+
+FString FDownloadTransfer::GetIfRangeValidator()const
+{
+	// weak ETag is not allowed by If-Range
+	const FString& ETag = InternalDownloadFileInfo.ETag;
+	if (!ETag.IsEmpty() && !ETag.StartsWith(TEXT("W/")))
+	{
+		return ETag;
+	}
+	return InternalDownloadFileInfo.LastModified;
+}
+
+FString FDownloadTransfer::GetIfRangeValidator(int32 InSourceIndex)const
+{
+	if (InSourceIndex == 0)
+	{
+		return GetIfRangeValidator();
+	}
+	// unknown until the first response of mirror
+	const FDownloadSource& Source = Sources.GetSource(InSourceIndex);
+	if (!Source.ETag.IsEmpty() && !Source.ETag.StartsWith(TEXT("W/")))
+	{
+		return Source.ETag;
+	}
+	return Source.LastModified;
+}
+
+void FDownloadTransfer::UpdateMetadataCache()
+{
+	FDownloadMetadata Metadata;
+	Metadata.URL = InternalDownloadFileInfo.URL;
+	Metadata.SavePath = InternalDownloadFileInfo.SavePath;
+	Metadata.Size = InternalDownloadFileInfo.Size;
+	Metadata.ETag = InternalDownloadFileInfo.ETag;
+	Metadata.LastModified = InternalDownloadFileInfo.LastModified;
+	Metadata.Digests = HashDigests;
+	// the file could not be revalidated without validators
+	if (Metadata.HasValidator())
+	{
+		FDownloadMetadataCache::Get().Add(Metadata);
+	}
+	else
+	{
+		FDownloadMetadataCache::Get().Remove(Metadata.URL);
+	}
+}
+
+void FDownloadTransfer::PreDownloadRequest()
+{
+	HashDigests.Empty();
+	// started after the hash state restored
+	HashStage = MakeShared<FDownloadHashStage, ESPMode::ThreadSafe>(HashAlgorithms);
+	ChunkVerifier.Reset();
+	bHashReadBack = false;
+	StreamHashOffset = 0;
+	PendingJournal.Reset();
+	JournalElapsedTime = 0.f;
+	TotalDownloadedByte = 0;
+	ReceivedByteInFrame = 0;
+	SliceCount = 0;
+	TotalRetryCount = 0;
+	Sources.Reset(InternalDownloadFileInfo.URL, InternalDownloadFileInfo.MirrorURLs);
+}
+
+bool FDownloadTransfer::DoDownloadRequest(const FDownloadFile& InDownloadFile, FDownloadSegment& InSegment, int64 InMaxRequestByte)
+{	
+	SCOPE_CYCLE_COUNTER(STAT_DownloadSendRequest);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadTransfer SendRequest"));
+	bool bDoStatus = false;
+	FDownloadRange RequestRange;
+	RequestRange.BeginPosition = InSegment.Range.BeginPosition + InSegment.RequestedByte;
+	RequestRange.EndPosition = InSegment.Range.EndPosition;
+	int64 MaxRequestByte = InMaxRequestByte > 0 ? FMath::Min<int64>(InMaxRequestByte, AutoTuner.GetRequestByte()) : AutoTuner.GetRequestByte();
+	// the whole file is requested without Range
+	if (!bRangeIgnored)
+	{
+		RequestRange.EndPosition = FMath::Min(RequestRange.EndPosition, RequestRange.BeginPosition + MaxRequestByte - 1);
+	}
+	if (RequestRange.EndPosition < RequestRange.BeginPosition)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("DoDownloadRequest:Range EndPosition(%lld) less than BeginPosition(%lld)"),RequestRange.EndPosition,RequestRange.BeginPosition);
+		return false;
+	}
+	int32 SourceIndex = Sources.Pick();
+	if (SourceIndex == INDEX_NONE)
+	{
+		UE_LOG(DownloadTookitLog, Error, TEXT("DoDownloadRequest:all sources of %s are excluded."), *InDownloadFile.URL);
+		return false;
+	}
+	TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+	HttpRequest->OnRequestProgress().BindThreadSafeSP(AsShared(), &FDownloadTransfer::OnDownloadProcess);
+	// HttpRequest->OnHeaderReceived().BindThreadSafeSP(AsShared(), &FDownloadTransfer::OnDownloadHeaderReceived);
+	HttpRequest->OnProcessRequestComplete().BindThreadSafeSP(AsShared(), &FDownloadTransfer::OnDownloadComplete);
+	HttpRequest->SetURL(Sources.GetSource(SourceIndex).URL);
+	HttpRequest->SetVerb(TEXT("GET"));
+
+	FString RangeArgs = FString::Printf(TEXT("bytes=%lld-%lld"), RequestRange.BeginPosition, RequestRange.EndPosition);
+	UE_LOG(DownloadTookitLog, Log, TEXT("DoDownloadRequest:RangeArgs is %s"), bRangeIgnored ? TEXT("ignored") : *RangeArgs);
+
+	if (!bRangeIgnored)
+	{
+		HttpRequest->SetHeader(TEXT("Range"), RangeArgs);
+	}
+	FString IfRange = GetIfRangeValidator(SourceIndex);
+	if (!IfRange.IsEmpty() && !bRangeIgnored)
+	{
+		HttpRequest->SetHeader(TEXT("If-Range"), IfRange);
+	}
+	if (HttpRequest->ProcessRequest())
+	{
+#if WITH_LOG
+		UE_LOG(DownloadTookitLog, Warning, TEXT("Downloading"));
+#endif
+		DOWNLOAD_TRACE_EVENT(TEXT("Download RequestStart %lld-%lld"), RequestRange.BeginPosition, RequestRange.EndPosition);
+		FDownloadSegmentRequest SegmentRequest;
+		SegmentRequest.Request = HttpRequest;
+		SegmentRequest.Offset = InSegment.RequestedByte;
+		SegmentRequest.Length = RequestRange.EndPosition - RequestRange.BeginPosition + 1;
+		SegmentRequest.StartTime = FPlatformTime::Seconds();
+		SegmentRequest.SourceIndex = SourceIndex;
+		Sources.OnRequestStarted(SourceIndex);
+		InSegment.Requests.Add(SegmentRequest);
+		InSegment.RequestedByte += SegmentRequest.Length;
+		StartTicker();
+		bDoStatus = true;
+	}
+
+	return bDoStatus;
+}
+
+static FString GetFileNameByURL(const FString& InURL)
+{
+	if (InURL.IsEmpty())
+		return TEXT("");
+	FString Path;
+	FString Name;
+	FString Extension;
+	FPaths::Split(InURL, Path, Name, Extension);
+	return Name + (Extension.IsEmpty() ? TEXT("") : (FString(TEXT(".")) + Extension));
+}
+
+static int64 GetResponseContentLength(FHttpResponsePtr InHttpResponse)
+{
+	// GetContentLength is int32,parse the header for content larger than 2GB.
+	FString ContentLength = InHttpResponse->GetHeader(TEXT("Content-Length"));
+	return ContentLength.IsEmpty() ? InHttpResponse->GetContentLength() : FCString::Atoi64(*ContentLength);
+}
@@ -0,0 +1,294 @@
+#include "DownloadVerifier.h"
+#include "DownloadTookitLog.h"
+#include "DownloadTookitStats.h"
+
+// engine header
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformMisc.h"
+#include "Templates/UniquePtr.h"
+
+DECLARE_CYCLE_STAT(TEXT("Verify File"), STAT_DownloadVerifyFile, STATGROUP_DownloadTookit);
+
+#define MIN_VERIFY_READ_SIZE 1024*64 // 64KB
+// the region is unmapped before the next one,the address space of a thread is bounded.
+#define VERIFY_MAPPED_WINDOW_SIZE 1024*1024*256ll // 256MB
+
+UDownloadVerifier::UDownloadVerifier()
+	:Super(),
+	VerifiedFileCount(0),
+	bVerifying(false)
+{
+}
+
+void UDownloadVerifier::Start(const TArray<FDownloadFile>& InManifest, const FDownloadVerifySettings& InSettings)
+{
+	Job = MakeShared<FVerifyJob, ESPMode::ThreadSafe>();
+	Job->Files = InManifest;
+	Job->Settings = InSettings;
+	Statuses.Init(EDownloadVerifyStatus::Pending, InManifest.Num());
+	VerifiedFileCount = 0;
+	bVerifying = true;
+
+	// the largest file start first,the threads finish at about the same time.
+	int64 TotalByte = 0;
+	for (int32 Index = 0; Index < InManifest.Num(); ++Index)
+	{
+		Job->Order.Add(Index);
+		TotalByte += FMath::Max<int64>(InManifest[Index].Size, 0);
+	}
+	Job->Order.StableSort([&InManifest](int32 Lhs, int32 Rhs) { return InManifest[Lhs].Size > InManifest[Rhs].Size; });
+	Job->TotalByte.Set(TotalByte);
+
+	int32 ThreadCount = InSettings.MaxThreadCount > 0 ? InSettings.MaxThreadCount : FPlatformMisc::NumberOfCoresIncludingHyperthreads();
+	ThreadCount = FMath::Clamp(ThreadCount, 1, FMath::Max(1, InManifest.Num()));
+	Job->RunningThreadCount.Set(ThreadCount);
+	UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadVerifier:verify %d files(%lld bytes) on %d threads."), InManifest.Num(), TotalByte, ThreadCount);
+
+	// the files are hashed for minutes,dedicated threads not block the thread pool.
+	TSharedPtr<FVerifyJob, ESPMode::ThreadSafe> StartedJob = Job;
+	TWeakObjectPtr<UDownloadVerifier> WeakThis(this);
+	for (int32 Index = 0; Index < ThreadCount; ++Index)
+	{
+		Async(EAsyncExecution::Thread, [StartedJob, WeakThis]()
+		{
+			UDownloadVerifier::RunJob(StartedJob, WeakThis);
+		});
+	}
+}
+
+void UDownloadVerifier::RunJob(TSharedPtr<FVerifyJob, ESPMode::ThreadSafe> InJob, TWeakObjectPtr<UDownloadVerifier> InVerifier)
+{
+	while (!InJob->bCanceled)
+	{
+		int32 OrderIndex = InJob->NextOrder.Increment() - 1;
+		if (OrderIndex >= InJob->Order.Num())
+			break;
+		int32 FileIndex = InJob->Order[OrderIndex];
+		const FDownloadFile& File = InJob->Files[FileIndex];
+		// the file of unknown size is counted when it is found
+		int64 ExpectedByte = File.Size;
+		if (ExpectedByte <= 0)
+		{
+			ExpectedByte = File.SavePath.IsEmpty() ? 0 : FMath::Max<int64>(IFileManager::Get().FileSize(*File.SavePath), 0);
+			InJob->TotalByte.Add(ExpectedByte);
+		}
+
+		int64 ReadByte = 0;
+		EDownloadVerifyStatus Status = VerifyFile(File, InJob->Settings, [&InJob, &ReadByte](int64 InByte)
+		{
+			ReadByte += InByte;
+			InJob->VerifiedByte.Add(InByte);
+			return !InJob->bCanceled;
+		});
+		// the file stopped early is done too
+		if (ExpectedByte > ReadByte)
+		{
+			InJob->VerifiedByte.Add(ExpectedByte - ReadByte);
+		}
+		if (Status == EDownloadVerifyStatus::Canceled)
+			break;
+
+		AsyncTask(ENamedThreads::GameThread, [InJob, InVerifier, FileIndex, Status]()
+		{
+			UDownloadVerifier* Verifier = InVerifier.Get();
+			if (Verifier && Verifier->bVerifying && Verifier->Job == InJob)
+			{
+				Verifier->OnFileVerified(FileIndex, Status);
+			}
+		});
+	}
+
+	// the results of other threads are queued before
+	if (InJob->RunningThreadCount.Decrement() == 0 && !InJob->bCanceled)
+	{
+		AsyncTask(ENamedThreads::GameThread, [InJob, InVerifier]()
+		{
+			UDownloadVerifier* Verifier = InVerifier.Get();
+			if (Verifier && Verifier->bVerifying && Verifier->Job == InJob)
+			{
+				Verifier->OnJobCompleted();
+			}
+		});
+	}
+}
+
+EDownloadVerifyStatus UDownloadVerifier::VerifyFile(const FDownloadFile& InDownloadFile, const FDownloadVerifySettings& InSettings, TFunctionRef<bool(int64)> InOnRead)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DownloadVerifyFile);
+	DOWNLOAD_TRACE_SCOPE(TEXT("DownloadVerifier Verify"));
+	const FString& SavePath = InDownloadFile.SavePath;
+	const int64 FileSize = SavePath.IsEmpty() ? -1 : IFileManager::Get().FileSize(*SavePath);
+	if (FileSize < 0)
+	{
+		return EDownloadVerifyStatus::Missing;
+	}
+	if (InDownloadFile.Size > 0 && FileSize != InDownloadFile.Size)
+	{
+		return EDownloadVerifyStatus::SizeMismatched;
+	}
+	TUniquePtr<IDownloadHasher> Hasher = IDownloadHasher::Create(InSettings.HashAlgorithm);
+	if (InDownloadFile.HASH.IsEmpty() || !Hasher.IsValid())
+	{
+		return EDownloadVerifyStatus::Unverifiable;
+	}
+
+	bool bStopped = false;
+	bool bHashed = HashFile(*Hasher, SavePath, FileSize, InSettings, [&InOnRead, &bStopped](int64 InByte)
+	{
+		bStopped = !InOnRead(InByte);
+		return !bStopped;
+	});
+	if (!bHashed)
+	{
+		return bStopped ? EDownloadVerifyStatus::Canceled : EDownloadVerifyStatus::ReadFailed;
+	}
+	return Hasher->Final().Equals(InDownloadFile.HASH, ESearchCase::IgnoreCase) ? EDownloadVerifyStatus::Matched : EDownloadVerifyStatus::HashMismatched;
+}
+
+bool UDownloadVerifier::HashFile(IDownloadHasher& InHasher, const FString& InFilePath, int64 InFileSize, const FDownloadVerifySettings& InSettings, TFunctionRef<bool(int64)> InOnRead)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const int64 ReadSize = FMath::Max(InSettings.ReadBufferSize, MIN_VERIFY_READ_SIZE);
+
+	// the platform not support mapping fall back to read
+	TUniquePtr<IMappedFileHandle> MappedHandle(InSettings.bMemoryMapped && InFileSize > 0 ? PlatformFile.OpenMapped(*InFilePath) : nullptr);
+	if (MappedHandle.IsValid())
+	{
+		if (MappedHandle->GetFileSize() != InFileSize)
+		{
+			return false;
+		}
+		for (int64 WindowOffset = 0; WindowOffset < InFileSize; WindowOffset += VERIFY_MAPPED_WINDOW_SIZE)
+		{
+			const int64 WindowLength = FMath::Min<int64>(VERIFY_MAPPED_WINDOW_SIZE, InFileSize - WindowOffset);
+			TUniquePtr<IMappedFileRegion> MappedRegion(MappedHandle->MapRegion(WindowOffset, WindowLength, true));
+			if (!MappedRegion.IsValid())
+			{
+				return false;
+			}
+			const uint8* MappedData = MappedRegion->GetMappedPtr();
+			for (int64 Offset = 0; Offset < WindowLength; Offset += ReadSize)
+			{
+				const int64 Length = FMath::Min<int64>(ReadSize, WindowLength - Offset);
+				InHasher.Update(MappedData + Offset, Length);
+				if (!InOnRead(Length))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	TUniquePtr<IFileHandle> FileHandle(PlatformFile.OpenRead(*InFilePath));
+	if (!FileHandle.IsValid())
+	{
+		return false;
+	}
+	// a small file not need the whole buffer
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized((int32)FMath::Clamp<int64>(InFileSize, 1, ReadSize));
+	for (int64 Offset = 0; Offset < InFileSize; Offset += Buffer.Num())
+	{
+		const int64 Length = FMath::Min<int64>(Buffer.Num(), InFileSize - Offset);
+		if (!FileHandle->Read(Buffer.GetData(), Length))
+		{
+			return false;
+		}
+		InHasher.Update(Buffer.GetData(), Length);
+		if (!InOnRead(Length))
+			return false;
+	}
+	return true;
+}
+
+void UDownloadVerifier::OnFileVerified(int32 InFileIndex, EDownloadVerifyStatus InStatus)
+{
+	Statuses[InFileIndex] = InStatus;
+	++VerifiedFileCount;
+	const FDownloadFile& File = Job->Files[InFileIndex];
+	if (InStatus == EDownloadVerifyStatus::HashMismatched || InStatus == EDownloadVerifyStatus::ReadFailed)
+	{
+		UE_LOG(DownloadTookitLog, Warning, TEXT("UDownloadVerifier:%s is %s."), *File.SavePath, InStatus == EDownloadVerifyStatus::ReadFailed ? TEXT("not readable") : TEXT("corrupted"));
+	}
+	OnFileVerifiedDyMultiDlg.Broadcast(this, File, InStatus);
+}
+
+void UDownloadVerifier::OnJobCompleted()
+{
+	bVerifying = false;
+	TArray<FDownloadFile> FilesToDownload = GetFilesToDownload();
+	UE_LOG(DownloadTookitLog, Log, TEXT("UDownloadVerifier:%d of %d files need to download."), FilesToDownload.Num(), Statuses.Num());
+	OnVerifyCompleteDyMultiDlg.Broadcast(this, FilesToDownload);
+}
+
+void UDownloadVerifier::Cancel()
+{
+	if (!bVerifying)
+	{
+		return;
+	}
+	bVerifying = false;
+	Job->bCanceled = true;
+	for (EDownloadVerifyStatus& Status : Statuses)
+	{
+		if (Status == EDownloadVerifyStatus::Pending)
+			Status = EDownloadVerifyStatus::Canceled;
+	}
+	UE_LOG(DownloadTookitLog, Warning, TEXT("UDownloadVerifier:verify is canceled,%d of %d files are verified."), VerifiedFileCount, Statuses.Num());
+}
+
+bool UDownloadVerifier::IsVerifying()const
+{
+	return bVerifying;
+}
+
+float UDownloadVerifier::GetProgress()const
+{
+	if (!Job.IsValid())
+	{
+		return 0.f;
+	}
+	if (!bVerifying && VerifiedFileCount == Statuses.Num())
+	{
+		return 1.f;
+	}
+	const int64 TotalByte = Job->TotalByte.GetValue();
+	return TotalByte > 0 ? FMath::Min((float)((double)Job->VerifiedByte.GetValue() / TotalByte), 1.f) : 0.f;
+}
+
+int64 UDownloadVerifier::GetVerifiedSize64()const
+{
+	return Job.IsValid() ? Job->VerifiedByte.GetValue() : 0;
+}
+
+int64 UDownloadVerifier::GetTotalSize64()const
+{
+	return Job.IsValid() ? Job->TotalByte.GetValue() : 0;
+}
+
+int32 UDownloadVerifier::GetFileCount()const
+{
+	return Statuses.Num();
+}
+
+int32 UDownloadVerifier::GetVerifiedFileCount()const
+{
+	return VerifiedFileCount;
+}
+
+EDownloadVerifyStatus UDownloadVerifier::GetFileStatus(int32 InFileIndex)const
+{
+	return Statuses.IsValidIndex(InFileIndex) ? Statuses[InFileIndex] : EDownloadVerifyStatus::Pending;
+}
+
+TArray<FDownloadFile> UDownloadVerifier::GetFilesToDownload()const
+{
+	TArray<FDownloadFile> FilesToDownload;
+	for (int32 Index = 0; Index < Statuses.Num(); ++Index)
+	{
+		if (Statuses[Index] != EDownloadVerifyStatus::Matched)
+			FilesToDownload.Add(Job->Files[Index]);
+	}
+	return FilesToDownload;
+}
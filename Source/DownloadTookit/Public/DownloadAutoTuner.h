@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadAutoTuner.generated.h"
+
+// bounds of the values chosen by the auto tuner
+USTRUCT(BlueprintType)
+struct DOWNLOADTOOKIT_API FDownloadAutoTuneSettings
+{
+	GENERATED_USTRUCT_BODY()
+public:
+	// disabled is fixed request size and connection count
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool bEnabled = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int64 MinRequestByte = 1024 * 256;
+	// every connection hold a request in memory,max is 64MB.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int64 MaxRequestByte = 1024 * 1024 * 16;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int32 MinConnectionCount = 1;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int32 MaxConnectionCount = 8;
+	// second,a request lasts about this long so the round trip is a small part of it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		float TargetRequestSeconds = 2.f;
+};
+
+/*
+	Choose the request size and connection count of a download by AIMD(only access on game thread).
+	- request size is increased additively while requests are shorter than the target,
+		halved when a request failed or a chunk corrupted.
+	- connection count is increased one by one while the throughput grows,
+		the last step is reverted when it not helps,halved when a request failed.
+	- the connection count is probed again after some hold intervals,follow the changed network.
+*/
+class DOWNLOADTOOKIT_API FDownloadAutoTuner
+{
+public:
+	FDownloadAutoTuner();
+
+	// values are reset to the initial ones clamped by settings
+	void Start(const FDownloadAutoTuneSettings& InSettings, int32 InConnectionCount, int64 InRequestByte);
+	void AddReceivedByte(int64 InByte);
+	// InSeconds is from the request sent to completed
+	void OnRequestCompleted(int64 InRequestByte, double InSeconds);
+	void OnRequestFailed();
+	// called every tick,bInSaturated is false when the throughput is limited by others(rate limit,paused).
+	void Update(bool bInSaturated);
+
+	bool IsEnabled()const { return Settings.bEnabled; }
+	const FDownloadAutoTuneSettings& GetSettings()const { return Settings; }
+	int32 GetConnectionCount()const { return ConnectionCount; }
+	int64 GetRequestByte()const { return RequestByte; }
+
+private:
+	FDownloadAutoTuneSettings Settings;
+	int32 ConnectionCount;
+	int64 RequestByte;
+	double IntervalStartTime;
+	int64 IntervalByte;
+	int32 IntervalErrorCount;
+	double LastBytesPerSecond;
+	bool bConnectionIncreased;
+	int32 HoldInterval;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+// project header
+#include "DownloadFile.h"
+#include "DownloadProxy.h"
+#include "DownloadMetrics.h"
+
+// engine header
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "DownloadBatch.generated.h"
+
+class UDownloadBatch;
+enum class EDownloadPriority : uint8;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnDownloadBatchFileComplete, UDownloadBatch*, Batch, const FDownloadFile&, File, bool, bSuccess);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnDownloadBatchComplete, UDownloadBatch*, Batch, bool, bSuccess);
+
+UENUM(BlueprintType)
+enum class EDownloadBatchFileStatus : uint8
+{
+	Pending,
+	// the local file already matched
+	Skipped,
+	Downloading,
+	// copied from a file of the same content
+	Copied,
+	Succeeded,
+	Failed
+};
+
+// a file of manifest
+struct FDownloadBatchEntry
+{
+	FDownloadFile File;
+	EDownloadBatchFileStatus Status = EDownloadBatchFileStatus::Pending;
+	// the entry downloaded for all entries of same content(URL or HASH),itself if it is the first one.
+	int32 PrimaryIndex = INDEX_NONE;
+	// entries of same content,copied from this one when it is completed.
+	TArray<int32> DuplicateIndices;
+	UDownloadProxy* Proxy = nullptr;
+	// bytes of the completed file,or the size of manifest before started
+	int64 Size = 0;
+	bool bLocalMatched = false;
+};
+
+/*
+	Download the files of a manifest as one job.
+	- the local file matched the Size/HASH of manifest is skipped,checked on worker threads.
+	- files of same URL or HASH are downloaded once and copied to the other SavePath.
+	- files are enqueued to UDownloadManager a few at a time,the largest first,so the small files fill the
+		connections while the large files are downloading.
+	- the progress,speed and ETA are of the whole batch,OnFileCompleteDyMultiDlg report every file.
+	- HASH is the MD5 digest,a downloaded file not match it is failed.
+*/
+UCLASS(BlueprintType)
+class DOWNLOADTOOKIT_API UDownloadBatch : public UObject
+{
+	GENERATED_BODY()
+public:
+	UDownloadBatch();
+
+	// called by UDownloadManager::EnqueueBatch
+	void Start(const TArray<FDownloadFile>& InManifest, EDownloadPriority InPriority, int32 InConnectionCount);
+	// called by the tick of UDownloadManager
+	void Tick(float InDeltaTime);
+
+	// cancel the downloading files,the complete delegate is not broadcast.
+	UFUNCTION(BlueprintCallable)
+		void Cancel();
+	UFUNCTION(BlueprintCallable)
+		EDownloadStatus GetDownloadStatus()const;
+	UFUNCTION(BlueprintCallable)
+		float GetDownloadProgress()const;
+	UFUNCTION(BlueprintCallable)
+		int64 GetDownloadedSize64()const;
+	UFUNCTION(BlueprintCallable)
+		int64 GetTotalSize64()const;
+	// throughput and ETA of the whole batch
+	UFUNCTION(BlueprintCallable)
+		FDownloadMetrics GetMetrics()const;
+	UFUNCTION(BlueprintCallable)
+		int32 GetFileCount()const;
+	// skipped,copied,succeeded or failed
+	UFUNCTION(BlueprintCallable)
+		int32 GetCompletedFileCount()const;
+	UFUNCTION(BlueprintCallable)
+		EDownloadBatchFileStatus GetFileStatus(int32 InFileIndex)const;
+	UFUNCTION(BlueprintCallable)
+		TArray<FDownloadFile> GetFailedFiles()const;
+
+public:
+	UPROPERTY(BlueprintAssignable)
+		FOnDownloadBatchFileComplete OnFileCompleteDyMultiDlg;
+	UPROPERTY(BlueprintAssignable)
+		FOnDownloadBatchComplete OnBatchCompleteDyMultiDlg;
+
+protected:
+	// group the entries of same content,return the count of groups.
+	int32 BuildGroups();
+	void OnLocalFilesChecked(const TArray<bool>& InMatched);
+	// enqueue the pending files until the window is full
+	void EnqueuePendingFiles();
+	void CopyDuplicates(int32 InSourceIndex);
+	void OnDuplicatesCopied(int32 InSourceIndex, const TArray<bool>& InCopied);
+	void CompleteEntry(int32 InEntryIndex, EDownloadBatchFileStatus InStatus);
+	void CheckBatchComplete();
+	// bytes of the completed files and the progress of the downloading files
+	void UpdateProgress();
+
+	UFUNCTION()
+		void OnFileComplete(UDownloadProxy* InProxy, bool bInSuccess);
+	UFUNCTION()
+		void OnFileCanceled(UDownloadProxy* InProxy);
+
+	static bool IsLocalFileMatched(const FDownloadFile& InDownloadFile);
+
+private:
+	TArray<FDownloadBatchEntry> Entries;
+	// primary entries to download,sorted by size
+	TArray<int32> PendingIndices;
+	UPROPERTY()
+		TArray<UDownloadProxy*> ActiveProxies;
+	EDownloadStatus Status;
+	EDownloadPriority Priority;
+	int32 ConnectionCount;
+	// async copies in progress
+	int32 CopyingCount;
+	int32 CompletedCount;
+	int64 CompletedByte;
+	int64 DownloadedByte;
+	int64 TotalByte;
+	FDownloadMetricsTracker Metrics;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadStage.h"
+
+/*
+	Recycle the buffers handed over to the download pipeline(only access on game thread).
+	- a buffer is reused after all stages released it(the pool hold the only reference).
+	- at most MaxPooledBuffer buffers are kept,the others are freed after released.
+*/
+class DOWNLOADTOOKIT_API FDownloadBufferPool
+{
+public:
+	FDownloadBufferPool(int32 InMaxPooledBuffer = 0);
+	~FDownloadBufferPool();
+
+	// a buffer of InLength byte,the content is uninitialized.
+	FDownloadBufferPtr Acquire(int64 InLength);
+	// free the buffers not used by any stage
+	void Trim();
+	void Reset();
+
+	int32 Num()const { return Buffers.Num(); }
+
+private:
+	// the pooled memory counted by stats
+	void UpdateMemoryStat();
+
+	TArray<FDownloadBufferPtr> Buffers;
+	int32 MaxPooledBuffer;
+	int64 PooledByte;
+};
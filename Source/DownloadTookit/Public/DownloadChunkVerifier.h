@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadStage.h"
+#include "DownloadHasher.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/SharedPointer.h"
+
+/*
+	Verify the download content chunk by chunk.
+	- every buffer is hashed on the thread pool as soon as it is received and dropped,in receive order of its chunk,
+		chunks are hashed in parallel.
+	- expected digests come from the chunk hash list,or only the root of the hash tree.
+	- hash tree: leaf is the digest of chunk,parent is Hash(Left+Right) over the raw digest bytes,
+		the last node of an odd level is promoted to next level.
+*/
+class DOWNLOADTOOKIT_API FDownloadChunkVerifier : public TSharedFromThis<FDownloadChunkVerifier, ESPMode::ThreadSafe>
+{
+public:
+	FDownloadChunkVerifier(EDownloadHashAlgorithm InAlgorithm, const TArray<FString>& InChunkHashes, const FString& InMerkleRoot);
+
+	// check the chunk hash list match the chunk count and the root,must be called before Update.
+	bool Prepare(int32 InChunkCount);
+	// hash the next buffer of chunk,the buffers of a chunk must be given in file order.
+	void Update(int32 InChunkIndex, const FDownloadBufferPtr& InBuffer);
+	// all buffers of chunk are given,InOnVerified is called on game thread,bVerified is always true if only root is given.
+	// the chunk is hashed from its begin by next Update.
+	void VerifyChunk(int32 InChunkIndex, TFunction<void(int32, bool)> InOnVerified);
+	// all chunks are verified,check the root of the received chunks.
+	bool VerifyMerkleRoot()const;
+	// digests of verified chunks,saved to the journal for resume.
+	const TArray<FString>& GetLeafHashes()const { return LeafHashes; }
+	void RestoreLeafHashes(const TArray<FString>& InLeafHashes);
+
+	static FString CalcMerkleRoot(EDownloadHashAlgorithm InAlgorithm, const TArray<FString>& InLeafHashes);
+
+private:
+	// buffer to hash,or the end of chunk if null.
+	struct FChunkCommand
+	{
+		FDownloadBufferPtr Buffer;
+		TFunction<void(int32, bool)> OnVerified;
+	};
+
+	// incremental hash of a chunk,the commands are consumed by one task of the thread pool at a time.
+	struct FChunkState
+	{
+		int32 ChunkIndex = 0;
+		TUniquePtr<IDownloadHasher> Hasher;
+		FCriticalSection Lock;
+		TArray<FChunkCommand> Commands;
+		bool bScheduled = false;
+	};
+
+	void AddCommand(int32 InChunkIndex, FChunkCommand&& InCommand);
+	// consume the commands of chunk on the thread pool
+	static void ProcessCommands(TSharedRef<FDownloadChunkVerifier, ESPMode::ThreadSafe> InVerifier, TSharedRef<FChunkState, ESPMode::ThreadSafe> InState);
+	void OnChunkHashed(int32 InChunkIndex, const FString& InDigest, TFunction<void(int32, bool)> InOnVerified);
+
+private:
+	EDownloadHashAlgorithm Algorithm;
+	TArray<FString> ChunkHashes;
+	FString MerkleRoot;
+	// digest of received chunks(only access on game thread)
+	TArray<FString> LeafHashes;
+	TArray<TSharedRef<FChunkState, ESPMode::ThreadSafe>> ChunkStates;
+};
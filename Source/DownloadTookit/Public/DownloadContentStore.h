@@ -0,0 +1,80 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadHasher.h"
+#include "Containers/Ticker.h"
+
+// a file of the store
+struct FDownloadContentEntry
+{
+	EDownloadHashAlgorithm Algorithm = EDownloadHashAlgorithm::MD5;
+	// lower case hex digest
+	FString Digest;
+	int64 Size = 0;
+	// utc ticks of the stored file modified,the file changed outside is dropped.
+	int64 ModifiedTime = 0;
+	// utc ticks of last add or fetch
+	int64 LastAccessTime = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FDownloadContentEntry& Entry);
+};
+
+/*
+	Content addressed store of downloaded files(Saved/DownloadTookit/ContentStore),only access on game thread.
+	- a file is stored by its digest,a download of the same digest is satisfied from the store instead of network.
+	- the file is cloned(copy on write) if the file system support it,or copied.
+		never hard linked,a file written in place(resumed,delta or repaired) would change the stored one too.
+	- disabled until a capacity is set,the least recently used files are evicted when the capacity exceeded.
+		a found file is pinned until released,it is not evicted while it is fetched on a worker thread.
+	- the index is a small binary file loaded at first use,changes are saved after a short delay like FDownloadMetadataCache.
+*/
+class DOWNLOADTOOKIT_API FDownloadContentStore
+{
+public:
+	static FDownloadContentStore& Get();
+
+	// byte,0 is disabled
+	void SetCapacity(int64 InCapacity);
+	int64 GetCapacity()const { return Capacity; }
+	bool IsEnabled()const { return Capacity > 0; }
+	int64 GetStoredSize()const { return StoredSize; }
+
+	// the path of stored file and mark it used,empty if the digest is not stored.
+	// the found file is pinned,call Release after it is fetched.
+	FString Find(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest, int64& OutSize);
+	void Release(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest);
+	// store the file asynchronously,the file must not be changed until it is stored.
+	void Add(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest, const FString& InFilePath);
+	void Remove(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest);
+	void Flush();
+
+	static FString GetStoreDir();
+	// clone or copy InSourcePath to InTargetPath,the target is replaced. thread safe.
+	static bool CloneFile(const FString& InTargetPath, const FString& InSourcePath);
+
+private:
+	FDownloadContentStore();
+
+	static FString GetEntryKey(EDownloadHashAlgorithm InAlgorithm, const FString& InDigest);
+	// utc ticks,0 if the file not exist
+	static int64 GetModifiedTime(const FString& InFilePath);
+	FString GetObjectPath(const FDownloadContentEntry& InEntry)const;
+	void OnAdded(const FDownloadContentEntry& InEntry, bool bInAdded);
+	void Evict();
+	void Load();
+	bool Save();
+	void MarkDirty();
+	bool OnSaveTick(float InDeltaTime);
+	void Serialize(FArchive& Ar);
+
+private:
+	TMap<FString, FDownloadContentEntry> Entries;
+	// digests being stored
+	TSet<FString> AddingKeys;
+	// digests being fetched,the count of Find not released
+	TMap<FString, int32> PinnedKeys;
+	int64 Capacity;
+	int64 StoredSize;
+	bool bLoaded;
+	FDelegateHandle SaveDelegateHandle;
+};
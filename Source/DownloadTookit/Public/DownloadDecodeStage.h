@@ -0,0 +1,35 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadStage.h"
+#include "DownloadDecoder.h"
+
+/*
+	Decode the download content on a worker thread,the decoded content is passed to the next stages.
+	- buffers must be enqueued in stream order,the decoded buffers are enqueued at the decoded offset.
+	- the next stages are fed only by this stage,they should be closed after this stage closed.
+*/
+class DOWNLOADTOOKIT_API FDownloadDecodeStage : public FDownloadStage
+{
+public:
+	FDownloadDecodeStage(EDownloadContentEncoding InEncoding, const TArray<TSharedPtr<FDownloadStage, ESPMode::ThreadSafe>>& InNextStages);
+	virtual ~FDownloadDecodeStage();
+
+protected:
+	virtual bool OnStart()override;
+	virtual void OnBuffer(int64 InOffset, const TArray<uint8>& InData)override;
+	virtual void OnFinish()override;
+
+	bool AppendOutput(const uint8* InData, int64 InLength);
+	bool FlushOutput();
+
+private:
+	EDownloadContentEncoding Encoding;
+	TArray<TSharedPtr<FDownloadStage, ESPMode::ThreadSafe>> NextStages;
+	TUniquePtr<IDownloadDecoder> Decoder;
+	// offset of the next encoded buffer
+	int64 InputOffset;
+	// offset of the Output in decoded stream
+	int64 OutputOffset;
+	FDownloadBufferPtr Output;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+#include "DownloadDecoder.generated.h"
+
+UENUM(BlueprintType)
+enum class EDownloadContentEncoding : uint8
+{
+	None,
+	// gzip or zlib stream,detected by the header
+	Gzip,
+	Zlib,
+	// not built in yet,the download is failed
+	Zstd,
+	LZ4
+};
+
+/*
+	Streaming decoder of the downloaded content.
+	- Decode can be called any times with the content in order,the output is passed to InOnOutput.
+	- Finish return false if the stream is truncated.
+*/
+class DOWNLOADTOOKIT_API IDownloadDecoder
+{
+public:
+	virtual ~IDownloadDecoder() {}
+
+	virtual bool Decode(const uint8* InData, int64 InLength, TFunctionRef<bool(const uint8*, int64)> InOnOutput) = 0;
+	virtual bool Finish() = 0;
+
+	// null if the encoding is not supported
+	static TUniquePtr<IDownloadDecoder> Create(EDownloadContentEncoding InEncoding);
+};
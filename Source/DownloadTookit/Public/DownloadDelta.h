@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "DownloadHasher.h"
+
+/*
+	Block checksum index of a file,published next to the file for delta download(like zsync).
+	- the file is divided into blocks of BlockSize,the last block may be shorter.
+	- every block has a rolling weak checksum(rsync) and a strong checksum,
+		the blocks of the old local file are found by the weak checksum and confirmed by the strong one.
+	- FileHash is the digest of the whole file,the result of delta download is verified by it.
+*/
+struct DOWNLOADTOOKIT_API FDownloadDeltaIndex
+{
+	int64 FileSize = 0;
+	int32 BlockSize = 0;
+	EDownloadHashAlgorithm BlockHashAlgorithm = EDownloadHashAlgorithm::XXHash64;
+	EDownloadHashAlgorithm FileHashAlgorithm = EDownloadHashAlgorithm::MD5;
+	FString FileHash;
+	TArray<uint32> WeakChecksums;
+	TArray<FString> StrongChecksums;
+	// set by the canceled download,FindBlocks/CopyBlocks stop at the next region or block.
+	FThreadSafeBool bCanceled;
+
+	int32 GetBlockCount()const;
+	int64 GetBlockLength(int32 InBlockIndex)const;
+
+	bool Load(const TArray<uint8>& InData);
+	bool Save(const FString& InIndexPath);
+	// build the index of a local file,used by the publisher.
+	static bool Build(const FString& InFilePath, int32 InBlockSize, FDownloadDeltaIndex& OutIndex);
+
+	static uint32 CalcWeakChecksum(const uint8* InData, int32 InLength);
+
+private:
+	void Serialize(FArchive& Ar);
+};
+
+/*
+	Delta download helpers,run on worker threads.
+	- FindBlocks scan the old file in regions by ParallelFor,every region is scanned by a rolling checksum.
+	- CopyBlocks write the found blocks to their offsets of the new file,the others should be downloaded.
+*/
+class DOWNLOADTOOKIT_API FDownloadDelta
+{
+public:
+	// OutBaseOffsets is the offset in the old file of every block,-1 is not found.
+	static bool FindBlocks(const FDownloadDeltaIndex& InIndex, const FString& InBasePath, TArray<int64>& OutBaseOffsets);
+	static bool CopyBlocks(const FDownloadDeltaIndex& InIndex, const FString& InBasePath, const FString& InTargetPath, const TArray<int64>& InBaseOffsets);
+
+private:
+	static void ScanRegion(const FDownloadDeltaIndex& InIndex, const TMap<uint32, TArray<int32>>& InBlockTable, const TArray<uint8>& InData, int64 InRegionOffset, TArray<TPair<int32, int64>>& OutMatches);
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "DownloadHasher.h"
+#include "DownloadDecoder.h"
 #include "DownloadFile.generated.h"
 
 USTRUCT(BlueprintType)
@@ -12,12 +14,44 @@ public:
 		FString Name;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		FString URL;
+	// optional,equivalent URLs of the same content,the ranges are requested from the fastest sources at once.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-		int32 Size;
+		TArray<FString> MirrorURLs;
+	// optional,if given the download is started without the request of file info.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int64 Size = 0;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		FString HASH;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		FString SavePath;
+	// validators of the remote content,filled by the response.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		FString ETag;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		FString LastModified;
+	// optional,verify the file chunk by chunk while downloading,a corrupted chunk is fetched again.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int64 ChunkSize = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		EDownloadHashAlgorithm ChunkHashAlgorithm = EDownloadHashAlgorithm::MD5;
+	// hex digest of every chunk in file order
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		TArray<FString> ChunkHashes;
+	// root of the hash tree of chunks,could be used alone or to check ChunkHashes
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FString MerkleRoot;
+	// optional,block checksum index of the file,the blocks of the old local file are reused(delta download).
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FString DeltaIndexURL;
+	// optional,the old file to reuse,default is the file at SavePath.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FString DeltaBasePath;
+	// optional,the content is decoded while downloading and only the decoded file is saved.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		EDownloadContentEncoding ContentEncoding = EDownloadContentEncoding::None;
+	// HASH is the digest of decoded content instead of the received content
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool bHashDecodedContent = false;
 
 	FORCEINLINE bool operator==(const FDownloadFile& Rhs)
 	{
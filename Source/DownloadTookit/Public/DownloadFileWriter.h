@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadStage.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "DownloadFileWriter.generated.h"
+
+UENUM(BlueprintType)
+enum class EDownloadWriteMode : uint8
+{
+	// IFileHandle,seek to the offset if the write is not contiguous
+	Buffered,
+	// pwrite at the offset without seek
+	Positional,
+	// copy to a mapped window of the preallocated file,the page cache is written back by system.
+	Mapped
+};
+
+/*
+	Write the download content on a worker thread.
+	- own one opened file per download,the file is closed only by Close().
+	- received buffers are coalesced to large aligned writes.
+	- the file is opened and preallocated to InFileSize(if given) on the worker thread,a multi-GB preallocation may take a while.
+		the writer has error if the disk has no enough space,Enqueue() faild and Close() report it.
+	- Positional and Mapped write by the file descriptor on posix platforms,other platforms fall back to Buffered.
+		Mapped fall back to Positional if the file space could not be reserved.
+*/
+class DOWNLOADTOOKIT_API FDownloadFileWriter : public FDownloadStage
+{
+public:
+	FDownloadFileWriter(const FString& InFilePath, int64 InMaxQueuedByte = 0, int32 InWriteBlockSize = 0,
+		EDownloadWriteMode InWriteMode = EDownloadWriteMode::Buffered, int64 InFileSize = 0);
+	virtual ~FDownloadFileWriter();
+
+	const FString& GetFilePath()const { return FilePath; }
+	// the mode decided on worker thread when the file opened,read it after closed
+	EDownloadWriteMode GetWriteMode()const { return WriteMode; }
+
+protected:
+	virtual bool OnStart()override;
+	// open the file(not truncate) and preallocate it
+	virtual bool OnThreadStart()override;
+	virtual void OnBuffer(int64 InOffset, const TArray<uint8>& InData)override;
+	virtual void OnFinish()override;
+	// write out the staging bytes and flush the file handle
+	virtual bool OnBarrier()override;
+
+	void FlushStaging(bool bInForce);
+	bool WriteToHandle(int64 InOffset, const uint8* InData, int64 InLength);
+	bool WritePositional(int64 InOffset, const uint8* InData, int64 InLength);
+	bool WriteMapped(int64 InOffset, const uint8* InData, int64 InLength);
+	bool MapWindow(int64 InOffset);
+	void UnmapWindow();
+	bool HasDiskSpace()const;
+	bool OpenDescriptor();
+	// return false if the disk is full,bOutReserved is false if the file is only extended(sparse).
+	bool Preallocate(bool& bOutReserved);
+	// write the written bytes to disk
+	bool SyncFile();
+	void CloseHandle();
+
+private:
+	FString FilePath;
+	// path for the platform api
+	FString AbsoluteFilePath;
+	int32 WriteBlockSize;
+	EDownloadWriteMode WriteMode;
+	int64 FileSize;
+
+	TUniquePtr<IFileHandle> FileHandle;
+	int64 FilePosition;
+	// Positional and Mapped,-1 if not opened
+	int32 FileDescriptor;
+	uint8* MappedWindow;
+	int64 MappedOffset;
+	int64 MappedLength;
+
+	// contiguous bytes waiting to be written(only access on writer thread)
+	TArray<uint8> Staging;
+	int64 StagingOffset;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadStage.h"
+#include "DownloadHasher.h"
+#include "HAL/CriticalSection.h"
+
+/*
+	Calc the hash of the download content on a worker thread.
+	- consume the same buffers as FDownloadFileWriter,buffers must be enqueued in file order.
+	- several algorithms are calculated in one pass,the digests are valid after the stage closed.
+*/
+class DOWNLOADTOOKIT_API FDownloadHashStage : public FDownloadStage
+{
+public:
+	explicit FDownloadHashStage(const TArray<EDownloadHashAlgorithm>& InAlgorithms);
+	virtual ~FDownloadHashStage();
+
+	// content arrived out of order,hash the file by read back it when closed.
+	void SetReadBackFile(const FString& InFilePath);
+	FString GetDigest(EDownloadHashAlgorithm InAlgorithm)const;
+	const TMap<EDownloadHashAlgorithm, FString>& GetDigests()const { return Digests; }
+	// continue a saved hash,must be called before Start().
+	bool RestoreState(int64 InHashedOffset, const TArray<uint8>& InState);
+	// the hash state saved when last barrier reached
+	void GetBarrierState(int64& OutHashedOffset, TArray<uint8>& OutState)const;
+
+protected:
+	virtual void OnBuffer(int64 InOffset, const TArray<uint8>& InData)override;
+	virtual void OnFinish()override;
+	virtual bool OnBarrier()override;
+
+	bool HashFile(const FString& InFilePath);
+
+private:
+	FDownloadMultiHasher Hasher;
+	FString ReadBackFilePath;
+	int64 HashedOffset;
+	TMap<EDownloadHashAlgorithm, FString> Digests;
+
+	mutable FCriticalSection BarrierStateLock;
+	int64 BarrierHashedOffset;
+	TArray<uint8> BarrierState;
+};
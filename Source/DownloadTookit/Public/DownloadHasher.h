@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+#include "DownloadHasher.generated.h"
+
+UENUM(BlueprintType)
+enum class EDownloadHashAlgorithm : uint8
+{
+	MD5,
+	SHA256,
+	// non-cryptographic,integrity check only
+	XXHash64,
+	CRC32C
+};
+
+/*
+	Streaming hash engine.
+	- Update can be called any times,Final return the lower case hex digest.
+	- after Final the hasher must be Reset before next Update.
+	- SaveState/LoadState keep the incremental state,the state is only valid on the same platform.
+*/
+class DOWNLOADTOOKIT_API IDownloadHasher
+{
+public:
+	virtual ~IDownloadHasher() {}
+
+	virtual EDownloadHashAlgorithm GetAlgorithm()const = 0;
+	virtual void Reset() = 0;
+	virtual void Update(const uint8* InData, int64 InLength) = 0;
+	virtual FString Final() = 0;
+	virtual void SaveState(TArray<uint8>& OutState)const = 0;
+	virtual bool LoadState(const TArray<uint8>& InState) = 0;
+
+	static TUniquePtr<IDownloadHasher> Create(EDownloadHashAlgorithm InAlgorithm);
+	static FString GetAlgorithmName(EDownloadHashAlgorithm InAlgorithm);
+	static bool ParseAlgorithmName(const FString& InName, EDownloadHashAlgorithm& OutAlgorithm);
+	static FString ToHexString(const uint8* InDigest, int32 InLength);
+};
+
+/*
+	Calc several digests in one pass over each buffer,
+	the buffer is fed to all hashers block by block while the block is in cache.
+*/
+class DOWNLOADTOOKIT_API FDownloadMultiHasher
+{
+public:
+	FDownloadMultiHasher() {}
+	explicit FDownloadMultiHasher(const TArray<EDownloadHashAlgorithm>& InAlgorithms);
+
+	void SetAlgorithms(const TArray<EDownloadHashAlgorithm>& InAlgorithms);
+	void Reset();
+	void Update(const uint8* InData, int64 InLength);
+	TMap<EDownloadHashAlgorithm, FString> Final();
+	void SaveState(TArray<uint8>& OutState)const;
+	// the algorithms must be same as the saved hasher
+	bool LoadState(const TArray<uint8>& InState);
+
+	int32 Num()const { return Hashers.Num(); }
+
+private:
+	TArray<TUniquePtr<IDownloadHasher>> Hashers;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadFile.h"
+
+struct FDownloadJournalSegment
+{
+	int64 BeginPosition = 0;
+	int64 EndPosition = 0;
+	int64 ReceivedByte = 0;
+	bool bCompleted = false;
+
+	friend FArchive& operator<<(FArchive& Ar, FDownloadJournalSegment& Segment)
+	{
+		Ar << Segment.BeginPosition << Segment.EndPosition << Segment.ReceivedByte << Segment.bCompleted;
+		return Ar;
+	}
+};
+
+/*
+	Sidecar file(SavePath.journal) of a download,used to resume the download after the app restarted.
+	- saved only after the recorded bytes are flushed to the file.
+	- written to a temp file and moved over the old one,a crash never leave a half written journal.
+*/
+struct DOWNLOADTOOKIT_API FDownloadJournal
+{
+	FString URL;
+	int64 Size = 0;
+	FString ETag;
+	FString LastModified;
+	int64 ChunkSize = 0;
+	TArray<FDownloadJournalSegment> Segments;
+	// incremental hash state of the content [0,HashedOffset)
+	int64 HashedOffset = 0;
+	TArray<uint8> HashState;
+	// digests of the verified chunks
+	TArray<FString> LeafHashes;
+
+	bool Save(const FString& InJournalPath);
+	bool Load(const FString& InJournalPath);
+	// the journal is recorded for the same remote content,the server must provide ETag or Last-Modified.
+	bool IsMatch(const FDownloadFile& InDownloadFile)const;
+
+	static FString GetJournalPath(const FString& InSavePath);
+	static bool Delete(const FString& InSavePath);
+
+private:
+	void Serialize(FArchive& Ar);
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+// project header
+#include "DownloadFile.h"
+#include "DownloadProxy.h"
+#include "DownloadBatch.h"
+#include "DownloadVerifier.h"
+
+// engine header
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "DownloadManager.generated.h"
+
+UENUM(BlueprintType)
+enum class EDownloadPriority : uint8
+{
+	Low,
+	Normal,
+	High,
+	Critical
+};
+
+USTRUCT()
+struct FDownloadTask
+{
+	GENERATED_USTRUCT_BODY()
+public:
+	UPROPERTY()
+		UDownloadProxy* Proxy = nullptr;
+	FDownloadFile DownloadFile;
+	EDownloadPriority Priority = EDownloadPriority::Normal;
+	int32 ConnectionCount = 1;
+	// host:port of the URL,limited by the per host cap
+	FString Host;
+	// enqueue order,tasks of the same priority start in order
+	uint64 Sequence = 0;
+	bool bStarted = false;
+	// paused by a higher priority task,resumed when a slot is free
+	bool bPreempted = false;
+	// completed or canceled,removed by next schedule
+	bool bFinished = false;
+};
+
+/*
+	Own the queue of download tasks.
+	- at most MaxConcurrentDownloads tasks download at once,and at most MaxConcurrentPerHost from one host.
+	- higher priority task start first,a waiting task preempt(pause) a lower priority one when no slot is free.
+	- one shared tick drives all download proxies.
+	- the global rate limit is shared by all download proxies(managed or not).
+	- a batch enqueue the files of a manifest a few at a time,it is kept until completed or canceled.
+	- a verifier hash the local files of a manifest,it is kept until completed or canceled.
+*/
+UCLASS()
+class DOWNLOADTOOKIT_API UDownloadManager : public UEngineSubsystem
+{
+	GENERATED_BODY()
+public:
+	static UDownloadManager* Get();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection)override;
+	virtual void Deinitialize()override;
+
+	// bind the delegates of returned proxy to get the result,the task is removed from queue when completed.
+	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "InConnectionCountOpt"))
+		UDownloadProxy* EnqueueDownload(const FDownloadFile& InDownloadFile, EDownloadPriority InPriority = EDownloadPriority::Normal, int32 InConnectionCountOpt = 1);
+	// download the files of manifest,bind the delegates of returned batch to get the result.
+	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "InConnectionCountOpt"))
+		UDownloadBatch* EnqueueBatch(const TArray<FDownloadFile>& InManifest, EDownloadPriority InPriority = EDownloadPriority::Normal, int32 InConnectionCountOpt = 1);
+	// verify the local files of manifest,bind the delegates of returned verifier to get the files need to download.
+	UFUNCTION(BlueprintCallable)
+		UDownloadVerifier* VerifyFiles(const TArray<FDownloadFile>& InManifest, const FDownloadVerifySettings& InSettings);
+	UFUNCTION(BlueprintCallable)
+		void SetPriority(UDownloadProxy* InProxy, EDownloadPriority InPriority);
+	UFUNCTION(BlueprintCallable)
+		void CancelDownload(UDownloadProxy* InProxy);
+	UFUNCTION(BlueprintCallable)
+		void SetMaxConcurrentDownloads(int32 InMaxCount);
+	UFUNCTION(BlueprintCallable)
+		void SetMaxConcurrentPerHost(int32 InMaxCount);
+	// byte per second of all downloads,0 is unlimited.
+	UFUNCTION(BlueprintCallable)
+		void SetGlobalRateLimit(int64 InBytePerSecond);
+	UFUNCTION(BlueprintCallable)
+		int64 GetGlobalRateLimit()const;
+	// byte of the content addressed store,0 is disabled,a file of known HASH is got from the store if stored.
+	UFUNCTION(BlueprintCallable)
+		void SetContentStoreCapacity(int64 InCapacity);
+	UFUNCTION(BlueprintCallable)
+		int64 GetContentStoreCapacity()const;
+	// metrics of all active downloads
+	UFUNCTION(BlueprintCallable)
+		FDownloadMetrics GetAggregateMetrics()const;
+	UFUNCTION(BlueprintCallable)
+		int32 GetQueuedCount()const;
+	UFUNCTION(BlueprintCallable)
+		int32 GetActiveCount()const;
+
+	// the transfer is ticked by the manager instead of its own ticker
+	void AddTickedTransfer(const TSharedRef<FDownloadTransfer, ESPMode::ThreadSafe>& InTransfer);
+	void RemoveTickedTransfer(const FDownloadTransfer* InTransfer);
+	FDownloadTokenBucket& GetGlobalRateLimiter() { return GlobalRateLimiter; }
+
+protected:
+	bool Tick(float InDeltaTime);
+	// start waiting tasks by priority,preempt lower priority tasks if need.
+	void Schedule();
+	bool IsTaskActive(const FDownloadTask& InTask)const;
+	bool StartTask(FDownloadTask& InTask);
+	bool PreemptTask(const FDownloadTask& InWaitingTask, bool bInSameHost);
+	FDownloadTask* FindTask(UDownloadProxy* InProxy);
+	void RemoveTask(UDownloadProxy* InProxy);
+	void RemoveFinishedTasks();
+
+	UFUNCTION()
+		void OnTaskComplete(UDownloadProxy* InProxy, bool bInSuccess);
+	UFUNCTION()
+		void OnTaskCanceled(UDownloadProxy* InProxy);
+
+private:
+	FDelegateHandle TickDelegateHandle;
+	UPROPERTY()
+		TArray<FDownloadTask> Tasks;
+	TArray<TWeakPtr<FDownloadTransfer, ESPMode::ThreadSafe>> TickedTransfers;
+	UPROPERTY()
+		TArray<UDownloadBatch*> Batches;
+	UPROPERTY()
+		TArray<UDownloadVerifier*> Verifiers;
+	uint64 NextSequence;
+	// proxy may complete while it is started,delay the removal of tasks.
+	bool bScheduling;
+	int32 MaxConcurrentDownloads;
+	int32 MaxConcurrentPerHost;
+	FDownloadTokenBucket GlobalRateLimiter;
+};
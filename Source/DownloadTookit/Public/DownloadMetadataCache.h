@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadHasher.h"
+#include "Containers/Ticker.h"
+
+// validators and digests of a downloaded file
+struct FDownloadMetadata
+{
+	FString URL;
+	FString SavePath;
+	int64 Size = 0;
+	FString ETag;
+	FString LastModified;
+	TMap<EDownloadHashAlgorithm, FString> Digests;
+
+	bool HasValidator()const { return !ETag.IsEmpty() || !LastModified.IsEmpty(); }
+
+	friend FArchive& operator<<(FArchive& Ar, FDownloadMetadata& Metadata);
+};
+
+/*
+	Persistent metadata of downloaded files by URL(Saved/DownloadTookit/MetadataCache.bin),only access on game thread.
+	- a cached file is revalidated by a conditional request,304 means the local file is up to date.
+	- changes are saved to disk in batch after a short delay,Flush() save them immediately.
+*/
+class DOWNLOADTOOKIT_API FDownloadMetadataCache
+{
+public:
+	static FDownloadMetadataCache& Get();
+
+	// null if the URL is not cached
+	const FDownloadMetadata* Find(const FString& InURL);
+	void Add(const FDownloadMetadata& InMetadata);
+	void Remove(const FString& InURL);
+	void Flush();
+
+	static FString GetCachePath();
+
+private:
+	FDownloadMetadataCache();
+
+	void Load();
+	bool Save();
+	void MarkDirty();
+	bool OnSaveTick(float InDeltaTime);
+	void Serialize(FArchive& Ar);
+
+private:
+	TMap<FString, FDownloadMetadata> Entries;
+	bool bLoaded;
+	FDelegateHandle SaveDelegateHandle;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadMetrics.generated.h"
+
+// throughput and latency of a download(or all downloads),measured by wall clock.
+USTRUCT(BlueprintType)
+struct DOWNLOADTOOKIT_API FDownloadMetrics
+{
+	GENERATED_USTRUCT_BODY()
+public:
+	// exponentially weighted moving average of byte/s
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		float BytesPerSecondEWMA = 0.f;
+	// average byte/s in the recent window(5s)
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		float BytesPerSecondWindow = 0.f;
+	// second,-1 is unknown
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		float ETASeconds = -1.f;
+	// second from the download started to the first byte received,-1 is not received
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		float TimeToFirstByte = -1.f;
+	// second from a request sent to its first byte received
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		float LastRequestLatency = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		float AverageRequestLatency = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int32 RequestCount = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int64 ReceivedByte = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int64 TotalByte = 0;
+	// bytes requested again(corrupted chunk,failed request)
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int64 RetriedByte = 0;
+	// count of failed requests retried
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int32 RetryCount = 0;
+	// received bytes that are discarded
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int64 WastedByte = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		float ElapsedSeconds = 0.f;
+	// count of connections,chosen by the auto tuner if enabled
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int32 ConnectionCount = 0;
+	// max byte of one request,chosen by the auto tuner if enabled
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int64 RequestByte = 0;
+};
+
+/*
+	Collect the metrics of a download on game thread.
+	- bytes are accumulated in fixed wall clock intervals,not depend on frame rate or callback batching.
+	- Update() should be called periodically(every tick),rates decay to 0 when no byte received.
+*/
+class DOWNLOADTOOKIT_API FDownloadMetricsTracker
+{
+public:
+	FDownloadMetricsTracker();
+
+	// InReceivedByte is the bytes already on disk(resumed)
+	void Start(int64 InTotalByte, int64 InReceivedByte = 0);
+	void Update();
+	void AddReceivedByte(int64 InByte);
+	void AddRequestLatency(double InLatency);
+	void AddRetriedByte(int64 InByte) { Metrics.RetriedByte += InByte; }
+	void AddRetry() { ++Metrics.RetryCount; }
+	void AddWastedByte(int64 InByte) { Metrics.WastedByte += InByte; }
+	// received bytes are discarded and requested again
+	void RemoveReceivedByte(int64 InByte);
+	// the total is known later(size of a file got from response)
+	void SetTotalByte(int64 InTotalByte) { Metrics.TotalByte = InTotalByte; }
+
+	FDownloadMetrics GetMetrics()const;
+	bool IsStarted()const { return StartTime > 0; }
+
+	// sum of the metrics of several downloads
+	static FDownloadMetrics Aggregate(const TArray<FDownloadMetrics>& InMetrics);
+
+private:
+	struct FSample
+	{
+		double EndTime;
+		double Duration;
+		int64 Byte;
+	};
+
+	FDownloadMetrics Metrics;
+	double StartTime;
+	double TotalLatency;
+	double IntervalStartTime;
+	int64 IntervalByte;
+	TArray<FSample> Samples;
+};
@@ -3,12 +3,9 @@
 #pragma once
 
 // project header
-#include "DownloadFile.h"
-#include "MD5Wrapper.hpp"
+#include "DownloadTransfer.h"
 
 // engine header
-#include "openssl/md5.h"
-#include "Http.h"
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
 #include "DownloadProxy.generated.h"
@@ -21,23 +18,10 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnDownloadPaused, UDownloadProxy*,
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnDownloadCanceled, UDownloadProxy*, Proxy);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnDownloadResumed, UDownloadProxy*, Proxy);
 
-UENUM(BlueprintType)
-enum class EDownloadStatus:uint8
-{
-	NotStarted,
-	Downloading,
-	Paused,
-	Canceled,
-	Failed,
-	Succeeded
-};
-
-struct FDownloadRange
-{
-	uint32 BeginPosition;
-	uint32 EndPosition;
-};
-
+/*
+	Blueprint wrapper of FDownloadTransfer,the delegates of transfer are broadcast with the proxy.
+	- native code could use GetTransfer() or own a FDownloadTransfer without proxy.
+*/
 UCLASS(BlueprintType)
 class DOWNLOADTOOKIT_API UDownloadProxy : public UObject
 {
@@ -52,9 +36,22 @@ public:
 		- bInSliceOpt: enbale slice download(save memory)
 		- InSliceByteSizeOpt: when bInSliceOpt is ture,the option could set a SliceByteSize
 		- bForceOpt: forece cancel downloading mission.
+		- InConnectionCountOpt: count of http connections fetch the file concurrently,
+			greater than 1 is segmented download(file is divided into ranges,every range is written at its own offset).
+	*/
+	UFUNCTION(BlueprintCallable,meta=(AdvancedDisplay="InSavePathOpt,bInSliceOpt,InSliceByteSizeOpt,bInForceOpt,InConnectionCountOpt"))
+		void RequestDownload(const FString& InURL,const FString& InSavePathOpt = TEXT(""),bool bInSliceOpt=false,int32 InSliceByteSizeOpt=0,bool bInForceOpt=false,int32 InConnectionCountOpt=1);
+	/*
+		Request download a file described by InDownloadFile,options are same as RequestDownload.
+		- if ChunkSize and ChunkHashes/MerkleRoot are given,the file is divided by ChunkSize and
+			every chunk is verified as soon as it is received,a corrupted chunk is fetched again.
+		- if ContentEncoding is given,the content is decoded in stream order while downloading,
+			the download could not be resumed after the app restarted.
+		- if DeltaIndexURL is given,the blocks found in the old file are copied and only the others are downloaded,
+			the old file at SavePath is kept as SavePath.base until the download succeeded.
 	*/
-	UFUNCTION(BlueprintCallable,meta=(AdvancedDisplay="InSavePathOpt,bInSliceOpt,InSliceByteSizeOpt,bInForceOpt"))
-		void RequestDownload(const FString& InURL,const FString& InSavePathOpt = TEXT(""),bool bInSliceOpt=false,int32 InSliceByteSizeOpt=0,bool bInForceOpt=false);
+	UFUNCTION(BlueprintCallable,meta=(AdvancedDisplay="bInSliceOpt,InSliceByteSizeOpt,bInForceOpt,InConnectionCountOpt"))
+		void RequestDownloadFile(const FDownloadFile& InDownloadFile,bool bInSliceOpt=false,int32 InSliceByteSizeOpt=0,bool bInForceOpt=false,int32 InConnectionCountOpt=1);
 	UFUNCTION(BlueprintCallable)
 		void Pause();
 	UFUNCTION(BlueprintCallable)
@@ -65,6 +62,7 @@ public:
 	UFUNCTION(BlueprintCallable)
 		void Cancel();
 	// reset all member data to default and clear all delegate(if the download misiion is active,cancel it.)
+	// the settings(hash algorithms,pipeline depth,rate limit,auto tune,retry policy,write mode) are kept.
 	UFUNCTION(BlueprintCallable)
 		void Reset();
 	UFUNCTION(BlueprintCallable)
@@ -73,19 +71,77 @@ public:
 		FDownloadFile GetDownloadedFileInfo()const;
 	UFUNCTION(BlueprintCallable)
 		EDownloadStatus GetDownloadStatus()const;
+	// clamp to MAX_int32,use GetDownloadedSize64 for file larger than 2GB.
 	UFUNCTION(BlueprintCallable)
 		int32 GetDownloadedSize()const;
+	// clamp to MAX_int32,use GetTotalSize64 for file larger than 2GB.
 	UFUNCTION(BlueprintCallable)
 		int32 GetTotalSize()const;
+	UFUNCTION(BlueprintCallable)
+		int64 GetDownloadedSize64()const;
+	UFUNCTION(BlueprintCallable)
+		int64 GetTotalSize64()const;
 	UFUNCTION(BlueprintCallable)
 		float GetDownloadProgress()const;
 	// byte,current frame - recently frame
 	UFUNCTION(BlueprintCallable)
 		int32 GetDownloadSpeed()const;
+	// KB/s in the recent window of wall clock
 	UFUNCTION(BlueprintCallable)
 		float GetDownloadSpeedKbs()const;
+	UFUNCTION(BlueprintCallable)
+		FDownloadMetrics GetMetrics()const;
 	UFUNCTION(BlueprintCallable)
 		bool HashCheck(const FString& InMD5Hash)const;
+	// algorithms calculated in one pass while downloading,default is MD5,the first one is saved to HASH.
+	UFUNCTION(BlueprintCallable)
+		void SetHashAlgorithms(const TArray<EDownloadHashAlgorithm>& InAlgorithms);
+	UFUNCTION(BlueprintCallable)
+		FString GetHashDigest(EDownloadHashAlgorithm InAlgorithm)const;
+	UFUNCTION(BlueprintCallable)
+		TMap<EDownloadHashAlgorithm, FString> GetHashDigests()const;
+	/*
+		Count of requests kept in flight per connection,1 is no pipelining.
+		- the next ranges(of the same segment or next slices) are requested while the current one is streaming,
+			the responses are committed to file in order.
+		- every request in flight hold its content in memory,at most connection count*depth*request size.
+	*/
+	UFUNCTION(BlueprintCallable)
+		void SetPipelineDepth(int32 InDepth);
+	UFUNCTION(BlueprintCallable)
+		int32 GetPipelineDepth()const;
+	// byte per second,0 is unlimited,could be changed while downloading.
+	UFUNCTION(BlueprintCallable)
+		void SetRateLimit(int64 InBytePerSecond);
+	UFUNCTION(BlueprintCallable)
+		int64 GetRateLimit()const;
+	// request size and connection count chosen by the measured network,InConnectionCountOpt is the initial count.
+	UFUNCTION(BlueprintCallable)
+		void SetAutoTuneSettings(const FDownloadAutoTuneSettings& InSettings);
+	UFUNCTION(BlueprintCallable)
+		FDownloadAutoTuneSettings GetAutoTuneSettings()const;
+	// count of requests in flight now
+	UFUNCTION(BlueprintCallable)
+		int32 GetConnectionCount()const;
+	// max byte of one request now
+	UFUNCTION(BlueprintCallable)
+		int64 GetRequestByte()const;
+	// the failed range is requested again instead of failing the download,could be changed while downloading.
+	UFUNCTION(BlueprintCallable)
+		void SetRetryPolicy(const FDownloadRetryPolicy& InPolicy);
+	UFUNCTION(BlueprintCallable)
+		FDownloadRetryPolicy GetRetryPolicy()const;
+	/*
+		How the file is written,set it before RequestDownload.
+		- the file is preallocated to the size when known,the download faild soon after started if the disk has no enough space(checked on the writer thread).
+		- Positional and Mapped write at the offset without seek,the buffered one is used if not supported by platform.
+	*/
+	UFUNCTION(BlueprintCallable)
+		void SetWriteMode(EDownloadWriteMode InWriteMode);
+	UFUNCTION(BlueprintCallable)
+		EDownloadWriteMode GetWriteMode()const;
+
+	TSharedRef<FDownloadTransfer, ESPMode::ThreadSafe> GetTransfer()const { return Transfer.ToSharedRef(); }
 
 public:
 	UPROPERTY(BlueprintAssignable)
@@ -98,29 +154,12 @@ public:
 		FOnDownloadResumed OnDownloadResumedDyMultiDlg;
 
 protected:
-	// download file
-	void PreDownloadRequest();
-	bool DoDownloadRequest(const FDownloadFile& InDownloadFile, const FDownloadRange& InRange);
-	void OnDownloadProcess(FHttpRequestPtr RequestPtr, int32 byteSent, int32 byteReceive);
-	void OnDownloadComplete(FHttpRequestPtr RequestPtr, FHttpResponsePtr ResponsePtr, bool bConnectedSuccessfully);
-	// void OnDownloadHeaderReceived(FHttpRequestPtr RequestPtr, const FString& InHeaderName, const FString& InNewHeaderValue);
-	// request head get the file size
-	void PreRequestHeadInfo(const FDownloadFile& InDownloadFile, bool bAutoDownload=true);
-	void OnRequestHeadHeaderReceived(FHttpRequestPtr RequestPtr, const FString& InHeaderName, const FString& InNewHeaderValue);
-	void OnRequestHeadComplete(FHttpRequestPtr RequestPtr, FHttpResponsePtr ResponsePtr, bool bConnectedSuccessfully, bool bAutoDownload);
+	void OnTransferComplete(bool bSuccess);
+	void OnTransferPaused();
+	void OnTransferCanceled();
+	void OnTransferResumed();
+	void ClearDelegates();
 
 private:
-	FDelegateHandle TickDelegateHandle;
-	TSharedPtr<IHttpRequest,ESPMode::ThreadSafe> HttpRequest;
-	FDownloadFile PassInDownloadFileInfo;
-	FDownloadFile InternalDownloadFileInfo;
-	EDownloadStatus Status;
-	int32 TotalDownloadedByte;
-	int32 LastRequestedTotalByte;
-	int32 DownloadSpeed;
-	float DeltaTime;
-	FMD5Wrapper Md5Proxy;
-	bool bUseSlice;
-	uint32 SliceCount;
-	int32 SliceByteSize;
+	TSharedPtr<FDownloadTransfer, ESPMode::ThreadSafe> Transfer;
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DownloadRetryPolicy.generated.h"
+
+/*
+	Retry of a failed range request,the committed bytes and hash state are kept.
+	- the range is requested again after an exponential backoff with jitter,
+		the delay of Retry-After response header is used if given.
+	- only the connection errors(a truncated range too) and the retryable response codes are retried,others fail the download.
+*/
+USTRUCT(BlueprintType)
+struct DOWNLOADTOOKIT_API FDownloadRetryPolicy
+{
+	GENERATED_USTRUCT_BODY()
+public:
+	// retry count of a range in a row,0 is no retry.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int32 MaxRetryCount = 5;
+	// retry count of the whole download,0 is unlimited.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int32 RetryBudget = 50;
+	// second
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		float InitialDelaySeconds = 1.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		float MaxDelaySeconds = 30.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		float BackoffMultiplier = 2.f;
+	// the delay is reduced randomly by this ratio,the connections failed together are not retried together.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		float JitterRatio = 0.5f;
+	// timeout,connection reset,DNS failure
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool bRetryConnectionError = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		TArray<int32> RetryableResponseCodes = { 408, 429, 500, 502, 503, 504 };
+
+	// InResponseCode is 0 if no response
+	bool IsRetryable(int32 InResponseCode, bool bInConnected)const;
+	// second before the InRetryCount(from 1) retry
+	float GetRetryDelay(int32 InRetryCount)const;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// an equivalent URL of the file,measured by its completed requests.
+struct FDownloadSource
+{
+	FString URL;
+	// validators of the first response,a changed one means the content is changed.
+	FString ETag;
+	FString LastModified;
+	// exponentially weighted moving average of completed requests
+	double BytesPerSecond = 0;
+	int32 SampleCount = 0;
+	int32 ErrorCount = 0;
+	int32 ConsecutiveErrorCount = 0;
+	int32 ActiveRequestCount = 0;
+	bool bExcluded = false;
+};
+
+/*
+	Choose the source(URL or mirror) of every range request.
+	- every source is tried once,then the requests go to the source of highest score.
+	- score is the measured throughput shared by the requests in flight,weighted by the success rate.
+	- a source is excluded after several errors in a row,or a response of other content(size or validator).
+*/
+class DOWNLOADTOOKIT_API FDownloadSourceSelector
+{
+public:
+	void Reset(const FString& InURL, const TArray<FString>& InMirrorURLs);
+
+	int32 Num()const { return Sources.Num(); }
+	const FDownloadSource& GetSource(int32 InSourceIndex)const { return Sources[InSourceIndex]; }
+	bool HasAvailableSource()const;
+	// INDEX_NONE if all sources are excluded
+	int32 Pick()const;
+
+	void OnRequestStarted(int32 InSourceIndex);
+	void OnRequestCompleted(int32 InSourceIndex, int64 InByte, double InSeconds);
+	void OnRequestFailed(int32 InSourceIndex);
+	// the request is canceled or its result is not measured
+	void OnRequestFinished(int32 InSourceIndex);
+	void Exclude(int32 InSourceIndex, const TCHAR* InReason);
+	// keep the validators of first response,return false if they are changed.
+	bool UpdateValidators(int32 InSourceIndex, const FString& InETag, const FString& InLastModified);
+
+protected:
+	double GetScore(const FDownloadSource& InSource)const;
+
+private:
+	TArray<FDownloadSource> Sources;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Containers/Queue.h"
+#include "Templates/SharedPointer.h"
+
+// received content,shared by all stages of the download pipeline.
+typedef TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> FDownloadBufferPtr;
+
+/*
+	A stage of the download pipeline(write file,calc hash...),runs on its own worker thread.
+	- buffers are consumed in enqueue order.
+	- the queue is bounded by byte,game thread should check IsQueueFull() before hand over buffer.
+	- Close() consume all queued buffers and finish the stage,the callback is called on game thread.
+	- Barrier() callback is called on game thread after all buffers enqueued before it are consumed.
+*/
+class DOWNLOADTOOKIT_API FDownloadStage : public FRunnable
+{
+public:
+	FDownloadStage(const TCHAR* InThreadName, int64 InMaxQueuedByte = 0);
+	virtual ~FDownloadStage();
+
+	bool Start();
+	bool Enqueue(int64 InOffset, const FDownloadBufferPtr& InData);
+	void Close(TFunction<void(bool)> InOnClosed = nullptr);
+	bool Barrier(TFunction<void(bool)> InOnReached);
+
+	bool IsQueueFull()const;
+	bool HasError()const { return bHasError; }
+	int64 GetQueuedByte()const { return QueuedByte.GetValue(); }
+
+	// FRunnable
+	virtual uint32 Run()override;
+	virtual void Stop()override;
+
+protected:
+	// called on the caller thread of Start()
+	virtual bool OnStart() { return true; }
+	// called on worker thread before the first command,the stage has error if false(queued buffers are dropped).
+	virtual bool OnThreadStart() { return true; }
+	// called on worker thread in enqueue order
+	virtual void OnBuffer(int64 InOffset, const TArray<uint8>& InData) = 0;
+	// called on worker thread after all buffers consumed(closed or stopped)
+	virtual void OnFinish() {}
+	// called on worker thread when a barrier is reached
+	virtual bool OnBarrier() { return true; }
+
+	void SetError() { bHasError = true; }
+	bool IsStopping()const { return bStopping; }
+	// derived class must stop the thread in its destructor,before its members are destroyed.
+	void StopThread();
+
+private:
+	void ProcessQueue();
+
+	struct FStageCommand
+	{
+		int64 Offset;
+		FDownloadBufferPtr Data;
+		// barrier if Data is null
+		TFunction<void(bool)> OnReached;
+	};
+
+	FString ThreadName;
+	int64 MaxQueuedByte;
+	FRunnableThread* Thread;
+	FEvent* WakeupEvent;
+	TQueue<FStageCommand, EQueueMode::Spsc> Queue;
+	FThreadSafeCounter64 QueuedByte;
+	FThreadSafeBool bStopping;
+	FThreadSafeBool bCloseRequested;
+	FThreadSafeBool bHasError;
+	TFunction<void(bool)> OnClosed;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+	Limit the byte rate by a token bucket(only access on game thread).
+	- tokens are refilled at ByteRate per second,at most BurstByte tokens are saved.
+	- a request could overdraw the bucket,next request wait until the debt is paid.
+*/
+class DOWNLOADTOOKIT_API FDownloadTokenBucket
+{
+public:
+	FDownloadTokenBucket(int64 InByteRate = 0, int64 InBurstByte = 0);
+
+	// 0 is unlimited,burst is one second of the rate by default.
+	void SetByteRate(int64 InByteRate, int64 InBurstByte = 0);
+	int64 GetByteRate()const { return ByteRate; }
+	bool IsLimited()const { return ByteRate > 0; }
+
+	bool CanConsume();
+	void Consume(int64 InByte);
+	// max byte of one request,the requests are paced by small ranges.
+	int64 GetPacingByte()const;
+
+protected:
+	void Refill();
+
+private:
+	int64 ByteRate;
+	int64 BurstByte;
+	double Tokens;
+	double LastRefillTime;
+};
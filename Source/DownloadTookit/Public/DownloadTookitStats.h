@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// engine header
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+/*
+	Profile the download path.
+	- stat DownloadTookit show the cycle counters of every stage and the memory held by the pipeline.
+	- the cycle counters are declared in the source file of the stage,the memory counters are shared by all downloads.
+	- DOWNLOADTOOKIT_WITH_TRACE(0 in shipping by default) compile the trace events in,otherwise they are compiled out entirely.
+		scopes are named events of the cpu timeline(Insights,Razor,PIX...),
+		events are markers of the csv profile(csvprofile start/stop) from any thread.
+*/
+DECLARE_STATS_GROUP(TEXT("DownloadTookit"), STATGROUP_DownloadTookit, STATCAT_Advanced);
+
+// buffers kept by the buffer pools
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Pooled Buffer Memory"), STAT_DownloadPooledMemory, STATGROUP_DownloadTookit, DOWNLOADTOOKIT_API);
+// buffers queued in the pipeline stages,not consumed yet.
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Queued Stage Memory"), STAT_DownloadQueuedMemory, STATGROUP_DownloadTookit, DOWNLOADTOOKIT_API);
+
+#ifndef DOWNLOADTOOKIT_WITH_TRACE
+	#define DOWNLOADTOOKIT_WITH_TRACE 0
+#endif
+
+#if DOWNLOADTOOKIT_WITH_TRACE
+	#define DOWNLOAD_TRACE_SCOPE(Name) SCOPED_NAMED_EVENT_TEXT(Name, FColor::Emerald)
+	#define DOWNLOAD_TRACE_EVENT(Format, ...) CSV_EVENT_GLOBAL(Format, ##__VA_ARGS__)
+#else
+	#define DOWNLOAD_TRACE_SCOPE(Name)
+	#define DOWNLOAD_TRACE_EVENT(Format, ...)
+#endif
@@ -0,0 +1,341 @@
+#pragma once
+
+// project header
+#include "DownloadFile.h"
+#include "DownloadFileWriter.h"
+#include "DownloadHashStage.h"
+#include "DownloadDecodeStage.h"
+#include "DownloadChunkVerifier.h"
+#include "DownloadJournal.h"
+#include "DownloadTokenBucket.h"
+#include "DownloadMetrics.h"
+#include "DownloadBufferPool.h"
+#include "DownloadAutoTuner.h"
+#include "DownloadMetadataCache.h"
+#include "DownloadDelta.h"
+#include "DownloadContentStore.h"
+#include "DownloadSourceSelector.h"
+#include "DownloadRetryPolicy.h"
+
+// engine header
+#include "Http.h"
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "Templates/Atomic.h"
+#include "Templates/SharedPointer.h"
+#include "DownloadTransfer.generated.h"
+
+class FDownloadTransfer;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnDownloadTransferComplete, bool /*bSuccess*/);
+DECLARE_MULTICAST_DELEGATE(FOnDownloadTransferPaused);
+DECLARE_MULTICAST_DELEGATE(FOnDownloadTransferCanceled);
+DECLARE_MULTICAST_DELEGATE(FOnDownloadTransferResumed);
+
+UENUM(BlueprintType)
+enum class EDownloadStatus:uint8
+{
+	NotStarted,
+	Downloading,
+	Paused,
+	Canceled,
+	Failed,
+	Succeeded
+};
+
+struct FDownloadRange
+{
+	int64 BeginPosition;
+	int64 EndPosition;
+};
+
+// a bounded range request of segment
+struct FDownloadSegmentRequest
+{
+	// null after completed
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> Request;
+	// relative to Range.BeginPosition of segment
+	int64 Offset = 0;
+	int64 Length = 0;
+	// platform seconds when the request sent
+	double StartTime = 0;
+	// index of the source in FDownloadSourceSelector
+	int32 SourceIndex = 0;
+	bool bFirstByte = false;
+	// byte count of the response reported by progress,the content is consumed when completed.
+	int64 ResponseReceivedByte = 0;
+	// received content,waiting for the previous requests committed.
+	FDownloadBufferPtr Content;
+};
+
+// a part of file,fetched by its own http requests and written at its own offset.
+struct FDownloadSegment
+{
+	FDownloadRange Range;
+	// requests in flight or waiting for commit,in offset order.
+	TArray<FDownloadSegmentRequest> Requests;
+	// byte count of the segment already requested
+	int64 RequestedByte = 0;
+	// byte count of the segment already written to file
+	int64 ReceivedByte = 0;
+	bool bVerifying = false;
+	int32 RetryCount = 0;
+	// failed requests in a row,and the platform seconds to request again.
+	int32 RequestRetryCount = 0;
+	double RetryTime = 0;
+	bool bCompleted = false;
+
+	FORCEINLINE int64 GetLength()const { return Range.EndPosition - Range.BeginPosition + 1; }
+};
+
+// journal of a moment,saved after all stages reached the barrier.
+struct FDownloadJournalSnapshot
+{
+	FDownloadJournal Journal;
+	int32 PendingBarrier = 0;
+	bool bBarrierFaild = false;
+};
+
+// progress of the transfer,could be read from any thread.
+struct FDownloadTransferSnapshot
+{
+	EDownloadStatus Status = EDownloadStatus::NotStarted;
+	int64 DownloadedByte = 0;
+	// 0 if the size is not known yet
+	int64 TotalByte = 0;
+	// byte of the last frame
+	int64 DownloadSpeed = 0;
+};
+
+/*
+	The download of one file without UObject,UDownloadProxy is a blueprint wrapper of it.
+	- create it by MakeShared<FDownloadTransfer, ESPMode::ThreadSafe>(),it could be created and kept by any thread.
+	- the http requests,stages and callbacks run on game thread,the commands called from other threads are
+		queued to game thread(Resume/ReDownload return true when queued),the getters except GetSnapshot/GetDownloadStatus/
+		GetDownloadedSize64/GetTotalSize64 should be called on game thread.
+	- the native delegates are broadcast on game thread and kept by Reset.
+	- release the last reference on game thread if it is downloading,the requests are canceled by the destructor.
+*/
+class DOWNLOADTOOKIT_API FDownloadTransfer : public TSharedFromThis<FDownloadTransfer, ESPMode::ThreadSafe>
+{
+public:
+	FDownloadTransfer();
+	~FDownloadTransfer();
+
+	// same as UDownloadProxy::RequestDownload
+	void RequestDownload(const FString& InURL, const FString& InSavePathOpt = TEXT(""), bool bInSliceOpt = false, int32 InSliceByteSizeOpt = 0, bool bInForceOpt = false, int32 InConnectionCountOpt = 1);
+	void RequestDownloadFile(const FDownloadFile& InDownloadFile, bool bInSliceOpt = false, int32 InSliceByteSizeOpt = 0, bool bInForceOpt = false, int32 InConnectionCountOpt = 1);
+	void Pause();
+	bool Resume();
+	bool ReDownload();
+	// just cancel download misiion,but dont clean member data.
+	void Cancel();
+	// reset all member data to default(if the download misiion is active,cancel it.)
+	// the settings(hash algorithms,pipeline depth,rate limit,auto tune,retry policy,write mode) are kept.
+	void Reset();
+	bool Tick(float delta);
+	FDownloadTransferSnapshot GetSnapshot()const;
+	FDownloadFile GetDownloadedFileInfo()const;
+	EDownloadStatus GetDownloadStatus()const;
+	int64 GetDownloadedSize64()const;
+	int64 GetTotalSize64()const;
+	float GetDownloadProgress()const;
+	// byte,current frame - recently frame
+	int64 GetDownloadSpeed()const;
+	// KB/s in the recent window of wall clock
+	float GetDownloadSpeedKbs()const;
+	FDownloadMetrics GetMetrics()const;
+	bool HashCheck(const FString& InMD5Hash)const;
+	void SetHashAlgorithms(const TArray<EDownloadHashAlgorithm>& InAlgorithms);
+	FString GetHashDigest(EDownloadHashAlgorithm InAlgorithm)const;
+	TMap<EDownloadHashAlgorithm, FString> GetHashDigests()const;
+	void SetPipelineDepth(int32 InDepth);
+	int32 GetPipelineDepth()const;
+	void SetRateLimit(int64 InBytePerSecond);
+	int64 GetRateLimit()const;
+	void SetAutoTuneSettings(const FDownloadAutoTuneSettings& InSettings);
+	FDownloadAutoTuneSettings GetAutoTuneSettings()const;
+	int32 GetConnectionCount()const;
+	int64 GetRequestByte()const;
+	void SetRetryPolicy(const FDownloadRetryPolicy& InPolicy);
+	FDownloadRetryPolicy GetRetryPolicy()const;
+	void SetWriteMode(EDownloadWriteMode InWriteMode);
+	EDownloadWriteMode GetWriteMode()const;
+
+public:
+	FOnDownloadTransferComplete OnDownloadCompleteMultiDlg;
+	FOnDownloadTransferPaused OnDownloadPausedMultiDlg;
+	FOnDownloadTransferCanceled OnDownloadCanceledMultiDlg;
+	FOnDownloadTransferResumed OnDownloadResumedMultiDlg;
+
+protected:
+	// download file
+	void PreDownloadRequest();
+	// InMaxRequestByte limit the range of request,0 is the default bounded request size.
+	bool DoDownloadRequest(const FDownloadFile& InDownloadFile, FDownloadSegment& InSegment, int64 InMaxRequestByte = 0);
+	// divide the file to segments,slice size or file size/connection count.
+	void BuildSegments();
+	int64 GetSegmentSize()const;
+	// add the segments of range [InBeginPosition,InEndPosition]
+	void AddSegments(int64 InBeginPosition, int64 InEndPosition);
+	// the file is divided for the max connection count,the auto tuner may increase the count later.
+	int32 GetMaxConnectionCount()const;
+	// keep ConnectionCount segments in flight,return false if request faild.
+	bool RequestPendingSegments();
+	FDownloadSegment* FindSegment(FHttpRequestPtr RequestPtr, int32& OutRequestIndex);
+	bool HasActiveRequest()const;
+	void CancelAllRequest();
+	// cancel the request and the later ones of segment,the segment is requested again from the request offset.
+	void DropSegmentRequests(FDownloadSegment& InSegment, int32 InRequestIndex);
+	// the response of range request is larger than the range,use other sources or request the whole file.
+	void OnRangeIgnored(FDownloadSegment& InSegment, int32 InRequestIndex);
+	// restart the segments as one request without Range,return false if faild.
+	bool RequestWholeFile();
+	// the whole content responsed for If-Range of other content
+	bool IsIfRangeChanged(int32 InSourceIndex, FHttpResponsePtr ResponsePtr)const;
+	// request the range again after the backoff,return false if the retry budget is used up.
+	bool RetrySegmentRequest(FDownloadSegment& InSegment, int32 InRequestIndex, FHttpResponsePtr ResponsePtr);
+	// a segment is waiting for the backoff
+	bool HasPendingRetry()const;
+	bool IsAllSegmentsCompleted()const;
+	// request pending segments,or finish the download if all segments are completed.
+	void ContinueDownload();
+	// create the chunk verifier if chunk hashes are given,return false if they are invalid.
+	bool OpenChunkVerifier();
+	void VerifySegment(int32 InSegmentIndex);
+	void OnChunkVerified(int32 InSegmentIndex, bool bVerified);
+	// hash the content with the stream,or read back the file when all content received.
+	bool IsStreamHash()const;
+	// the content is decoded before written,committed in stream order.
+	bool IsDecoding()const;
+	bool IsRateLimited()const;
+	// return false if the transfer or global rate limit is reached,OutMaxRequestByte is the paced request size.
+	bool AcquireRateLimit(int64& OutMaxRequestByte);
+	void ConsumeRateLimit(int64 InByte);
+	// record the segments progress,the journal is saved after the bytes flushed to file.
+	void SaveJournal();
+	void OnJournalBarrierReached(TSharedPtr<FDownloadJournalSnapshot> InSnapshot, bool bReached);
+	// restore the segments and hash state from the journal of last run
+	bool RestoreJournal(FDownloadJournal& OutJournal);
+	// the pipeline stages are busy,new request wait until the queued buffers consumed.
+	bool IsStageBusy()const;
+	// keep the completed response content of the segment request,return false if it is not the requested range.
+	bool ReceiveSegmentRequest(FDownloadSegmentRequest& InRequest, FHttpResponsePtr ResponsePtr);
+	// hand over the received contents to stages in file order,return false if the writer faild.
+	bool CommitSegmentRequests();
+	bool OpenFileWriter();
+	// flush and close the file writer,InOnClosed is called on game thread when file handle closed.
+	void CloseFileWriter(TFunction<void(bool)> InOnClosed = nullptr);
+	void FinishDownload(bool bSuccessd);
+	void OnFileWriterClosed(bool bWriteSuccessd);
+	void OnHashStageClosed(bool bHashSuccessd);
+	void StartTicker();
+	void StopTicker();
+	void OnDownloadProcess(FHttpRequestPtr RequestPtr, int32 byteSent, int32 byteReceive);
+	void OnDownloadComplete(FHttpRequestPtr RequestPtr, FHttpResponsePtr ResponsePtr, bool bConnectedSuccessfully);
+	// void OnDownloadHeaderReceived(FHttpRequestPtr RequestPtr, const FString& InHeaderName, const FString& InNewHeaderValue);
+	/*
+		Get the file size and validators,then start download.
+		- skipped if the size is given,the validators are got from the first response.
+		- the first range is requested by GET instead of HEAD,the size is got from Content-Range.
+		- a cached file is revalidated by If-None-Match/If-Modified-Since,304 complete the download immediately.
+		- the server ignored Range is detected by the progress,the probe is canceled and the info is got by HEAD,
+			then the file is downloaded by one request without Range(held in memory until completed,not resumable).
+	*/
+	void PreRequestFileInfo(const FDownloadFile& InDownloadFile, bool bInRevalidate = true);
+	void RequestFileInfo(bool bInRevalidate, bool bInHead = false);
+	// cancel the probe if more than the requested range is received
+	void OnRequestFileInfoProcess(FHttpRequestPtr RequestPtr, int32 byteSent, int32 byteReceive, int64 InRequestByte, bool bInRevalidate);
+	// link the stored file of expected HASH to SavePath,return false if it is not stored.
+	bool FetchFromContentStore(bool bInRevalidate);
+	void OnContentStoreFetched(bool bFetched, int64 InSize, bool bInRevalidate);
+	void OnRequestFileInfoComplete(FHttpRequestPtr RequestPtr, FHttpResponsePtr ResponsePtr, bool bConnectedSuccessfully);
+	// the cached metadata if the local file is completed and could be revalidated
+	const FDownloadMetadata* FindRevalidateMetadata();
+	void OnRevalidated(const FDownloadMetadata& InMetadata);
+	// restore or build the segments and start download,InHeadContent is the first range got with the file info.
+	void StartDownload(FDownloadBufferPtr InHeadContent);
+	// start the stages of the built segments,return false if any of them faild.
+	bool OpenDownload();
+	// the delta index is given and the old file exists
+	bool CanDeltaDownload()const;
+	FString GetDeltaBasePath()const;
+	void RequestDeltaIndex();
+	void OnDeltaIndexComplete(FHttpRequestPtr RequestPtr, FHttpResponsePtr ResponsePtr, bool bConnectedSuccessfully);
+	// the found blocks are copied to the file,download the others.
+	void OnDeltaPrepared(const TArray<int64>& InBaseOffsets, bool bPrepared);
+	// download the whole file if the delta download is not possible
+	void StartFullDownload();
+	// keep the validators of first response
+	void UpdateValidators(FHttpResponsePtr ResponsePtr);
+	// the validator sent by If-Range,a changed remote content is responsed whole instead of the range.
+	FString GetIfRangeValidator()const;
+	// the validator of source,the mirrors may not share the validators of URL.
+	FString GetIfRangeValidator(int32 InSourceIndex)const;
+	void UpdateMetadataCache();
+
+private:
+	// queue the command to game thread if called from other thread,return true if queued.
+	bool DeferToGameThread(TFunction<void(FDownloadTransfer&)> InCommand);
+	// member data except the settings to default,the requests and writer should be closed.
+	void ResetState();
+	// requested but the segments are not built yet
+	bool IsPreparing()const;
+	// cancel the file info request and ignore the delta scan and content store link in flight
+	void CancelPreparing();
+
+private:
+	FDelegateHandle TickDelegateHandle;
+	// request of the file info
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HeadRequest;
+	// ticked by the shared tick of UDownloadManager
+	bool bTickByManager;
+	TArray<FDownloadSegment> Segments;
+	TSharedPtr<FDownloadFileWriter, ESPMode::ThreadSafe> FileWriter;
+	// feed the file writer(and the hash stage if decoded content is hashed) if decoding
+	TSharedPtr<FDownloadDecodeStage, ESPMode::ThreadSafe> DecodeStage;
+	FDownloadFile PassInDownloadFileInfo;
+	FDownloadFile InternalDownloadFileInfo;
+	// written on game thread,read by the snapshot from any thread.
+	TAtomic<EDownloadStatus> Status;
+	TAtomic<int64> TotalDownloadedByte;
+	// InternalDownloadFileInfo.Size
+	TAtomic<int64> TotalByte;
+	TAtomic<int64> DownloadSpeed;
+	int64 ReceivedByteInFrame;
+	float DeltaTime;
+	TSharedPtr<FDownloadHashStage, ESPMode::ThreadSafe> HashStage;
+	TArray<EDownloadHashAlgorithm> HashAlgorithms;
+	TSharedPtr<FDownloadChunkVerifier, ESPMode::ThreadSafe> ChunkVerifier;
+	// the content is not hashed in stream order(chunk fetched again or resumed without hash state),
+	// the hash stage read back the file when closed.
+	bool bHashReadBack;
+	// file offset of the next content hashed with the stream
+	int64 StreamHashOffset;
+	// journal waiting for the writer flush
+	TSharedPtr<FDownloadJournalSnapshot> PendingJournal;
+	float JournalElapsedTime;
+	FDownloadTokenBucket RateLimiter;
+	FDownloadMetricsTracker Metrics;
+	FDownloadBufferPool BufferPool;
+	FDownloadAutoTuneSettings AutoTuneSettings;
+	FDownloadAutoTuner AutoTuner;
+	// URL and mirrors of the file
+	FDownloadSourceSelector Sources;
+	FDownloadRetryPolicy RetryPolicy;
+	// retry count of the download,limited by RetryBudget.
+	int32 TotalRetryCount;
+	// index of delta download,the old file is scanning while valid.
+	TSharedPtr<FDownloadDeltaIndex, ESPMode::ThreadSafe> DeltaIndex;
+	// the server of URL ignored Range,the file is requested whole by one request.
+	bool bRangeIgnored;
+	// increased by every request,the result of async work for an old request is ignored.
+	uint32 RequestSerial;
+	TMap<EDownloadHashAlgorithm, FString> HashDigests;
+	bool bUseSlice;
+	uint32 SliceCount;
+	int64 SliceByteSize;
+	int32 ConnectionCount;
+	int32 PipelineDepth;
+	EDownloadWriteMode WriteMode;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+// project header
+#include "DownloadFile.h"
+#include "DownloadHasher.h"
+
+// engine header
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "DownloadVerifier.generated.h"
+
+class UDownloadVerifier;
+
+UENUM(BlueprintType)
+enum class EDownloadVerifyStatus : uint8
+{
+	Pending,
+	Matched,
+	// the file not exist at SavePath
+	Missing,
+	// checked before hashing,the file is not read.
+	SizeMismatched,
+	HashMismatched,
+	// without HASH the file could not be trusted
+	Unverifiable,
+	ReadFailed,
+	Canceled
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnDownloadFileVerified, UDownloadVerifier*, Verifier, const FDownloadFile&, File, EDownloadVerifyStatus, Status);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnDownloadVerifyComplete, UDownloadVerifier*, Verifier, const TArray<FDownloadFile>&, FilesToDownload);
+
+USTRUCT(BlueprintType)
+struct DOWNLOADTOOKIT_API FDownloadVerifySettings
+{
+	GENERATED_USTRUCT_BODY()
+public:
+	// files hashed at once,0 is the core count.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int32 MaxThreadCount = 0;
+	// byte of every sequential read(or hashed from the mapped region at once),the progress is reported by it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int32 ReadBufferSize = 1024 * 1024 * 4;
+	// hash the mapped file without copy,the file is read if the platform not support mapping.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool bMemoryMapped = false;
+	// algorithm of the HASH in manifest
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		EDownloadHashAlgorithm HashAlgorithm = EDownloadHashAlgorithm::MD5;
+};
+
+/*
+	Verify the local files of a manifest,find the files need to download.
+	- the files are hashed on dedicated threads in parallel,the largest first,a file is hashed by one thread.
+	- a missing file or a file of other Size is not read.
+	- the progress is updated by every read,OnFileVerifiedDyMultiDlg report every file on game thread.
+	- OnVerifyCompleteDyMultiDlg report the files not matched,they could be passed to UDownloadManager::EnqueueBatch.
+*/
+UCLASS(BlueprintType)
+class DOWNLOADTOOKIT_API UDownloadVerifier : public UObject
+{
+	GENERATED_BODY()
+public:
+	UDownloadVerifier();
+
+	// called by UDownloadManager::VerifyFiles
+	void Start(const TArray<FDownloadFile>& InManifest, const FDownloadVerifySettings& InSettings);
+
+	// the hashing files are stopped,the complete delegate is not broadcast.
+	UFUNCTION(BlueprintCallable)
+		void Cancel();
+	UFUNCTION(BlueprintCallable)
+		bool IsVerifying()const;
+	UFUNCTION(BlueprintCallable)
+		float GetProgress()const;
+	UFUNCTION(BlueprintCallable)
+		int64 GetVerifiedSize64()const;
+	UFUNCTION(BlueprintCallable)
+		int64 GetTotalSize64()const;
+	UFUNCTION(BlueprintCallable)
+		int32 GetFileCount()const;
+	UFUNCTION(BlueprintCallable)
+		int32 GetVerifiedFileCount()const;
+	UFUNCTION(BlueprintCallable)
+		EDownloadVerifyStatus GetFileStatus(int32 InFileIndex)const;
+	// the files not matched,valid after completed.
+	UFUNCTION(BlueprintCallable)
+		TArray<FDownloadFile> GetFilesToDownload()const;
+
+	// hash a file on the caller thread,InOnRead is called with the byte of every read,return false to stop.
+	static EDownloadVerifyStatus VerifyFile(const FDownloadFile& InDownloadFile, const FDownloadVerifySettings& InSettings, TFunctionRef<bool(int64)> InOnRead);
+
+public:
+	UPROPERTY(BlueprintAssignable)
+		FOnDownloadFileVerified OnFileVerifiedDyMultiDlg;
+	UPROPERTY(BlueprintAssignable)
+		FOnDownloadVerifyComplete OnVerifyCompleteDyMultiDlg;
+
+protected:
+	// state shared with the threads,it outlive the verifier.
+	struct FVerifyJob
+	{
+		TArray<FDownloadFile> Files;
+		// file indices in hash order
+		TArray<int32> Order;
+		FDownloadVerifySettings Settings;
+		FThreadSafeCounter NextOrder;
+		FThreadSafeCounter RunningThreadCount;
+		FThreadSafeCounter64 VerifiedByte;
+		FThreadSafeCounter64 TotalByte;
+		FThreadSafeBool bCanceled;
+	};
+
+	static void RunJob(TSharedPtr<FVerifyJob, ESPMode::ThreadSafe> InJob, TWeakObjectPtr<UDownloadVerifier> InVerifier);
+	// false if the read is failed or stopped
+	static bool HashFile(IDownloadHasher& InHasher, const FString& InFilePath, int64 InFileSize, const FDownloadVerifySettings& InSettings, TFunctionRef<bool(int64)> InOnRead);
+	void OnFileVerified(int32 InFileIndex, EDownloadVerifyStatus InStatus);
+	void OnJobCompleted();
+
+private:
+	TSharedPtr<FVerifyJob, ESPMode::ThreadSafe> Job;
+	TArray<EDownloadVerifyStatus> Statuses;
+	int32 VerifiedFileCount;
+	bool bVerifying;
+};
@@ -1,11 +1,11 @@
 #pragma once
 #include "openssl/md5.h"
 #include <cstring>
-#include <cstdio>
 #pragma warning(disable:4996)
 struct FMD5Wrapper
 {
 	FMD5Wrapper()
+		: bFinaled(false)
 	{
 		std::memset(md5string,0,sizeof(md5string));
 		MD5_Init(&Md5CTX);
@@ -20,8 +20,14 @@ struct FMD5Wrapper
 	{
 		unsigned char Digest[16] = { 0 };
 		MD5_Final(Digest, &Md5CTX);
+		static const char HexChars[] = "0123456789abcdef";
 		for (int i = 0; i < 16; ++i)
-			std::sprintf(&md5string[i * 2], "%02x", (unsigned int)Digest[i]);
+		{
+			md5string[i * 2] = HexChars[Digest[i] >> 4];
+			md5string[i * 2 + 1] = HexChars[Digest[i] & 0x0F];
+		}
+		md5string[32] = '\0';
+		bFinaled = true;
 		return md5string;
 	}
 
@@ -0,0 +1,116 @@
+#include "DownloadHashBenchmarkCommandlet.h"
+
+// engine header
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Math/RandomStream.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDownloadHashBenchmark, Log, All);
+
+#define BENCHMARK_TOTAL_MB 512
+#define BENCHMARK_WARMUP_BYTE 1024*1024*16 // 16MB
+
+UDownloadHashBenchmarkCommandlet::UDownloadHashBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UDownloadHashBenchmarkCommandlet::Main(const FString& Params)
+{
+	TArray<EDownloadHashAlgorithm> Algorithms;
+	FString AlgorithmsParam;
+	if (FParse::Value(*Params, TEXT("Algorithms="), AlgorithmsParam, false))
+	{
+		TArray<FString> AlgorithmNames;
+		AlgorithmsParam.ParseIntoArray(AlgorithmNames, TEXT(","));
+		for (const FString& AlgorithmName : AlgorithmNames)
+		{
+			EDownloadHashAlgorithm Algorithm;
+			if (!IDownloadHasher::ParseAlgorithmName(AlgorithmName, Algorithm))
+			{
+				UE_LOG(LogDownloadHashBenchmark, Error, TEXT("unknown hash algorithm %s."), *AlgorithmName);
+				return 1;
+			}
+			Algorithms.AddUnique(Algorithm);
+		}
+	}
+	else
+	{
+		Algorithms = { EDownloadHashAlgorithm::MD5, EDownloadHashAlgorithm::SHA256, EDownloadHashAlgorithm::XXHash64, EDownloadHashAlgorithm::CRC32C };
+	}
+
+	int32 TotalMB = BENCHMARK_TOTAL_MB;
+	FParse::Value(*Params, TEXT("TotalMB="), TotalMB);
+	const int64 TotalByte = FMath::Max(1, TotalMB) * 1024ll * 1024ll;
+
+	const int32 BufferSizes[] = { 1024 * 4, 1024 * 64, 1024 * 1024, 1024 * 1024 * 16 };
+
+	// random content,the biggest buffer is reused for every size.
+	TArray<uint8> Data;
+	Data.SetNumUninitialized(BufferSizes[ARRAY_COUNT(BufferSizes) - 1]);
+	FRandomStream RandomStream(0x5EED);
+	for (uint8& Byte : Data)
+	{
+		Byte = (uint8)RandomStream.RandHelper(256);
+	}
+
+	FString Csv = TEXT("Algorithm,BufferSize,GBs\n");
+	for (int32 BufferSize : BufferSizes)
+	{
+		for (EDownloadHashAlgorithm Algorithm : Algorithms)
+		{
+			double GBs = RunBenchmark({ Algorithm }, Data, BufferSize, TotalByte);
+			FString AlgorithmName = IDownloadHasher::GetAlgorithmName(Algorithm);
+			UE_LOG(LogDownloadHashBenchmark, Display, TEXT("%-24s %10d bytes %8.3f GB/s"), *AlgorithmName, BufferSize, GBs);
+			Csv += FString::Printf(TEXT("%s,%d,%.3f\n"), *AlgorithmName, BufferSize, GBs);
+		}
+		if (Algorithms.Num() > 1)
+		{
+			double GBs = RunBenchmark(Algorithms, Data, BufferSize, TotalByte);
+			UE_LOG(LogDownloadHashBenchmark, Display, TEXT("%-24s %10d bytes %8.3f GB/s"), TEXT("MultiDigest"), BufferSize, GBs);
+			Csv += FString::Printf(TEXT("MultiDigest,%d,%.3f\n"), BufferSize, GBs);
+		}
+	}
+
+	FString OutputPath;
+	if (FParse::Value(*Params, TEXT("Output="), OutputPath))
+	{
+		if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+		{
+			UE_LOG(LogDownloadHashBenchmark, Error, TEXT("save result to %s faild."), *OutputPath);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+double UDownloadHashBenchmarkCommandlet::RunBenchmark(const TArray<EDownloadHashAlgorithm>& InAlgorithms, const TArray<uint8>& InData, int32 InBufferSize, int64 InTotalByte)const
+{
+	FDownloadMultiHasher Hasher(InAlgorithms);
+
+	// warm up the cache and lazily initialized tables
+	for (int64 HashedByte = 0; HashedByte < BENCHMARK_WARMUP_BYTE; HashedByte += InBufferSize)
+	{
+		Hasher.Update(InData.GetData(), InBufferSize);
+	}
+	Hasher.Final();
+	Hasher.Reset();
+
+	const int32 BufferCount = InData.Num() / InBufferSize;
+	int64 HashedByte = 0;
+	int32 BufferIndex = 0;
+	double BeginTime = FPlatformTime::Seconds();
+	while (HashedByte < InTotalByte)
+	{
+		Hasher.Update(InData.GetData() + (int64)BufferIndex * InBufferSize, InBufferSize);
+		BufferIndex = (BufferIndex + 1) % BufferCount;
+		HashedByte += InBufferSize;
+	}
+	Hasher.Final();
+	double ElapsedTime = FMath::Max(FPlatformTime::Seconds() - BeginTime, 1e-9);
+	return (double)HashedByte / ElapsedTime / (1024.0 * 1024.0 * 1024.0);
+}
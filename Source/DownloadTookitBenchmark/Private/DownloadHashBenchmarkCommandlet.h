@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "DownloadHasher.h"
+#include "DownloadHashBenchmarkCommandlet.generated.h"
+
+/*
+	Measure the throughput of hash engines.
+	- UE4Editor-Cmd.exe Project.uproject -run=DownloadHashBenchmark [-Algorithms=MD5,SHA256,XXHash64,CRC32C] [-TotalMB=512] [-Output=Result.csv]
+	- report GB/s of every algorithm and buffer size,the last row of each buffer size is all algorithms in one pass.
+*/
+UCLASS()
+class UDownloadHashBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UDownloadHashBenchmarkCommandlet();
+	virtual int32 Main(const FString& Params)override;
+
+protected:
+	// return GB/s
+	double RunBenchmark(const TArray<EDownloadHashAlgorithm>& InAlgorithms, const TArray<uint8>& InData, int32 InBufferSize, int64 InTotalByte)const;
+};
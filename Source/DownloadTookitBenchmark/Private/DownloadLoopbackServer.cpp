@@ -0,0 +1,312 @@
+#include "DownloadLoopbackServer.h"
+
+// engine header
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/SecureHash.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDownloadLoopbackServer, Log, All);
+
+#define LOOPBACK_WAIT_MS 100
+#define MAX_HEADER_SIZE 1024*16 // 16KB
+#define SEND_BLOCK_SIZE 1024*64 // 64KB
+
+class FDownloadLoopbackServer::FConnection : public FRunnable
+{
+public:
+	FConnection(FDownloadLoopbackServer& InServer, FSocket* InSocket, int32 InSerial)
+		: Server(InServer),
+		Socket(InSocket),
+		RandomStream(InSerial),
+		bFinished(false)
+	{
+		Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("DownloadLoopbackConnection%d"), InSerial));
+	}
+	virtual ~FConnection()
+	{
+		if (Thread)
+		{
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+	}
+
+	bool IsFinished()const { return bFinished; }
+
+	virtual uint32 Run()override
+	{
+		FString Method;
+		FString Path;
+		FString Range;
+		while (!Server.bStopping && ReadRequest(Method, Path, Range))
+		{
+			Server.RequestCount.Increment();
+			if (!Respond(Method, Path, Range))
+				break;
+		}
+		Socket->Close();
+		bFinished = true;
+		return 0;
+	}
+
+private:
+	// read a request header,the bytes after it are kept for the next request.
+	bool ReadRequest(FString& OutMethod, FString& OutPath, FString& OutRange)
+	{
+		int32 HeaderEnd = INDEX_NONE;
+		while ((HeaderEnd = FindHeaderEnd()) == INDEX_NONE)
+		{
+			if (Server.bStopping || Received.Num() > MAX_HEADER_SIZE)
+				return false;
+			if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(LOOPBACK_WAIT_MS)))
+				continue;
+			uint8 Buffer[4096];
+			int32 ReadByte = 0;
+			if (!Socket->Recv(Buffer, ARRAY_COUNT(Buffer), ReadByte) || ReadByte <= 0)
+				return false;
+			Received.Append(Buffer, ReadByte);
+		}
+		FString Header(HeaderEnd, (const ANSICHAR*)Received.GetData());
+		Received.RemoveAt(0, HeaderEnd + 4, false);
+
+		TArray<FString> Lines;
+		Header.ParseIntoArray(Lines, TEXT("\r\n"));
+		TArray<FString> RequestLine;
+		if (!Lines.Num() || Lines[0].ParseIntoArrayWS(RequestLine) < 2)
+			return false;
+		OutMethod = RequestLine[0];
+		OutPath = RequestLine[1];
+		OutRange.Empty();
+		for (const FString& Line : Lines)
+		{
+			if (Line.StartsWith(TEXT("Range:")))
+			{
+				OutRange = Line.Mid(6).TrimStartAndEnd();
+			}
+		}
+		return true;
+	}
+
+	int32 FindHeaderEnd()const
+	{
+		for (int32 Index = 0; Index + 3 < Received.Num(); ++Index)
+		{
+			if (Received[Index] == '\r' && Received[Index + 1] == '\n' && Received[Index + 2] == '\r' && Received[Index + 3] == '\n')
+				return Index;
+		}
+		return INDEX_NONE;
+	}
+
+	// return false if the connection should be closed
+	bool Respond(const FString& InMethod, const FString& InPath, const FString& InRange)
+	{
+		FDownloadLoopbackSettings Settings = Server.GetSettings();
+		if (Settings.LatencySeconds > 0)
+		{
+			FPlatformProcess::Sleep(Settings.LatencySeconds);
+		}
+		TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> File = Server.FindFile(InPath);
+		if (!File.IsValid())
+		{
+			return SendHeader(TEXT("404 Not Found"), TEXT("Content-Length: 0\r\n"));
+		}
+		const int64 FileSize = File->Num();
+		int64 Begin = 0;
+		int64 End = FileSize - 1;
+		bool bRange = false;
+		FString RangeValue;
+		if (!Settings.bIgnoreRange && InRange.Split(TEXT("bytes="), NULL, &RangeValue))
+		{
+			FString BeginValue;
+			FString EndValue;
+			RangeValue.Split(TEXT("-"), &BeginValue, &EndValue);
+			Begin = FCString::Atoi64(*BeginValue);
+			End = EndValue.IsEmpty() ? FileSize - 1 : FMath::Min(FCString::Atoi64(*EndValue), FileSize - 1);
+			if (Begin > End || Begin >= FileSize)
+			{
+				return SendHeader(TEXT("416 Range Not Satisfiable"), FString::Printf(TEXT("Content-Range: bytes */%lld\r\nContent-Length: 0\r\n"), FileSize));
+			}
+			bRange = true;
+		}
+		int64 Length = End - Begin + 1;
+		// the connection is closed after a faulty response,the rest of it is never sent.
+		bool bMismatch = InMethod != TEXT("HEAD") && RandomStream.FRand() < Settings.MismatchRate;
+		bool bDrop = !bMismatch && InMethod != TEXT("HEAD") && RandomStream.FRand() < Settings.DropRate;
+		FString Headers = FString::Printf(TEXT("Content-Length: %lld\r\nAccept-Ranges: bytes\r\nETag: \"%d-%lld\"\r\nLast-Modified: Mon, 01 Jan 2024 00:00:00 GMT\r\nContent-Type: application/octet-stream\r\n"),
+			bMismatch ? Length - 1 : Length, GetTypeHash(InPath), FileSize);
+		if (bRange)
+		{
+			Headers += FString::Printf(TEXT("Content-Range: bytes %lld-%lld/%lld\r\n"), Begin, End, FileSize);
+		}
+		if (!SendHeader(bRange ? TEXT("206 Partial Content") : TEXT("200 OK"), Headers) || InMethod == TEXT("HEAD"))
+		{
+			return !bMismatch && !bDrop;
+		}
+		int64 SendLength = bMismatch ? Length - 1 : (bDrop ? (int64)(RandomStream.FRand() * Length) : Length);
+		return SendBody(File->GetData() + Begin, SendLength, Settings.BytesPerSecond) && !bMismatch && !bDrop;
+	}
+
+	bool SendHeader(const TCHAR* InStatus, const FString& InHeaders)
+	{
+		FString Header = FString::Printf(TEXT("HTTP/1.1 %s\r\n%sConnection: keep-alive\r\n\r\n"), InStatus, *InHeaders);
+		FTCHARToUTF8 Converted(*Header);
+		return SendAll((const uint8*)Converted.Get(), Converted.Length());
+	}
+
+	bool SendBody(const uint8* InData, int64 InLength, int64 InBytesPerSecond)
+	{
+		double BeginTime = FPlatformTime::Seconds();
+		for (int64 SentByte = 0; SentByte < InLength;)
+		{
+			int32 BlockSize = (int32)FMath::Min<int64>(SEND_BLOCK_SIZE, InLength - SentByte);
+			if (!SendAll(InData + SentByte, BlockSize))
+				return false;
+			SentByte += BlockSize;
+			// pace to the bandwidth cap
+			if (InBytesPerSecond > 0)
+			{
+				double WaitTime = BeginTime + (double)SentByte / InBytesPerSecond - FPlatformTime::Seconds();
+				if (WaitTime > 0)
+					FPlatformProcess::Sleep((float)WaitTime);
+			}
+			if (Server.bStopping)
+				return false;
+		}
+		return true;
+	}
+
+	bool SendAll(const uint8* InData, int32 InLength)
+	{
+		while (InLength > 0)
+		{
+			int32 SentByte = 0;
+			if (!Socket->Send(InData, InLength, SentByte) || SentByte <= 0)
+				return false;
+			InData += SentByte;
+			InLength -= SentByte;
+		}
+		return true;
+	}
+
+	FDownloadLoopbackServer& Server;
+	FSocket* Socket;
+	FRunnableThread* Thread;
+	FRandomStream RandomStream;
+	TArray<uint8> Received;
+	FThreadSafeBool bFinished;
+};
+
+FDownloadLoopbackServer::FDownloadLoopbackServer()
+	: ListenSocket(nullptr),
+	Thread(nullptr),
+	Port(0)
+{
+}
+
+FDownloadLoopbackServer::~FDownloadLoopbackServer()
+{
+	Shutdown();
+}
+
+bool FDownloadLoopbackServer::Start(int32 InPort)
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> Address = SocketSubsystem->CreateInternetAddr();
+	bool bValid = false;
+	Address->SetIp(TEXT("127.0.0.1"), bValid);
+	Address->SetPort(InPort);
+	ListenSocket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("DownloadLoopbackServer"), false);
+	if (!ListenSocket || !ListenSocket->SetReuseAddr() || !ListenSocket->Bind(*Address) || !ListenSocket->Listen(64))
+	{
+		UE_LOG(LogDownloadLoopbackServer, Error, TEXT("listen on 127.0.0.1:%d faild."), InPort);
+		Shutdown();
+		return false;
+	}
+	Port = ListenSocket->GetPortNo();
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("DownloadLoopbackServer"));
+	UE_LOG(LogDownloadLoopbackServer, Display, TEXT("listen on 127.0.0.1:%d."), Port);
+	return Thread != nullptr;
+}
+
+void FDownloadLoopbackServer::Shutdown()
+{
+	bStopping = true;
+	if (Thread)
+	{
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+	// the connection threads exit when stopping
+	Connections.Reset();
+	if (ListenSocket)
+	{
+		ListenSocket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ListenSocket);
+		ListenSocket = nullptr;
+	}
+}
+
+FString FDownloadLoopbackServer::AddFile(const FString& InPath, int64 InSize)
+{
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> File = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	File->SetNumUninitialized(InSize);
+	FRandomStream RandomStream(GetTypeHash(InPath));
+	for (uint8& Byte : *File)
+	{
+		Byte = (uint8)RandomStream.RandHelper(256);
+	}
+	FString Hash = FMD5::HashBytes(File->GetData(), File->Num());
+	FScopeLock ScopeLock(&Lock);
+	Files.Add(InPath, File);
+	return Hash;
+}
+
+FString FDownloadLoopbackServer::GetURL(const FString& InPath)const
+{
+	return FString::Printf(TEXT("http://127.0.0.1:%d%s"), Port, *InPath);
+}
+
+void FDownloadLoopbackServer::SetSettings(const FDownloadLoopbackSettings& InSettings)
+{
+	FScopeLock ScopeLock(&Lock);
+	Settings = InSettings;
+}
+
+FDownloadLoopbackSettings FDownloadLoopbackServer::GetSettings()const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Settings;
+}
+
+TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> FDownloadLoopbackServer::FindFile(const FString& InPath)const
+{
+	FScopeLock ScopeLock(&Lock);
+	const TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe>* File = Files.Find(InPath);
+	return File ? *File : nullptr;
+}
+
+uint32 FDownloadLoopbackServer::Run()
+{
+	while (!bStopping)
+	{
+		// the threads of closed connections are joined
+		Connections.RemoveAll([](const TUniquePtr<FConnection>& Connection) { return Connection->IsFinished(); });
+		bool bPending = false;
+		if (!ListenSocket->WaitForPendingConnection(bPending, FTimespan::FromMilliseconds(LOOPBACK_WAIT_MS)) || !bPending)
+			continue;
+		FSocket* Socket = ListenSocket->Accept(TEXT("DownloadLoopbackConnection"));
+		if (Socket)
+		{
+			Socket->SetNoDelay(true);
+			Connections.Add(MakeUnique<FConnection>(*this, Socket, ConnectionSerial.Increment()));
+		}
+	}
+	return 0;
+}
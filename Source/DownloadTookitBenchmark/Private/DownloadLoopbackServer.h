@@ -0,0 +1,72 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/ScopeLock.h"
+
+class FSocket;
+
+// faults injected into every response
+struct FDownloadLoopbackSettings
+{
+	// second before the response of every request
+	float LatencySeconds = 0.f;
+	// byte per second of a connection,0 is unlimited.
+	int64 BytesPerSecond = 0;
+	// probability of a response cut in the middle,the connection is closed.
+	float DropRate = 0.f;
+	// probability of a response with one byte less than the range,the connection is closed.
+	float MismatchRate = 0.f;
+	// the Range header is ignored like a broken proxy,every GET is replied 200 with the whole file.
+	bool bIgnoreRange = false;
+};
+
+/*
+	A range capable http server on loopback,stand in for the CDN in benchmarks.
+	- files are generated in memory by AddFile,served at http://127.0.0.1:Port/Path by GET/HEAD with Range.
+	- every connection is served by its own thread with keep-alive,responses are paced by the settings.
+*/
+class FDownloadLoopbackServer : public FRunnable
+{
+public:
+	FDownloadLoopbackServer();
+	virtual ~FDownloadLoopbackServer();
+
+	// InPort 0 is any free port
+	bool Start(int32 InPort = 0);
+	void Shutdown();
+	// random content of InSize,return the MD5 of it.
+	FString AddFile(const FString& InPath, int64 InSize);
+	FString GetURL(const FString& InPath)const;
+
+	// could be changed between scenarios,used by the next requests.
+	void SetSettings(const FDownloadLoopbackSettings& InSettings);
+	FDownloadLoopbackSettings GetSettings()const;
+	int32 GetRequestCount()const { return RequestCount.GetValue(); }
+	void ResetRequestCount() { RequestCount.Reset(); }
+
+	// FRunnable
+	virtual uint32 Run()override;
+	virtual void Stop()override { bStopping = true; }
+
+protected:
+	class FConnection;
+	friend class FConnection;
+
+	TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe> FindFile(const FString& InPath)const;
+
+private:
+	FSocket* ListenSocket;
+	FRunnableThread* Thread;
+	int32 Port;
+	FThreadSafeBool bStopping;
+	FThreadSafeCounter RequestCount;
+	FThreadSafeCounter ConnectionSerial;
+	mutable FCriticalSection Lock;
+	FDownloadLoopbackSettings Settings;
+	TMap<FString, TSharedPtr<TArray<uint8>, ESPMode::ThreadSafe>> Files;
+	TArray<TUniquePtr<FConnection>> Connections;
+};
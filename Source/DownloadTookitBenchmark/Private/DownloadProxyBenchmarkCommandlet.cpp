@@ -0,0 +1,315 @@
+#include "DownloadProxyBenchmarkCommandlet.h"
+#include "DownloadProxy.h"
+#include "DownloadManager.h"
+#include "DownloadJournal.h"
+
+// engine header
+#include "Containers/Ticker.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HttpModule.h"
+#include "HttpManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDownloadProxyBenchmark, Log, All);
+
+#define BENCHMARK_FILE_MB 256
+#define BENCHMARK_SMALL_FILE_COUNT 200
+#define BENCHMARK_SMALL_FILE_KB 64
+#define BENCHMARK_CONNECTION_COUNT 4
+#define BENCHMARK_FRAME_SECONDS (1.0 / 60.0)
+#define BENCHMARK_TIMEOUT_SECONDS 600.0
+// the paused scenario wait this frames before resume
+#define BENCHMARK_PAUSE_FRAMES 30
+#define BENCHMARK_PAUSE_PROGRESS 0.3f
+// MAX_REQUEST_SIZE of the transfer,the file of IgnoreRange must be larger
+#define BENCHMARK_REQUEST_MB 4
+
+UDownloadProxyBenchmarkCommandlet::UDownloadProxyBenchmarkCommandlet()
+	: FileSize(0),
+	TimeoutSeconds(BENCHMARK_TIMEOUT_SECONDS)
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UDownloadProxyBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString ScenariosParam = TEXT("Full,Sliced,PauseResume,SmallFiles,IgnoreRange");
+	FParse::Value(*Params, TEXT("Scenarios="), ScenariosParam, false);
+	TArray<FString> Scenarios;
+	ScenariosParam.ParseIntoArray(Scenarios, TEXT(","));
+
+	int32 FileMB = BENCHMARK_FILE_MB;
+	FParse::Value(*Params, TEXT("FileMB="), FileMB);
+	int32 SmallFileCount = BENCHMARK_SMALL_FILE_COUNT;
+	FParse::Value(*Params, TEXT("SmallFiles="), SmallFileCount);
+	int32 SmallFileKB = BENCHMARK_SMALL_FILE_KB;
+	FParse::Value(*Params, TEXT("SmallFileKB="), SmallFileKB);
+	int32 ConnectionCount = BENCHMARK_CONNECTION_COUNT;
+	FParse::Value(*Params, TEXT("Connections="), ConnectionCount);
+	float Timeout = (float)TimeoutSeconds;
+	FParse::Value(*Params, TEXT("Timeout="), Timeout);
+	TimeoutSeconds = Timeout;
+
+	FDownloadLoopbackSettings Settings;
+	float LatencyMs = 0.f;
+	FParse::Value(*Params, TEXT("LatencyMs="), LatencyMs);
+	Settings.LatencySeconds = LatencyMs / 1000.f;
+	float BandwidthMBs = 0.f;
+	FParse::Value(*Params, TEXT("BandwidthMBs="), BandwidthMBs);
+	Settings.BytesPerSecond = (int64)(BandwidthMBs * 1024.0 * 1024.0);
+	FParse::Value(*Params, TEXT("DropRate="), Settings.DropRate);
+	FParse::Value(*Params, TEXT("MismatchRate="), Settings.MismatchRate);
+
+	Server = MakeUnique<FDownloadLoopbackServer>();
+	if (!Server->Start())
+	{
+		return 1;
+	}
+	FilePath = TEXT("/benchmark/file.bin");
+	FileSize = FMath::Max(1, FileMB) * 1024ll * 1024ll;
+	FileHash = Server->AddFile(FilePath, FileSize);
+	Server->SetSettings(Settings);
+	SaveDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("DownloadBenchmark"));
+
+	TArray<FDownloadBenchmarkResult> Results;
+	for (const FString& Scenario : Scenarios)
+	{
+		if (Scenario == TEXT("Full"))
+			Results.Add(RunFile(Scenario, false, 1, false));
+		else if (Scenario == TEXT("Sliced"))
+			Results.Add(RunFile(Scenario, true, ConnectionCount, false));
+		else if (Scenario == TEXT("PauseResume"))
+			Results.Add(RunFile(Scenario, true, ConnectionCount, true));
+		else if (Scenario == TEXT("SmallFiles"))
+			Results.Add(RunSmallFiles(SmallFileCount, FMath::Max(1, SmallFileKB) * 1024ll));
+		else if (Scenario == TEXT("IgnoreRange"))
+			Results.Add(RunIgnoreRange(Scenario, ConnectionCount));
+		else
+			UE_LOG(LogDownloadProxyBenchmark, Error, TEXT("unknown scenario %s."), *Scenario);
+	}
+	Server->Shutdown();
+	IFileManager::Get().DeleteDirectory(*SaveDir, false, true);
+
+	bool bAllSucceeded = true;
+	FString Csv = TEXT("Scenario,Succeeded,Seconds,MBs,GameThreadMsPerFrame,MaxGameThreadMs,PeakRSSMB,RequestCount,RetryCount\n");
+	for (const FDownloadBenchmarkResult& Result : Results)
+	{
+		bAllSucceeded &= Result.bSucceeded;
+		UE_LOG(LogDownloadProxyBenchmark, Display, TEXT("%-12s %-6s %8.2f s %10.1f MB/s %7.3f ms/frame(max %.3f) %8.1f MB RSS %6d requests %4d retries"),
+			*Result.Scenario, Result.bSucceeded ? TEXT("OK") : TEXT("FAILD"), Result.Seconds, Result.MBs, Result.GameThreadMsPerFrame, Result.MaxGameThreadMs, Result.PeakRSSMB, Result.RequestCount, Result.RetryCount);
+		Csv += FString::Printf(TEXT("%s,%d,%.3f,%.1f,%.3f,%.3f,%.1f,%d,%d\n"),
+			*Result.Scenario, Result.bSucceeded ? 1 : 0, Result.Seconds, Result.MBs, Result.GameThreadMsPerFrame, Result.MaxGameThreadMs, Result.PeakRSSMB, Result.RequestCount, Result.RetryCount);
+	}
+
+	FString OutputPath;
+	if (FParse::Value(*Params, TEXT("Output="), OutputPath))
+	{
+		if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+		{
+			UE_LOG(LogDownloadProxyBenchmark, Error, TEXT("save result to %s faild."), *OutputPath);
+			return 1;
+		}
+	}
+	FString BaselinePath;
+	float Tolerance = 0.1f;
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	if (FParse::Value(*Params, TEXT("Baseline="), BaselinePath) && !CompareBaseline(BaselinePath, Tolerance, Results))
+	{
+		return 1;
+	}
+	return bAllSucceeded ? 0 : 1;
+}
+
+FDownloadBenchmarkResult UDownloadProxyBenchmarkCommandlet::RunFile(const FString& InScenario, bool bInSlice, int32 InConnectionCount, bool bInPauseResume)
+{
+	FDownloadBenchmarkResult Result;
+	Result.Scenario = InScenario;
+
+	FDownloadFile DownloadFile;
+	DownloadFile.URL = Server->GetURL(FilePath);
+	DownloadFile.SavePath = FPaths::Combine(SaveDir, InScenario + TEXT(".bin"));
+	DownloadFile.Name = FPaths::GetCleanFilename(DownloadFile.SavePath);
+	// not revalidated or resumed from the last run
+	IFileManager::Get().Delete(*DownloadFile.SavePath, false, true, true);
+	FDownloadJournal::Delete(DownloadFile.SavePath);
+
+	UDownloadProxy* Proxy = NewObject<UDownloadProxy>();
+	Proxy->AddToRoot();
+	Server->ResetRequestCount();
+	Proxy->RequestDownloadFile(DownloadFile, bInSlice, 0, false, InConnectionCount);
+
+	int32 PausedFrame = INDEX_NONE;
+	bool bResumed = false;
+	bool bFinished = RunFrames(Result, [Proxy]()
+	{
+		EDownloadStatus Status = Proxy->GetDownloadStatus();
+		return Status == EDownloadStatus::Succeeded || Status == EDownloadStatus::Failed || Status == EDownloadStatus::Canceled;
+	},
+	[&](int32 InFrame)
+	{
+		if (!bInPauseResume || bResumed)
+			return;
+		if (PausedFrame == INDEX_NONE && Proxy->GetDownloadProgress() >= BENCHMARK_PAUSE_PROGRESS)
+		{
+			Proxy->Pause();
+			PausedFrame = Proxy->GetDownloadStatus() == EDownloadStatus::Paused ? InFrame : INDEX_NONE;
+		}
+		else if (PausedFrame != INDEX_NONE && InFrame - PausedFrame >= BENCHMARK_PAUSE_FRAMES)
+		{
+			bResumed = Proxy->Resume();
+		}
+	});
+
+	Result.bSucceeded = bFinished && Proxy->GetDownloadStatus() == EDownloadStatus::Succeeded &&
+		Proxy->GetHashDigest(EDownloadHashAlgorithm::MD5).Equals(FileHash, ESearchCase::IgnoreCase);
+	Result.RetryCount = Proxy->GetMetrics().RetryCount;
+	Result.RequestCount = Server->GetRequestCount();
+	Result.MBs = Result.bSucceeded ? FileSize / Result.Seconds / (1024.0 * 1024.0) : 0;
+	if (!bFinished)
+	{
+		Proxy->Cancel();
+	}
+	Proxy->RemoveFromRoot();
+	IFileManager::Get().Delete(*DownloadFile.SavePath, false, true, true);
+	return Result;
+}
+
+FDownloadBenchmarkResult UDownloadProxyBenchmarkCommandlet::RunIgnoreRange(const FString& InScenario, int32 InConnectionCount)
+{
+	if (FileSize <= BENCHMARK_REQUEST_MB * 1024ll * 1024ll)
+	{
+		UE_LOG(LogDownloadProxyBenchmark, Error, TEXT("%s need a file larger than %d MB."), *InScenario, BENCHMARK_REQUEST_MB);
+		FDownloadBenchmarkResult Result;
+		Result.Scenario = InScenario;
+		return Result;
+	}
+	// the first range request is replied with the whole file,the transfer fall back to one request.
+	FDownloadLoopbackSettings Settings = Server->GetSettings();
+	FDownloadLoopbackSettings IgnoreRangeSettings = Settings;
+	IgnoreRangeSettings.bIgnoreRange = true;
+	Server->SetSettings(IgnoreRangeSettings);
+	FDownloadBenchmarkResult Result = RunFile(InScenario, true, InConnectionCount, false);
+	Server->SetSettings(Settings);
+	return Result;
+}
+
+FDownloadBenchmarkResult UDownloadProxyBenchmarkCommandlet::RunSmallFiles(int32 InFileCount, int64 InFileSize)
+{
+	FDownloadBenchmarkResult Result;
+	Result.Scenario = TEXT("SmallFiles");
+	UDownloadManager* Manager = UDownloadManager::Get();
+	if (!Manager)
+	{
+		UE_LOG(LogDownloadProxyBenchmark, Error, TEXT("SmallFiles need the download manager of engine."));
+		return Result;
+	}
+
+	TArray<FDownloadFile> Manifest;
+	for (int32 Index = 0; Index < InFileCount; ++Index)
+	{
+		FString Path = FString::Printf(TEXT("/benchmark/small/%d.bin"), Index);
+		FDownloadFile& DownloadFile = Manifest.AddDefaulted_GetRef();
+		DownloadFile.HASH = Server->AddFile(Path, InFileSize);
+		DownloadFile.URL = Server->GetURL(Path);
+		DownloadFile.SavePath = FPaths::Combine(SaveDir, TEXT("Small"), FString::Printf(TEXT("%d.bin"), Index));
+		DownloadFile.Name = FPaths::GetCleanFilename(DownloadFile.SavePath);
+		IFileManager::Get().Delete(*DownloadFile.SavePath, false, true, true);
+	}
+	Server->ResetRequestCount();
+	UDownloadBatch* Batch = Manager->EnqueueBatch(Manifest, EDownloadPriority::Normal, 1);
+	Batch->AddToRoot();
+	bool bFinished = RunFrames(Result, [Batch]()
+	{
+		return Batch->GetDownloadStatus() != EDownloadStatus::Downloading;
+	},
+	[](int32 InFrame) {});
+
+	Result.bSucceeded = bFinished && Batch->GetDownloadStatus() == EDownloadStatus::Succeeded;
+	Result.RetryCount = Batch->GetMetrics().RetryCount;
+	Result.RequestCount = Server->GetRequestCount();
+	Result.MBs = Result.bSucceeded ? InFileCount * InFileSize / Result.Seconds / (1024.0 * 1024.0) : 0;
+	if (!bFinished)
+	{
+		Batch->Cancel();
+	}
+	Batch->RemoveFromRoot();
+	IFileManager::Get().DeleteDirectory(*FPaths::Combine(SaveDir, TEXT("Small")), false, true);
+	return Result;
+}
+
+bool UDownloadProxyBenchmarkCommandlet::RunFrames(FDownloadBenchmarkResult& OutResult, TFunctionRef<bool()> InIsDone, TFunctionRef<void(int32)> InOnFrame)
+{
+	const double BeginTime = FPlatformTime::Seconds();
+	double LastFrameTime = BeginTime;
+	double TotalWorkTime = 0;
+	int32 FrameCount = 0;
+	uint64 PeakRSS = 0;
+	bool bDone = false;
+	while (!bDone && FPlatformTime::Seconds() - BeginTime < TimeoutSeconds)
+	{
+		const double FrameTime = FPlatformTime::Seconds();
+		const float DeltaTime = (float)(FrameTime - LastFrameTime);
+		LastFrameTime = FrameTime;
+		// the game thread work of a frame
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		FHttpModule::Get().GetHttpManager().Tick(DeltaTime);
+		FTicker::GetCoreTicker().Tick(DeltaTime);
+		InOnFrame(FrameCount);
+		const double WorkTime = FPlatformTime::Seconds() - FrameTime;
+		TotalWorkTime += WorkTime;
+		OutResult.MaxGameThreadMs = FMath::Max(OutResult.MaxGameThreadMs, WorkTime * 1000.0);
+		PeakRSS = FMath::Max<uint64>(PeakRSS, FPlatformMemory::GetStats().UsedPhysical);
+		++FrameCount;
+
+		bDone = InIsDone();
+		if (!bDone && WorkTime < BENCHMARK_FRAME_SECONDS)
+		{
+			FPlatformProcess::Sleep((float)(BENCHMARK_FRAME_SECONDS - WorkTime));
+		}
+	}
+	OutResult.Seconds = FMath::Max(FPlatformTime::Seconds() - BeginTime, 1e-9);
+	OutResult.GameThreadMsPerFrame = FrameCount ? TotalWorkTime * 1000.0 / FrameCount : 0;
+	OutResult.PeakRSSMB = PeakRSS / (1024.0 * 1024.0);
+	if (!bDone)
+	{
+		UE_LOG(LogDownloadProxyBenchmark, Error, TEXT("%s is timeout after %.0f seconds."), *OutResult.Scenario, TimeoutSeconds);
+	}
+	return bDone;
+}
+
+bool UDownloadProxyBenchmarkCommandlet::CompareBaseline(const FString& InBaselinePath, float InTolerance, const TArray<FDownloadBenchmarkResult>& InResults)const
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *InBaselinePath))
+	{
+		UE_LOG(LogDownloadProxyBenchmark, Error, TEXT("load baseline %s faild."), *InBaselinePath);
+		return false;
+	}
+	bool bPassed = true;
+	// skip the header row
+	for (int32 Index = 1; Index < Lines.Num(); ++Index)
+	{
+		TArray<FString> Columns;
+		if (Lines[Index].ParseIntoArray(Columns, TEXT(","), false) < 4)
+			continue;
+		const FDownloadBenchmarkResult* Result = InResults.FindByPredicate([&Columns](const FDownloadBenchmarkResult& InResult) { return InResult.Scenario == Columns[0]; });
+		if (!Result)
+			continue;
+		double BaselineMBs = FCString::Atod(*Columns[3]);
+		if (Result->MBs < BaselineMBs * (1.0 - InTolerance))
+		{
+			UE_LOG(LogDownloadProxyBenchmark, Error, TEXT("%s is regressed,%.1f MB/s,baseline is %.1f MB/s."), *Result->Scenario, Result->MBs, BaselineMBs);
+			bPassed = false;
+		}
+	}
+	return bPassed;
+}
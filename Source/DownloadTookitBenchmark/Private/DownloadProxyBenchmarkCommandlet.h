@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "DownloadLoopbackServer.h"
+#include "DownloadProxyBenchmarkCommandlet.generated.h"
+
+class UDownloadProxy;
+
+// measured of a scenario
+struct FDownloadBenchmarkResult
+{
+	FString Scenario;
+	bool bSucceeded = false;
+	double Seconds = 0;
+	double MBs = 0;
+	// time of the download work on game thread(ticks,http callbacks,task graph) per frame
+	double GameThreadMsPerFrame = 0;
+	double MaxGameThreadMs = 0;
+	// sampled every frame
+	double PeakRSSMB = 0;
+	int32 RequestCount = 0;
+	int32 RetryCount = 0;
+};
+
+/*
+	Measure the download proxy against a loopback http server.
+	- UE4Editor-Cmd.exe Project.uproject -run=DownloadProxyBenchmark [-Scenarios=Full,Sliced,PauseResume,SmallFiles,IgnoreRange]
+		[-FileMB=256] [-SmallFiles=200] [-SmallFileKB=64] [-Connections=4]
+		[-LatencyMs=0] [-BandwidthMBs=0] [-DropRate=0] [-MismatchRate=0]
+		[-Output=Result.csv] [-Baseline=Last.csv] [-Tolerance=0.1]
+	- the frames are paced to 60 fps,the download work of every frame is measured.
+	- IgnoreRange is a sliced download from a server reply 200 to every range,-FileMB must be larger than a request(4MB).
+	- with -Baseline,a scenario slower(MB/s) than the baseline by Tolerance is reported and the commandlet return 1.
+*/
+UCLASS()
+class UDownloadProxyBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UDownloadProxyBenchmarkCommandlet();
+	virtual int32 Main(const FString& Params)override;
+
+protected:
+	FDownloadBenchmarkResult RunFile(const FString& InScenario, bool bInSlice, int32 InConnectionCount, bool bInPauseResume);
+	FDownloadBenchmarkResult RunSmallFiles(int32 InFileCount, int64 InFileSize);
+	// RunFile with the server ignore Range
+	FDownloadBenchmarkResult RunIgnoreRange(const FString& InScenario, int32 InConnectionCount);
+	// tick the frames until InIsDone return true or timeout,InOnFrame is called every frame.
+	bool RunFrames(FDownloadBenchmarkResult& OutResult, TFunctionRef<bool()> InIsDone, TFunctionRef<void(int32)> InOnFrame);
+	// return false if any scenario is slower than the baseline
+	bool CompareBaseline(const FString& InBaselinePath, float InTolerance, const TArray<FDownloadBenchmarkResult>& InResults)const;
+
+private:
+	TUniquePtr<FDownloadLoopbackServer> Server;
+	FString SaveDir;
+	// served file of Full/Sliced/PauseResume
+	FString FilePath;
+	FString FileHash;
+	int64 FileSize;
+	double TimeoutSeconds;
+};
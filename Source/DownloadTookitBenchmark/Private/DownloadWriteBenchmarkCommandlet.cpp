@@ -0,0 +1,123 @@
+#include "DownloadWriteBenchmarkCommandlet.h"
+
+// engine header
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Math/RandomStream.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDownloadWriteBenchmark, Log, All);
+
+#define BENCHMARK_TOTAL_MB 1024
+#define BENCHMARK_SEGMENT_COUNT 4
+// size of a response handed over to the writer
+#define BENCHMARK_BUFFER_SIZE 1024*1024*4 // 4MB
+
+UDownloadWriteBenchmarkCommandlet::UDownloadWriteBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UDownloadWriteBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 TotalMB = BENCHMARK_TOTAL_MB;
+	FParse::Value(*Params, TEXT("TotalMB="), TotalMB);
+	int32 SegmentCount = BENCHMARK_SEGMENT_COUNT;
+	FParse::Value(*Params, TEXT("Segments="), SegmentCount);
+	SegmentCount = FMath::Max(1, SegmentCount);
+	// whole buffers of every segment
+	const int64 SegmentByte = FMath::Max<int64>(FMath::Max(1, TotalMB) * 1024ll * 1024ll / SegmentCount / BENCHMARK_BUFFER_SIZE, 1) * BENCHMARK_BUFFER_SIZE;
+	const int64 TotalByte = SegmentByte * SegmentCount;
+
+	FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("WriteBenchmark.bin"));
+	FParse::Value(*Params, TEXT("Path="), Path);
+
+	// random content,the buffer is shared by every write like the pipeline stages.
+	FDownloadBufferPtr Data = MakeShared<TArray<uint8>, ESPMode::ThreadSafe>();
+	Data->SetNumUninitialized(BENCHMARK_BUFFER_SIZE);
+	FRandomStream RandomStream(0x5EED);
+	for (uint8& Byte : *Data)
+	{
+		Byte = (uint8)RandomStream.RandHelper(256);
+	}
+
+	const EDownloadWriteMode WriteModes[] = { EDownloadWriteMode::Buffered, EDownloadWriteMode::Positional, EDownloadWriteMode::Mapped };
+	const TCHAR* WriteModeNames[] = { TEXT("Buffered"), TEXT("Positional"), TEXT("Mapped") };
+
+	FString Csv = TEXT("WriteMode,Segments,MBs\n");
+	for (int32 Index = 0; Index < (int32)ARRAY_COUNT(WriteModes); ++Index)
+	{
+		double MBs = RunBenchmark(WriteModes[Index], Path, Data, TotalByte, SegmentCount);
+		IFileManager::Get().Delete(*Path, false, true, true);
+		if (MBs < 0)
+		{
+			UE_LOG(LogDownloadWriteBenchmark, Error, TEXT("write %s by %s faild."), *Path, WriteModeNames[Index]);
+			return 1;
+		}
+		UE_LOG(LogDownloadWriteBenchmark, Display, TEXT("%-12s %4d segments %10.1f MB/s"), WriteModeNames[Index], SegmentCount, MBs);
+		Csv += FString::Printf(TEXT("%s,%d,%.1f\n"), WriteModeNames[Index], SegmentCount, MBs);
+	}
+
+	FString OutputPath;
+	if (FParse::Value(*Params, TEXT("Output="), OutputPath))
+	{
+		if (!FFileHelper::SaveStringToFile(Csv, *OutputPath))
+		{
+			UE_LOG(LogDownloadWriteBenchmark, Error, TEXT("save result to %s faild."), *OutputPath);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+double UDownloadWriteBenchmarkCommandlet::RunBenchmark(EDownloadWriteMode InWriteMode, const FString& InPath, const FDownloadBufferPtr& InData, int64 InTotalByte, int32 InSegmentCount)const
+{
+	IFileManager::Get().Delete(*InPath, false, true, true);
+	const int64 SegmentByte = InTotalByte / InSegmentCount;
+	const int64 BufferSize = InData->Num();
+
+	double BeginTime = FPlatformTime::Seconds();
+	TSharedPtr<FDownloadFileWriter, ESPMode::ThreadSafe> Writer = MakeShared<FDownloadFileWriter, ESPMode::ThreadSafe>(InPath, 0, 0, InWriteMode, InTotalByte);
+	if (!Writer->Start())
+	{
+		return -1;
+	}
+	// a buffer of every segment in turn
+	for (int64 SegmentOffset = 0; SegmentOffset < SegmentByte; SegmentOffset += BufferSize)
+	{
+		for (int32 SegmentIndex = 0; SegmentIndex < InSegmentCount; ++SegmentIndex)
+		{
+			while (Writer->IsQueueFull())
+			{
+				FPlatformProcess::Sleep(0.0005f);
+			}
+			if (!Writer->Enqueue(SegmentIndex * SegmentByte + SegmentOffset, InData))
+			{
+				return -1;
+			}
+		}
+	}
+
+	// the closed callback is called on game thread
+	bool bClosed = false;
+	bool bSuccessd = false;
+	Writer->Close([&bClosed, &bSuccessd](bool bInSuccessd)
+	{
+		bClosed = true;
+		bSuccessd = bInSuccessd;
+	});
+	while (!bClosed)
+	{
+		FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		FPlatformProcess::Sleep(0.001f);
+	}
+	double ElapsedTime = FMath::Max(FPlatformTime::Seconds() - BeginTime, 1e-9);
+	return bSuccessd ? (double)InTotalByte / ElapsedTime / (1024.0 * 1024.0) : -1;
+}
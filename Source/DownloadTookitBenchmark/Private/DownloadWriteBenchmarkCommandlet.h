@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "DownloadFileWriter.h"
+#include "DownloadWriteBenchmarkCommandlet.generated.h"
+
+/*
+	Measure the throughput of file write modes.
+	- UE4Editor-Cmd.exe Project.uproject -run=DownloadWriteBenchmark [-TotalMB=1024] [-Segments=4] [-Path=Saved/WriteBenchmark.bin] [-Output=Result.csv]
+	- the buffers of segments are written interleaved like a segmented download,MB/s includes the file closed.
+*/
+UCLASS()
+class UDownloadWriteBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UDownloadWriteBenchmarkCommandlet();
+	virtual int32 Main(const FString& Params)override;
+
+protected:
+	// return MB/s,negative if faild
+	double RunBenchmark(EDownloadWriteMode InWriteMode, const FString& InPath, const FDownloadBufferPtr& InData, int64 InTotalByte, int32 InSegmentCount)const;
+};